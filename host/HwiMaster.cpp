@@ -0,0 +1,428 @@
+#include "HwiMaster.h"
+#include <algorithm>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h> // termios2: arbitrary baud rates such as 250000
+#include <linux/serial.h>
+
+// C++11 needs one definition of a static constexpr member once it is
+// odr-used (std::min binds MAX_READ to a reference)
+constexpr uint16_t HwiReadPlan::MAX_READ;
+constexpr uint16_t HwiReadPlan::DEFAULT_MAX_GAP;
+constexpr uint32_t HwiMaster::DEFAULT_TIMEOUT_US;
+
+namespace
+{
+    constexpr uint32_t FRAME_GAP_US = BAUDRATE > 19200 ? 1750 : 38500000 / BAUDRATE;
+
+    uint64_t nowUs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    uint16_t crc16(const uint8_t *p, size_t length)
+    {
+        uint16_t crc = 0xFFFF;
+        while (length--)
+        {
+            crc ^= *p++;
+            for (uint8_t i = 0; i < 8; i++)
+                crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+        return crc;
+    }
+
+    void appendCrc(std::vector<uint8_t> &frame)
+    {
+        uint16_t crc = crc16(frame.data(), frame.size());
+        frame.push_back(crc & 0xFF);
+        frame.push_back(crc >> 8);
+    }
+
+    std::vector<uint8_t> readRequest(uint8_t id, const HwiSpan &span)
+    {
+        std::vector<uint8_t> frame = {id, uint8_t(span.space), uint8_t(span.start >> 8),
+                                      uint8_t(span.start), uint8_t(span.count >> 8),
+                                      uint8_t(span.count)};
+        appendCrc(frame);
+        return frame;
+    }
+
+    uint16_t spaceSize(HwiSpace space)
+    {
+        return space == HwiSpace::HOLDING ? HOLDING_REG_COUNT : INPUT_REG_COUNT;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// HwiReadPlan
+// ---------------------------------------------------------------------------
+
+void HwiReadPlan::add(HwiSpace space, uint16_t start, uint16_t count)
+{
+    if (count == 0 || start >= spaceSize(space))
+        return;
+    count = std::min<uint16_t>(count, spaceSize(space) - start);
+    spans.push_back({space, start, count});
+}
+
+std::vector<HwiSpan> HwiReadPlan::frames(uint16_t maxGap) const
+{
+    std::vector<HwiSpan> sorted = spans;
+    std::sort(sorted.begin(), sorted.end(), [](const HwiSpan &a, const HwiSpan &b)
+              { return a.space != b.space ? a.space < b.space : a.start < b.start; });
+
+    std::vector<HwiSpan> out;
+    for (const HwiSpan &s : sorted)
+    {
+        uint16_t start = s.start;
+        uint16_t end = s.start + s.count;
+        if (!out.empty() && out.back().space == s.space)
+        {
+            HwiSpan &last = out.back();
+            uint16_t lastEnd = last.start + last.count;
+            uint16_t merged = std::max(end, lastEnd) - last.start;
+            if (start <= lastEnd + maxGap && merged <= MAX_READ)
+            {
+                last.count = merged;
+                continue;
+            }
+            start = std::max(start, lastEnd);
+        }
+
+        // New frame(s); a span wider than one request is split
+        while (start < end)
+        {
+            uint16_t count = std::min<uint16_t>(end - start, MAX_READ);
+            out.push_back({s.space, start, count});
+            start += count;
+        }
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// HwiBoard
+// ---------------------------------------------------------------------------
+
+HwiBoard::HwiBoard(uint8_t id) : slaveId(id)
+{
+    memset(holdingRegs, 0, sizeof(holdingRegs));
+    memset(inputRegs, 0, sizeof(inputRegs));
+}
+
+uint16_t HwiBoard::duty(uint8_t motor) const
+{
+    return holdingRegs[ModbusHoldingReg::DUTY_BASE + motor];
+}
+
+uint16_t HwiBoard::current(uint8_t motor) const
+{
+    return inputRegs[ModbusInputReg::CURR_BASE + motor];
+}
+
+int16_t HwiBoard::temperature(uint8_t motor) const
+{
+    return int16_t(inputRegs[ModbusInputReg::TEMP_BASE + motor]);
+}
+
+bool HwiBoard::temperatureValid(uint8_t motor) const
+{
+    return temperature(motor) != TEMP_REG_DISCONNECTED;
+}
+
+MotorStatus HwiBoard::status(uint8_t motor) const
+{
+    return MotorStatus(inputRegs[ModbusInputReg::STATUS_BASE + motor]);
+}
+
+uint64_t HwiBoard::timeMs() const
+{
+    const uint16_t *t = &inputRegs[ModbusInputReg::TIME_LOW];
+    return uint64_t(t[0]) | uint64_t(t[1]) << 16 | uint64_t(t[2]) << 32 | uint64_t(t[3]) << 48;
+}
+
+// The air and water sensors publish into the input space at their holding addresses
+int16_t HwiBoard::windingTemperature(uint8_t motor) const
+{
+    return int16_t(inputRegs[ModbusInputReg::WINDING_TEMP_BASE + motor]);
+}
+
+int16_t HwiBoard::airTemperature() const
+{
+    return int16_t(inputRegs[ModbusHoldingReg::AIR_TEMP_REG]);
+}
+
+int16_t HwiBoard::waterTemperature() const
+{
+    return int16_t(inputRegs[ModbusHoldingReg::WATER_TEMP_REG]);
+}
+
+bool HwiBoard::device(uint8_t index) const
+{
+    return inputRegs[ModbusInputReg::FAN_REG + index] != 0;
+}
+
+// ---------------------------------------------------------------------------
+// HwiSerialPort
+// ---------------------------------------------------------------------------
+
+HwiSerialPort::~HwiSerialPort()
+{
+    close();
+}
+
+bool HwiSerialPort::open(const char *path, uint32_t baud)
+{
+    close();
+    fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+        return false;
+
+    termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) < 0)
+    {
+        close();
+        return false;
+    }
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_cflag = BOTHER | CS8 | PARENB | CREAD | CLOCAL; // 8E1
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (ioctl(fd, TCSETS2, &tio) < 0)
+    {
+        close();
+        return false;
+    }
+
+    // USB adapters otherwise hold received bytes for up to 16 ms
+    serial_struct ss;
+    if (ioctl(fd, TIOCGSERIAL, &ss) == 0)
+    {
+        ss.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &ss);
+    }
+    return true;
+}
+
+void HwiSerialPort::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+bool HwiSerialPort::send(const uint8_t *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t n = ::write(fd, data, length);
+        if (n < 0)
+        {
+            pollfd p = {fd, POLLOUT, 0};
+            if (poll(&p, 1, 100) <= 0)
+                return false;
+            continue;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+size_t HwiSerialPort::receive(uint8_t *data, size_t length, uint32_t timeoutUs)
+{
+    pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, (timeoutUs + 999) / 1000) <= 0)
+        return 0;
+    ssize_t n = ::read(fd, data, length);
+    return n > 0 ? size_t(n) : 0;
+}
+
+void HwiSerialPort::discard()
+{
+    ioctl(fd, TCFLSH, TCIFLUSH);
+}
+
+// ---------------------------------------------------------------------------
+// HwiMaster
+// ---------------------------------------------------------------------------
+
+HwiMaster::HwiMaster(HwiTransport &transport) : transport(transport)
+{
+}
+
+HwiBoard &HwiMaster::addBoard(uint8_t id)
+{
+    boards.push_back(HwiBoard(id));
+    return boards.back();
+}
+
+void HwiMaster::read(HwiSpace space, uint16_t start, uint16_t count)
+{
+    readPlan.add(space, start, count);
+}
+
+void HwiMaster::readMotors()
+{
+    read(HwiSpace::INPUT, ModbusInputReg::CURR_BASE, MAX_MOTORS);
+    read(HwiSpace::INPUT, ModbusInputReg::TEMP_BASE, MAX_MOTORS);
+    read(HwiSpace::INPUT, ModbusInputReg::STATUS_BASE, MAX_MOTORS);
+}
+
+void HwiMaster::readDuties()
+{
+    read(HwiSpace::HOLDING, ModbusHoldingReg::DUTY_BASE, MAX_MOTORS);
+}
+
+void HwiMaster::readClock()
+{
+    read(HwiSpace::INPUT, ModbusInputReg::TIME_LOW, 4);
+}
+
+void HwiMaster::readAmbient()
+{
+    read(HwiSpace::INPUT, ModbusHoldingReg::AIR_TEMP_REG, 1);
+    read(HwiSpace::INPUT, ModbusHoldingReg::WATER_TEMP_REG, 1);
+    read(HwiSpace::INPUT, ModbusInputReg::FAN_REG, 4);
+}
+
+void HwiMaster::readWindings()
+{
+    read(HwiSpace::INPUT, ModbusInputReg::WINDING_TEMP_BASE, MAX_MOTORS);
+}
+
+void HwiMaster::plan(uint16_t maxGap)
+{
+    planned = readPlan.frames(maxGap);
+    for (HwiBoard &b : boards)
+    {
+        b.requests.clear();
+        for (const HwiSpan &span : planned)
+            b.requests.push_back(readRequest(b.slaveId, span));
+    }
+}
+
+bool HwiMaster::cycle()
+{
+    uint64_t start = nowUs();
+    bool all = true;
+
+    for (HwiBoard &b : boards)
+    {
+        b.complete = true;
+        for (size_t f = 0; f < planned.size(); f++)
+        {
+            const HwiSpan &span = planned[f];
+            if (!transact(b, b.requests[f], 5 + 2 * span.count))
+            {
+                b.complete = false;
+                continue;
+            }
+            uint16_t *regs = span.space == HwiSpace::HOLDING ? b.holdingRegs : b.inputRegs;
+            for (uint16_t i = 0; i < span.count; i++)
+                regs[span.start + i] = reply[3 + 2 * i] << 8 | reply[4 + 2 * i];
+        }
+        all = all && b.complete;
+    }
+
+    cycleUs = uint32_t(nowUs() - start);
+    return all;
+}
+
+bool HwiMaster::write(HwiBoard &board, uint16_t reg, uint16_t value)
+{
+    if (reg >= HOLDING_REG_COUNT)
+        return false;
+    std::vector<uint8_t> frame = {board.slaveId, 0x06, uint8_t(reg >> 8), uint8_t(reg),
+                                  uint8_t(value >> 8), uint8_t(value)};
+    appendCrc(frame);
+    if (!transact(board, frame, 8))
+        return false;
+    board.holdingRegs[reg] = value;
+    return true;
+}
+
+bool HwiMaster::write(HwiBoard &board, uint16_t start, const uint16_t *values, uint16_t count)
+{
+    if (count == 0 || count > 123 || start + count > HOLDING_REG_COUNT)
+        return false;
+    std::vector<uint8_t> frame = {board.slaveId, 0x10, uint8_t(start >> 8), uint8_t(start),
+                                  uint8_t(count >> 8), uint8_t(count), uint8_t(2 * count)};
+    for (uint16_t i = 0; i < count; i++)
+    {
+        frame.push_back(values[i] >> 8);
+        frame.push_back(values[i] & 0xFF);
+    }
+    appendCrc(frame);
+    if (!transact(board, frame, 8))
+        return false;
+    memcpy(&board.holdingRegs[start], values, count * sizeof(uint16_t));
+    return true;
+}
+
+// The slave needs to see the line quiet for one inter-frame gap
+void HwiMaster::waitGap()
+{
+    uint64_t now = nowUs();
+    if (now < lineIdleAt + FRAME_GAP_US)
+    {
+        uint64_t left = lineIdleAt + FRAME_GAP_US - now;
+        timespec ts = {time_t(left / 1000000), long(left % 1000000) * 1000};
+        nanosleep(&ts, nullptr);
+    }
+}
+
+bool HwiMaster::transact(HwiBoard &board, const std::vector<uint8_t> &request, uint16_t replyLength)
+{
+    waitGap();
+    if (!transport.send(request.data(), request.size()))
+        return false;
+
+    // Ends at the expected length; an exception reply is 5 bytes
+    uint64_t deadline = nowUs() + uint64_t(request.size()) * 11000000 / BAUDRATE + timeoutUs;
+    uint16_t have = 0;
+    uint16_t want = replyLength;
+    while (have < want)
+    {
+        uint64_t now = nowUs();
+        if (now >= deadline)
+            break;
+        size_t n = transport.receive(reply + have, want - have, uint32_t(deadline - now));
+        have += n;
+        if (have >= 2 && (reply[1] & 0x80))
+            want = 5;
+    }
+    lineIdleAt = nowUs();
+
+    if (have < want)
+    {
+        board.timeouts++;
+        transport.discard();
+        return false;
+    }
+    if (reply[0] != board.slaveId || (reply[1] & 0x7F) != request[1] || crc16(reply, want - 2) != (reply[want - 2] | reply[want - 1] << 8))
+    {
+        board.crcErrors++;
+        transport.discard();
+        return false;
+    }
+    if (reply[1] & 0x80)
+    {
+        board.exceptions++;
+        board.lastException = reply[2];
+        return false;
+    }
+    board.replies++;
+    return true;
+}
@@ -0,0 +1,183 @@
+// Host-side Modbus RTU master for one or more Hwi controllers on a shared
+// RS-485 line. Built from the same register definitions as the firmware
+// (include/RegisterMap.h), so addresses and sizes cannot drift.
+//
+// The poll set is declared as register spans. HwiReadPlan merges them into
+// the fewest FC03/FC04 frames: a gap of unused registers is read along
+// when that is cheaper on the wire than another request. Request frames
+// are built once per board. A cycle is then just write, read the exact
+// reply length, next. Nothing waits for a silence timeout, and the next
+// request goes out as soon as the RTU inter-frame gap has passed.
+//
+//   HwiSerialPort port;
+//   port.open("/dev/ttyUSB0");
+//   HwiMaster master(port);
+//   master.addBoard(1);
+//   master.addBoard(2);
+//   master.readMotors();
+//   master.readClock();
+//   master.plan();
+//   while (true)
+//   {
+//       master.cycle();
+//       int16_t t = master.board(0).temperature(3);
+//   }
+//
+// Build: g++ -std=gnu++11 -O2 -Iinclude host/HwiMaster.cpp <your sources>
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "RegisterMap.h"
+
+// Register space by its read function code
+enum class HwiSpace : uint8_t
+{
+    HOLDING = 0x03,
+    INPUT = 0x04,
+};
+
+struct HwiSpan
+{
+    HwiSpace space;
+    uint16_t start;
+    uint16_t count;
+};
+
+// Spans to read every cycle, merged into request frames
+class HwiReadPlan
+{
+public:
+    static constexpr uint16_t MAX_READ = 125; // Registers per FC03/FC04 request
+
+    // Padding that costs as much wire time as a separate request: its
+    // header, CRC and two inter-frame gaps, at 2 chars per register.
+    // Slave turnaround comes on top, so this is a lower bound.
+    static constexpr uint16_t DEFAULT_MAX_GAP = (13 + 2 * 1750 * BAUDRATE / 11 / 1000000) / 2;
+
+    void add(HwiSpace space, uint16_t start, uint16_t count);
+    void clear() { spans.clear(); }
+
+    // Sorted, merged frames; spans closer than `maxGap` registers share one
+    std::vector<HwiSpan> frames(uint16_t maxGap = DEFAULT_MAX_GAP) const;
+
+private:
+    std::vector<HwiSpan> spans;
+};
+
+// Register mirror and typed views for one controller
+class HwiBoard
+{
+public:
+    explicit HwiBoard(uint8_t id);
+
+    uint8_t id() const { return slaveId; }
+
+    uint16_t holding(uint16_t reg) const { return holdingRegs[reg]; }
+    uint16_t input(uint16_t reg) const { return inputRegs[reg]; }
+
+    // --- Typed views (of the last values read) ---
+    uint16_t duty(uint8_t motor) const;    // %
+    uint16_t current(uint8_t motor) const; // mA
+    int16_t temperature(uint8_t motor) const; // 1/100 °C, TEMP_REG_DISCONNECTED if no sensor
+    bool temperatureValid(uint8_t motor) const;
+    int16_t windingTemperature(uint8_t motor) const; // Estimate, 1/100 °C (readWindings)
+    MotorStatus status(uint8_t motor) const;
+    uint64_t timeMs() const; // TIME_LOW..+3, ms since START
+    int16_t airTemperature() const; // 1/100 °C
+    int16_t waterTemperature() const;
+    bool device(uint8_t index) const; // FAN, MIXER, DISPENSER, PUMP
+
+    // --- Link statistics ---
+    uint32_t replies = 0;
+    uint32_t timeouts = 0;
+    uint32_t crcErrors = 0;
+    uint32_t exceptions = 0;
+    uint8_t lastException = 0;
+    bool complete = false; // Every frame of the last cycle answered
+
+private:
+    friend class HwiMaster;
+
+    uint8_t slaveId;
+    uint16_t holdingRegs[HOLDING_REG_COUNT];
+    uint16_t inputRegs[INPUT_REG_COUNT];
+    std::vector<std::vector<uint8_t>> requests; // Prebuilt, one per plan frame
+};
+
+// Byte pipe to the bus
+class HwiTransport
+{
+public:
+    virtual ~HwiTransport() {}
+    virtual bool send(const uint8_t *data, size_t length) = 0;
+
+    // Reads up to `length` bytes, waiting at most `timeoutUs` for the first
+    virtual size_t receive(uint8_t *data, size_t length, uint32_t timeoutUs) = 0;
+
+    // Drops anything still buffered (after an error, to resynchronise)
+    virtual void discard() = 0;
+};
+
+// Linux serial port at any baud rate (termios2), 8E1, raw
+class HwiSerialPort : public HwiTransport
+{
+public:
+    ~HwiSerialPort();
+
+    bool open(const char *path, uint32_t baud = BAUDRATE);
+    void close();
+
+    bool send(const uint8_t *data, size_t length) override;
+    size_t receive(uint8_t *data, size_t length, uint32_t timeoutUs) override;
+    void discard() override;
+
+private:
+    int fd = -1;
+};
+
+class HwiMaster
+{
+public:
+    static constexpr uint32_t DEFAULT_TIMEOUT_US = 50000;
+
+    explicit HwiMaster(HwiTransport &transport);
+
+    // The reference is valid until the next addBoard()
+    HwiBoard &addBoard(uint8_t id);
+    size_t boardCount() const { return boards.size(); }
+    HwiBoard &board(size_t index) { return boards[index]; }
+
+    // --- Poll set (call plan() after changing it) ---
+    void read(HwiSpace space, uint16_t start, uint16_t count);
+    void readMotors();  // Currents, temperatures and statuses
+    void readDuties();
+    void readClock();
+    void readAmbient(); // Air and water temperature, device outputs
+    void readWindings(); // Estimated winding temperatures
+    void plan(uint16_t maxGap = HwiReadPlan::DEFAULT_MAX_GAP);
+    const std::vector<HwiSpan> &frames() const { return planned; }
+
+    // Polls every board once, round-robin; true when all of them answered
+    bool cycle();
+    uint32_t lastCycleUs() const { return cycleUs; }
+
+    // FC06 / FC16, mirrored into the board on success
+    bool write(HwiBoard &board, uint16_t reg, uint16_t value);
+    bool write(HwiBoard &board, uint16_t start, const uint16_t *values, uint16_t count);
+
+    uint32_t timeoutUs = DEFAULT_TIMEOUT_US;
+
+private:
+    // Sends `request` and reads a reply of `replyLength` bytes (or an exception)
+    bool transact(HwiBoard &board, const std::vector<uint8_t> &request, uint16_t replyLength);
+    void waitGap();
+
+    HwiTransport &transport;
+    HwiReadPlan readPlan;
+    std::vector<HwiSpan> planned;
+    std::vector<HwiBoard> boards;
+    uint8_t reply[5 + 2 * HwiReadPlan::MAX_READ];
+    uint64_t lineIdleAt = 0; // Monotonic µs of the last byte on the line
+    uint32_t cycleUs = 0;
+};
@@ -0,0 +1,93 @@
+// Polls one or more controllers with HwiMaster and prints the motor table
+// and the achieved refresh rate. Also a quick check of a deployment.
+//
+//   hwipoll <tty> <slave id>... [--cycles N] [--quiet]
+//
+// Build: g++ -std=gnu++11 -O2 -Iinclude host/HwiMaster.cpp host/hwipoll.cpp -o hwipoll
+// Against the bus simulator: scripts/bussim.cpp --pty prints a tty to use.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HwiMaster.h"
+
+static const char *const STATUS_NAMES[] = {"ok", "warn", "trip-T", "trip-I", "no-sensor"};
+
+static void printBoard(const HwiBoard &b)
+{
+    printf("board %u  t=%llu ms  air %.2f  water %.2f  %s\n", b.id(), (unsigned long long)b.timeMs(),
+           b.airTemperature() / 100.0, b.waterTemperature() / 100.0, b.complete ? "" : "(incomplete)");
+    for (uint8_t m = 0; m < MAX_MOTORS; m++)
+    {
+        MotorStatus s = b.status(m);
+        printf("  m%-2u duty %3u  I %5u  T ", m, b.duty(m), b.current(m));
+        if (b.temperatureValid(m))
+            printf("%7.2f", b.temperature(m) / 100.0);
+        else
+            printf("      -");
+        printf("  %s\n", s <= MOTOR_SENSOR_FAULT ? STATUS_NAMES[s] : "?");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <tty> <slave id>... [--cycles N] [--quiet]\n", argv[0]);
+        return 2;
+    }
+
+    HwiSerialPort port;
+    if (!port.open(argv[1]))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    HwiMaster master(port);
+    long cycles = 0;
+    bool quiet = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--cycles") && i + 1 < argc)
+            cycles = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--quiet"))
+            quiet = true;
+        else
+            master.addBoard(uint8_t(atoi(argv[i])));
+    }
+
+    master.readMotors();
+    master.readDuties();
+    master.readClock();
+    master.readAmbient();
+    master.plan();
+
+    printf("%zu boards, %zu frames per board:", master.boardCount(), master.frames().size());
+    for (const HwiSpan &f : master.frames())
+        printf(" FC%02u %u+%u", unsigned(f.space), f.start, f.count);
+    printf("\n");
+
+    uint64_t totalUs = 0;
+    for (long n = 0; cycles == 0 || n < cycles; n++)
+    {
+        master.cycle();
+        totalUs += master.lastCycleUs();
+        if (!quiet)
+        {
+            for (size_t i = 0; i < master.boardCount(); i++)
+                printBoard(master.board(i));
+            printf("cycle %.2f ms\n\n", master.lastCycleUs() / 1000.0);
+        }
+        if (cycles && n + 1 == cycles)
+            printf("%ld cycles, avg %.2f ms, %.1f Hz per board\n", cycles,
+                   totalUs / 1000.0 / cycles, 1e6 * cycles / totalUs);
+    }
+
+    for (size_t i = 0; i < master.boardCount(); i++)
+    {
+        const HwiBoard &b = master.board(i);
+        printf("board %u: %u replies, %u timeouts, %u CRC errors, %u exceptions\n", b.id(),
+               b.replies, b.timeouts, b.crcErrors, b.exceptions);
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+
+class SystemCore;
+
+// Cycle-exact markers for the simavr benchmark (env:bench, runner in
+// scripts/simbench.c). A marker is one OUT to GPIOR0, which the runner traps
+// with the simulator's cycle counter: a non-zero value opens a probe, 0
+// closes the innermost open one. Scopes may nest. Without BENCHMARK the
+// markers compile to nothing.
+class Benchmark
+{
+public:
+    enum Probe : uint8_t
+    {
+        END = 0,
+        CALIBRATE,   // Empty scope; its cost is subtracted from every probe
+        SET_DUTY,    // PWMController::setDutyCycle
+        MICROS,      // PWMController::microsCustom
+        MODBUS_TASK, // ModbusHandler::task
+        LOOP_PASS,   // SystemCore::loop
+    };
+
+    static inline void mark(uint8_t probe)
+    {
+#if defined(BENCHMARK)
+        GPIOR0 = probe;
+#else
+        (void)probe;
+#endif
+    }
+
+    class Scope
+    {
+    public:
+        explicit Scope(uint8_t probe) { mark(probe); }
+        ~Scope() { mark(END); }
+    };
+
+    // Replaces SystemCore::loop in the benchmark build: runs the single-call
+    // probes once, then wraps every loop pass
+    static void loop(SystemCore &core);
+
+private:
+    static void runMicroBenchmarks();
+    static bool primed;
+};
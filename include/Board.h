@@ -0,0 +1,131 @@
+#pragma once
+#include <Arduino.h> // Pin numbers (A0..) and NUM_DIGITAL_PINS
+
+// Motor board variants. Each BoardLayout<> lists the pins that drive, sense
+// and measure every motor; the build picks one with -DMOTOR_BOARD=<BoardId>
+// (see platformio.ini) and everything per motor sizes itself from
+// Board::MOTORS. The register map keeps MAX_MOTORS slots per block either
+// way, so a master addresses every variant the same.
+enum BoardId : uint8_t
+{
+    BOARD_MEGA15, // 15 motors: all 14 usable OC outputs plus pin 4 on SoftPWM
+    BOARD_MEGA9,  // 9 motors on the 16-bit timers 1, 3 and 4
+    BOARD_MEGA6,  // 6 motors on timers 3 and 4
+};
+
+// Output-compare channel behind a PWM pin (Arduino Mega pinout)
+enum PwmChannel : uint8_t
+{
+    PWM_NONE, // Not usable as a motor output
+    PWM_SOFT, // No OC output wired up; driven from Timer0 by SoftPWM
+    PWM_1A,
+    PWM_1B,
+    PWM_1C,
+    PWM_2A,
+    PWM_2B,
+    PWM_3A,
+    PWM_3B,
+    PWM_3C,
+    PWM_4A,
+    PWM_4B,
+    PWM_4C,
+    PWM_5A,
+    PWM_5B,
+    PWM_5C,
+};
+
+// Pins 0/1 and 18/19 carry Serial (Modbus) and Serial1 (telemetry)
+constexpr bool isSerialPin(uint8_t pin)
+{
+    return pin == 0 || pin == 1 || pin == 18 || pin == 19;
+}
+
+constexpr PwmChannel pwmChannel(uint8_t pin)
+{
+    return pin == 11   ? PWM_1A
+           : pin == 12 ? PWM_1B
+           : pin == 13 ? PWM_1C
+           : pin == 10 ? PWM_2A
+           : pin == 9  ? PWM_2B
+           : pin == 5  ? PWM_3A
+           : pin == 2  ? PWM_3B
+           : pin == 3  ? PWM_3C
+           : pin == 6  ? PWM_4A
+           : pin == 7  ? PWM_4B
+           : pin == 8  ? PWM_4C
+           : pin == 46 ? PWM_5A
+           : pin == 45 ? PWM_5B
+           : pin == 44 ? PWM_5C
+           : pin < NUM_DIGITAL_PINS && !isSerialPin(pin) ? PWM_SOFT
+                                                          : PWM_NONE;
+}
+
+// --- Compile-time checks over a pin list ---
+
+constexpr bool pwmPinsValid(const uint8_t *pins, uint8_t n)
+{
+    return n == 0 || (pwmChannel(pins[0]) != PWM_NONE && pwmPinsValid(pins + 1, n - 1));
+}
+
+constexpr uint8_t softPwmCount(const uint8_t *pins, uint8_t n)
+{
+    return n == 0 ? 0 : (pwmChannel(pins[0]) == PWM_SOFT) + softPwmCount(pins + 1, n - 1);
+}
+
+constexpr bool pinAbsent(uint8_t pin, const uint8_t *pins, uint8_t n)
+{
+    return n == 0 || (pins[0] != pin && pinAbsent(pin, pins + 1, n - 1));
+}
+
+constexpr bool pinsDistinct(const uint8_t *pins, uint8_t n)
+{
+    return n == 0 || (pinAbsent(pins[0], pins + 1, n - 1) && pinsDistinct(pins + 1, n - 1));
+}
+
+template <BoardId ID>
+struct BoardLayout;
+
+template <>
+struct BoardLayout<BOARD_MEGA15>
+{
+    static constexpr uint8_t MOTORS = 15;
+    // Motor control PWM output pins (hardware OCR outputs; pin 4 runs on SoftPWM)
+    static constexpr uint8_t PWM_PINS[MOTORS] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 44, 45, 46};
+    // Motor current sensor analog input pins (ACS712 or similar)
+    static constexpr uint8_t CURRENT_PINS[MOTORS] = {A0, A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11, A12, A13, A14};
+    // Motor temperature DS18B20 sensor digital input pins
+    static constexpr uint8_t TEMP_PINS[MOTORS] = {22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36};
+};
+
+template <>
+struct BoardLayout<BOARD_MEGA9>
+{
+    static constexpr uint8_t MOTORS = 9;
+    static constexpr uint8_t PWM_PINS[MOTORS] = {2, 3, 5, 6, 7, 8, 11, 12, 13};
+    static constexpr uint8_t CURRENT_PINS[MOTORS] = {A0, A1, A2, A3, A4, A5, A6, A7, A8};
+    static constexpr uint8_t TEMP_PINS[MOTORS] = {22, 23, 24, 25, 26, 27, 28, 29, 30};
+};
+
+template <>
+struct BoardLayout<BOARD_MEGA6>
+{
+    static constexpr uint8_t MOTORS = 6;
+    static constexpr uint8_t PWM_PINS[MOTORS] = {2, 3, 5, 6, 7, 8};
+    static constexpr uint8_t CURRENT_PINS[MOTORS] = {A0, A1, A2, A3, A4, A5};
+    static constexpr uint8_t TEMP_PINS[MOTORS] = {22, 23, 24, 25, 26, 27};
+};
+
+#ifndef MOTOR_BOARD
+#define MOTOR_BOARD BOARD_MEGA15
+#endif
+
+typedef BoardLayout<MOTOR_BOARD> Board;
+
+static_assert(pwmPinsValid(Board::PWM_PINS, Board::MOTORS),
+              "Every PWM pin needs an OC channel or a free digital pin for SoftPWM");
+static_assert(pinsDistinct(Board::PWM_PINS, Board::MOTORS), "Two motors share a PWM pin");
+static_assert(pinsDistinct(Board::CURRENT_PINS, Board::MOTORS), "Two motors share a current pin");
+static_assert(pinsDistinct(Board::TEMP_PINS, Board::MOTORS), "Two motors share a 1-Wire pin");
+
+// Motors that fall back to the Timer0 software engine
+constexpr uint8_t SOFT_PWM_MOTORS = softPwmCount(Board::PWM_PINS, Board::MOTORS);
@@ -1,34 +1,15 @@
 #pragma once
 #include <Arduino.h> // Needed for pin constants
-
-// Error codes
-enum ErrorCode
-{
-    ERR_NO_ERROR = 0,
-    ERR_TEMP_LOW = 1,
-    ERR_TEMP_HIGH = 2,
-    ERR_SENSOR_DISCONNECTED = 3,
-    ERR_OVERCURRENT = 4,
-    ERR_MODBUS_CRC_FAIL = 5,
-    ERR_MODBUS_TIMEOUT = 6
-};
-
-// Serial port configuration
-constexpr uint32_t BAUDRATE = 250000;
+#include "RegisterMap.h"
+#include "Board.h"
 
 // -------------------------
 // Pin Configuration
 // -------------------------
 
-// Motor control PWM output pins (software/hardware PWM)
-constexpr uint8_t PWM_PINS[15] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 44, 45, 46};
 constexpr uint8_t SLAVE_ID = 1;
 
-// Motor current sensor analog input pins (ACS712 or similar)
-constexpr uint8_t CURRENT_PINS[15] = {A0, A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11, A12, A13, A14};
-
-// Motor temperature DS18B20 sensor digital input pins
-constexpr uint8_t TEMP_PINS[15] = {22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36};
+// Per-motor PWM, current and 1-Wire pins come from the board (Board.h)
 
 // System-wide sensors (also digital pins)
 constexpr uint8_t WATER_TEMP_PIN = 20; // ⚠️ Also I2C SDA
@@ -40,61 +21,49 @@ constexpr uint8_t MIXER_PIN = 41;
 constexpr uint8_t DISPENSER_PIN = 42;
 constexpr uint8_t PUMP_PIN = 43;
 
-// -------------------------
-// Modbus Register Map
-// -------------------------
-namespace ModbusHoldingReg
-{
-
-    // --- Motor Parameters ---
-    // Holding Registers (writeable by master)
-    constexpr uint16_t DUTY_BASE = 1; // Holding: [1–15] — duty cycle control
-    constexpr uint16_t GLOBAL_FREQ = 0;
-
-    // Thresholds (Holding registers, writeable by master)
-    constexpr uint16_t MOTOR_TEMP_CRIT = 61;
-    constexpr uint16_t MOTOR_CURR_CRIT = 62;
-
-    // --- System Parameters ---
-    constexpr uint16_t START_REG_ADDR = 65;
-
-    // Air Temp
-    constexpr uint16_t AIR_TEMP_REG = 70;
-    constexpr uint16_t AIR_TEMP_LIMIT = 72;
-
-    // Water Temp
-    constexpr uint16_t WATER_TEMP_REG = 80;
-    constexpr uint16_t WATER_TEMP_LIMIT = 82;
-
-}
-
-namespace ModbusInputReg
-{
-    // Input Registers (read-only to master)
-    constexpr uint16_t CURR_BASE = 16;   // Input: [16–30] — motor current values
-    constexpr uint16_t TEMP_BASE = 31;   // Input: [31–45] — motor temperature values
-    constexpr uint16_t STATUS_BASE = 46; // Input: [46–60] — motor status (e.g. overtemp, error)
-
-    constexpr uint16_t DEV_STATUS_BASE = 90;
-    constexpr uint16_t TIME_LOW = 66;
-
-    // --- Device States ---
-    constexpr uint16_t FAN_REG = 91;
-    constexpr uint16_t MIXER_REG = 92;
-    constexpr uint16_t DISPENSER_REG = 93;
-    constexpr uint16_t PUMP_REG = 94;
-}
-
 // -------------------------
 // Safety & Operational Limits
 // -------------------------
 
-constexpr uint8_t NUM_MOTORS = 15;
+constexpr uint8_t NUM_MOTORS = Board::MOTORS;
+static_assert(NUM_MOTORS <= MAX_MOTORS, "Board has more motors than the register map has slots");
 
 // Temperature values scaled (e.g., 5000 = 50.00°C if using hundredths of °C)
 constexpr uint16_t TEMP_WARNING = 5000;
 constexpr uint16_t TEMP_CRITICAL = 6000;
-constexpr uint16_t CURR_CRITICAL = 9000; // mA or raw sensor units
+constexpr uint16_t CURR_CRITICAL = 9000; // mA
+constexpr uint8_t DERATE_DUTY = 50;      // Duty cap (%) while a motor is in MOTOR_WARNING
+
+// Current sensing. The ADC reference is shared by all channels; the ACS712
+// idles at Vcc/2, so it has to be the 5 V supply.
+constexpr uint8_t CURR_ADC_REFERENCE = DEFAULT;
+constexpr uint16_t CURR_DEFAULT_OFFSET = 512;  // ADC counts at 0 A
+constexpr uint16_t CURR_DEFAULT_GAIN = 18939;  // mA per count, Q8: ACS712-30A (66 mV/A) at 5 V
+
+// Winding model defaults (ThermalModel)
+constexpr uint16_t THERMAL_DEFAULT_TAU = 30;   // s, winding to case
+constexpr uint16_t THERMAL_DEFAULT_RISE = 1500; // 1/100 °C over the case at 10 A
+
+// Closed-loop controller defaults
+constexpr uint16_t CTRL_DEFAULT_KP = 221; // 0.0034 % duty per mA (0.25 % per ADC count)
+constexpr uint16_t CTRL_DEFAULT_KI = 5500; // per second (55 per 10 ms step)
+constexpr uint16_t CTRL_DEFAULT_KD = 0;
+constexpr uint16_t CTRL_DEFAULT_PERIOD = 10; // ms
+
+// EEPROM layout (4 KB on the ATmega2560)
+constexpr uint16_t EEPROM_PROFILE_ADDR = 0x000; // Duty profile header + steps
+constexpr uint16_t EEPROM_CONFIG_ADDR = 0x800;  // Persistent config record slots
+constexpr uint8_t EEPROM_CONFIG_SLOTS = 8;       // Records rotate across slots for wear levelling
+constexpr uint8_t PROFILE_MAX_STEPS = 100;
+
+// Event log ring (RAM)
+constexpr uint8_t EVENT_LOG_ENTRIES = 32;   // Power of two, 12 bytes each
+constexpr uint8_t EVENT_WINDOW_ENTRIES = 4; // Entries per readout window
+
+// History ring (RAM)
+constexpr uint16_t HISTORY_BYTES = 1024;           // Power of two; ~30 records at 1 byte per steady value
+constexpr uint8_t HISTORY_WINDOW_SIZE = 32;        // Registers per readout window
+constexpr uint16_t HISTORY_DEFAULT_PERIOD = 500;   // ms
 
 // PWM frequency range (Hz)
 constexpr uint16_t MIN_PWM_FREQ = 100;
@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Persistent configuration. A fixed set of holding registers (thresholds,
+// limits, frequency, duties, controller settings, current calibration,
+// winding model) is saved as one versioned, CRC-protected record. Records rotate through
+// EEPROM_CONFIG_SLOTS slots with an increasing sequence number, so each
+// save wears a different slot
+// and an interrupted write leaves the previous record intact. At boot the
+// newest valid record is copied straight into the register image.
+//
+// Writing 1 to CONFIG_COMMIT saves the current registers; the register
+// reads 0 once the record is in EEPROM, or 0xFFFF if the command is unknown.
+// A commit written while a save is in progress is queued and saves the
+// registers as they are then; the register stays 1 until that one is done.
+class ConfigStore
+{
+public:
+    enum Status : uint8_t
+    {
+        DEFAULTS = 0, // No valid record, compile-time defaults in use
+        RESTORED = 1, // Registers restored from EEPROM at boot
+        SAVING = 2,
+        SAVED = 3
+    };
+
+    static constexpr uint8_t VERSION = 4; // 2: current calibration, 3: winding model, 4: CTRL_KI per second
+    static constexpr uint8_t SLOT_SIZE = 192; // Slot pitch, leaves room for the record to grow
+
+    // Restores the newest valid record into the holding registers. Call
+    // after ModbusHandler::begin() has written the defaults.
+    static void begin();
+
+    static void requestCommit(uint16_t cmd);
+
+    // Starts and completes saves through EepromWriter
+    static void service();
+
+private:
+    // Holding registers covered by the record, as contiguous ranges
+    struct Range
+    {
+        uint16_t first;
+        uint8_t count;
+    };
+    static const Range RANGES[];
+    static constexpr uint8_t VALUE_COUNT = 1 + 2 * NUM_MOTORS + 5 + 1 + 2 + 1 + 1 + 2 * NUM_MOTORS + NUM_MOTORS + 1; // Sum of RANGES
+    static constexpr uint8_t rangeTotal(uint8_t i = 0); // Checked against VALUE_COUNT
+
+    struct Record
+    {
+        uint16_t magic;
+        uint8_t version;
+        uint8_t count; // VALUE_COUNT when written
+        uint32_t sequence;
+        uint16_t values[VALUE_COUNT];
+        uint16_t crc; // CRC-16 over everything above
+    };
+
+    static uint16_t slotAddress(uint8_t slot);
+    static uint16_t checksum(const Record &r);
+    static bool readSlot(uint8_t slot, Record &r);
+    static void capture(uint16_t *values);
+    static void publish();
+
+    static Record record; // Newest record; source buffer while saving
+    static uint8_t slot;  // Slot holding `record`
+    static bool valid;    // `record` came from / went to EEPROM
+    static bool commitRequested;
+    static bool saving;
+    static Status status;
+};
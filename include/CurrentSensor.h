@@ -1,24 +1,41 @@
 #pragma once
 #include <Arduino.h>
+#include "Config.h"
 
-
+// Analog motor current sensing (ACS712 or similar). Pins come from
+// CURRENT_PINS and readings live in motorTable; the only state kept here
+// is the auto-zero in progress.
+//
+// Each conversion goes through an integer EMA (1/4, counts in Q4) and the
+// channel calibration, mA = (filtered - offset) * gain / 256, clamped to
+// 0–65535. Offset (ADC counts at 0 A) and gain (mA per count, Q8) are the
+// CURR_OFFSET_BASE / CURR_GAIN_BASE holding registers, saved by ConfigStore.
+//
+// Auto-zero: writing a motor mask to CURR_ZERO averages ZERO_SAMPLES raw
+// conversions per masked channel while its output stays at 0 and stores
+// the mean as the offset. Bits clear as channels finish and the register
+// reads 0 when all are done; channels that were driven meanwhile keep
+// their offset and are listed in CURR_ZERO_FAILED.
 class CurrentSensor
 {
 public:
-    CurrentSensor(uint8_t pin, uint16_t regAddr);
-    void begin();
-    void update(uint64_t now);
-    float getCurrent() const;
-    void setSmoothingFactor(float factor);
+    static void begin(uint8_t id);
+    static void update(uint8_t id, uint64_t now); // Samples once SAMPLE_INTERVAL has elapsed
+    static uint16_t sample(uint8_t id);           // Immediate conversion, returns mA
+    static uint16_t getCurrent(uint8_t id);
+
+    static void setCalibration(uint8_t id, uint16_t offset, uint16_t gain);
+    static void startZero(uint16_t mask); // Ignored while a zero is running
 
 private:
-    uint8_t pin;
-    uint16_t regAddr;
-    float filteredValue;
-    float smoothingFactor;
-    uint32_t lastSampleTime;
-    float current;
+    static constexpr uint16_t SAMPLE_INTERVAL = 10; // ms
+    static constexpr uint8_t ZERO_SAMPLES = 16;     // 0.8 s at the 50 ms motors task pace
+
+    static void zeroStep(uint8_t id, uint16_t raw);
+    static void zeroDone(uint8_t id, bool ok);
 
-    static constexpr uint32_t SAMPLE_INTERVAL = 10; // ms
-    static constexpr float DEFAULT_SMOOTHING = 0.15f;
-};
\ No newline at end of file
+    static uint16_t zeroMask;   // Channels still collecting
+    static uint16_t zeroFailed; // Channels driven while collecting
+    static uint16_t zeroSum[NUM_MOTORS];
+    static uint8_t zeroCount[NUM_MOTORS];
+};
@@ -1,19 +1,52 @@
 #pragma once
+#include <avr/io.h>
 #include "TemperatureSensor.h"
-#include "Motor.h"
+#include "Config.h"
 
+// Auxiliary actuators (fan, mixer, dispenser, pump). The four outputs are
+// kept as one bitmask and driven with direct masked writes to PORTG/PORTL
+// inside a single critical section, so they switch together and only
+// outputs that actually changed touch the ports and input registers.
 class DeviceManager
 {
 public:
+    enum Device : uint8_t
+    {
+        FAN = 0,
+        MIXER,
+        DISPENSER,
+        PUMP,
+        DEVICE_COUNT
+    };
+
+    static constexpr uint8_t ALL_DEVICES = (1 << DEVICE_COUNT) - 1;
+
+    // Drives all outputs low; usable before Modbus is up
+    void forceOff();
+
     void begin();
 
-    // Changed third parameter type to const Motor* const*
+    // Automatic control from the air/water sensors and motor activity
     void update(const TemperatureSensor &airSensor,
-                const TemperatureSensor &waterSensor,
-                const Motor *const *motors); // Fixed parameter type
-
-    void controlFan(bool state);
-    void controlMixer(bool state);
-    void controlDispenser(bool state);
-    void controlPump(bool state);
-};
\ No newline at end of file
+                const TemperatureSensor &waterSensor);
+
+    // Drives the devices selected in `mask` to the matching bits of `state`
+    void setOutputs(uint8_t mask, uint8_t state);
+    void setOutput(Device dev, bool on) { setOutputs(1 << dev, on ? 1 << dev : 0); }
+    uint8_t getOutputs() const { return outputs; }
+
+    // Cached limits, pushed by ModbusHandler when the holding registers change
+    void setAirLimit(uint16_t limit) { airLimit = limit; }
+    void setWaterLimit(uint16_t limit) { waterLimit = limit; }
+
+private:
+    // Port bits of the device pins (Mega 2560: 40 = PG1, 41 = PG0, 42 = PL7, 43 = PL6)
+    static constexpr uint8_t FAN_PORTG = _BV(PG1);
+    static constexpr uint8_t MIXER_PORTG = _BV(PG0);
+    static constexpr uint8_t DISPENSER_PORTL = _BV(PL7);
+    static constexpr uint8_t PUMP_PORTL = _BV(PL6);
+
+    uint8_t outputs = 0; // Bit per Device
+    uint16_t airLimit = TEMP_CRITICAL;
+    uint16_t waterLimit = TEMP_WARNING;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Time-scheduled duty sequence stored in EEPROM and executed on-board.
+// The master uploads steps through the PROFILE_* holding-register window
+// (INDEX, TIME, DUTY[], then COMMIT); after START_REG_ADDR resets the clock,
+// each step is applied when PWMController::millisCustom() reaches its offset.
+class DutyProfile
+{
+public:
+    enum State : uint8_t
+    {
+        IDLE = 0,
+        RUNNING = 1,
+        FINISHED = 2,
+        ERROR = 3
+    };
+
+    // PROFILE_COMMIT commands
+    enum Command : uint8_t
+    {
+        CMD_NONE = 0,
+        CMD_STORE_STEP = 1, // window -> EEPROM step at PROFILE_INDEX
+        CMD_LOAD_STEP = 2,  // EEPROM step at PROFILE_INDEX -> window
+    };
+
+    struct Step
+    {
+        uint32_t timeMs; // Offset from START
+        uint8_t duty[NUM_MOTORS];
+    };
+
+    // Restores the stored profile length
+    static void begin();
+
+    static void requestCommand(uint16_t cmd);
+    static void setLength(uint16_t length);
+
+    static void start();
+    static void stop();
+
+    // Services pending commands and applies due steps. Reads the clock
+    // itself, since START may have reset it earlier in the same loop pass.
+    static void poll();
+
+private:
+    struct Header
+    {
+        uint16_t magic;
+        uint8_t length;
+        uint8_t reserved;
+    };
+
+    static uint16_t stepAddress(uint8_t index);
+    static void serviceCommand();
+    static void loadStep(uint8_t index, Step &step);
+    static void publish();
+
+    static Header header;
+    static Step staged;  // Upload buffer, owned by EepromWriter while busy
+    static Step pending; // Next step to apply while running
+    static uint8_t nextStep;
+    static uint8_t command;
+    static bool storing;
+    static bool headerDirty;
+    static State state;
+};
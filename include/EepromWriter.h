@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+// Background EEPROM writer. A byte write takes ~3.3 ms on the ATmega2560, so
+// blocking writes would stall Modbus; service() is called once per loop and
+// programs at most one byte, skipping bytes that already hold the value.
+// The source buffer is not copied and must stay untouched while busy().
+class EepromWriter
+{
+public:
+    static bool write(uint16_t addr, const void *src, uint16_t len);
+    static bool busy();
+    static void service();
+
+private:
+    static const uint8_t *source;
+    static uint16_t address;
+    static uint16_t remaining;
+};
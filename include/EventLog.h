@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// RAM ring of timestamped faults and state changes, so an intermittent
+// field fault can be diagnosed over Modbus after the fact.
+//
+// Every event gets a 16-bit sequence number. EVENT_HEAD is the sequence the
+// next event will take; the master reads from its cursor (holding
+// EVENT_CURSOR) and sees EVENT_WINDOW_ENTRIES entries from there at
+// EVENT_WINDOW_BASE, WINDOW_REGS registers each:
+//   time (ms since START, 64-bit, low word first) x4,
+//   code (low byte) | motor (high byte), value
+// Entries at or past EVENT_HEAD read 0. After reading n entries it writes
+// cursor + n. A cursor older than the oldest kept entry is moved up to it
+// and the overwritten entries are counted in EVENT_LOST; one past the head
+// is moved back to it. EVENT_CURSOR_USED shows the cursor in effect.
+//
+// Codes are ErrorCode (faults) and EventCode (state changes), see
+// RegisterMap.h. The timestamp shares TIME_LOW's clock, which START resets;
+// the START event itself marks the jump.
+class EventLog
+{
+public:
+    static constexpr uint8_t NO_MOTOR = 0xFF;
+    static constexpr uint8_t WINDOW_REGS = 6;
+
+    struct Entry
+    {
+        uint32_t timeLow; // ms
+        uint32_t timeHigh;
+        uint8_t code;
+        uint8_t motor; // Motor or sensor index, device mask owner, NO_MOTOR
+        uint16_t value;
+    };
+
+    static void begin();
+
+    // Appends an event, overwriting the oldest once the ring is full
+    static void log(uint8_t code, uint8_t motor = NO_MOTOR, uint16_t value = 0);
+
+    static void setCursor(uint16_t sequence);
+
+    // Copies entry `sequence`; false if not (or no longer) in the ring
+    static bool get(uint16_t sequence, Entry &entry);
+    static uint16_t headSequence() { return head; }
+
+private:
+    static void publish();
+
+    static Entry ring[EVENT_LOG_ENTRIES];
+    static uint16_t head;   // Sequence of the next entry
+    static uint16_t cursor; // Master's read position, within the ring
+    static uint16_t lost;   // Unread entries overwritten
+    static uint8_t count;   // Entries held, up to EVENT_LOG_ENTRIES
+};
@@ -6,4 +6,4 @@
 
 extern ModbusHandler *modbusHandler;
 extern DeviceManager *deviceManager;
-extern Motor **motors; // Changed from Motor* to Motor**
\ No newline at end of file
+extern Motor *motors; // SystemCore::motors, indexed by motor id
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// On-board history of per-motor current and temperature, so the master can
+// backfill a gap after dropping off the bus.
+//
+// Every HISTORY_PERIOD ms one record is appended to a RAM ring:
+//   zigzag varint  dt (ms since the previous record, on the uptime clock)
+//   zigzag varint  current delta  x NUM_MOTORS
+//   zigzag varint  temperature delta x NUM_MOTORS
+// Deltas are taken against the previous record, so a steady value costs one
+// byte. When the ring is full the oldest record is folded into a keyframe
+// (absolute time and values just before the oldest stored record).
+//
+// Readout: write 1 to HISTORY_CTRL to open a snapshot (keyframe + stream as
+// it stands), then move HISTORY_OFFSET over [0, HISTORY_LENGTH) and read
+// HISTORY_WINDOW_SIZE registers at HISTORY_WINDOW_BASE each time, two
+// stream bytes per register, first byte in the high half. The keyframe is
+// KEYFRAME_BYTES long: time (ms since boot, 64-bit, LSB first; START does
+// not reset it, so place records by HISTORY_AGE_MS rather than TIME_LOW),
+// then currents and
+// temperatures as little-endian 16-bit values. HISTORY_STATE reads STALE if
+// the window reached bytes that were overwritten since the snapshot.
+class History
+{
+public:
+    enum State : uint8_t
+    {
+        CLOSED = 0,
+        OPEN = 1,
+        STALE = 2 // Snapshot overtaken by the writer; open a new one
+    };
+
+    static constexpr uint8_t CHANNELS = 2 * NUM_MOTORS;        // Currents, then temperatures
+    static constexpr uint8_t KEYFRAME_BYTES = 8 + 2 * CHANNELS; // Time + values
+
+    // Appends one record from motorTable
+    static void sample();
+
+    static void open();
+    static void setOffset(uint16_t offset);
+
+private:
+    static uint8_t encode(uint8_t *out, int32_t value);
+    static uint8_t decode(uint32_t &pos, int32_t &value);
+    static void evictOldest();
+    static void current(uint16_t *values);
+    static void fillWindow();
+    static uint8_t streamByte(uint16_t offset);
+
+    // Ring of encoded records; positions are absolute byte counts (masked on access)
+    static uint8_t ring[HISTORY_BYTES];
+    static uint32_t head;
+    static uint32_t tail;
+    static uint16_t records;
+
+    static uint64_t lastTime; // Newest record
+    static uint16_t last[CHANNELS];
+    static uint64_t baseTime; // State before the oldest record
+    static uint16_t base[CHANNELS];
+
+    // Open snapshot
+    static uint8_t keyframe[KEYFRAME_BYTES];
+    static uint32_t snapStart;
+    static uint32_t snapEnd;
+    static uint16_t offset;
+    static State state;
+};
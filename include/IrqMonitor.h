@@ -0,0 +1,115 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "PWMController.h"
+
+// Interrupt-latency and critical-section instrumentation, all timed with
+// Timer2 ticks (the timebase counter), so it costs two TCNT2 reads.
+//
+//   - TIMER2_OVF entry latency: TOV2 is set as the count wraps to BOTTOM,
+//     so TCNT2 at the top of the ISR is how long the overflow waited. The
+//     vector jump and prologue run before the read, a bias of a few cycles:
+//     up to two ticks at clk/1 and clk/8, under one tick from clk/32 up.
+//     Overflows found with the next one already pending were served more
+//     than a period late; one more and a tick is lost for good.
+//   - Interrupts-off windows of the firmware's own critical sections
+//     (Critical guards); the longest one and its Site are kept.
+//   - Timebase reads that went backwards (outside clearCount()).
+//
+// The core owns USART0_RX_vect, so RX latency is bounded instead of
+// measured: RX sits below TIMER2_OVF in vector priority, and the receiver
+// holds two characters plus the one shifting in, so any wait longer than
+// RX_BUDGET_US (two character times) risks an overrun. Latencies and
+// windows above it are counted in IRQ_OVER_BUDGET. Library code that
+// masks interrupts (OneWire bit slots) is not guarded but shows up in the
+// Timer2 latency. Published by the diagnostics task; DIAG_RESET clears.
+class IrqMonitor
+{
+public:
+    enum Site : uint8_t
+    {
+        SITE_NONE = 0,
+        SITE_TIMEBASE, // microsCustom / millisCustom / cycles
+        SITE_PWM_DUTY, // PWMController::setDutyCycle OCR write
+        SITE_SOFT_PWM, // SoftPWM schedule hand-over
+        SITE_DEVICES,  // DeviceManager port write
+    };
+
+    static constexpr uint16_t CHAR_US = 11000000UL / BAUDRATE; // 8E1 + start bit
+    static constexpr uint16_t RX_BUDGET_US = 2 * CHAR_US;
+
+    // Interrupts off for the guard's scope, restored (not forced on) after
+    class Critical
+    {
+    public:
+        explicit Critical(uint8_t site) : sreg(SREG), site(site)
+        {
+            cli();
+            start = TCNT2;
+            pending = TIFR2 & _BV(TOV2);
+        }
+        ~Critical()
+        {
+            uint8_t end = TCNT2;
+            uint16_t ticks = (uint8_t)(end - start);
+            if (!pending && (TIFR2 & _BV(TOV2)) && end >= start)
+                ticks += 256; // Wrapped once in between
+            IrqMonitor::window(site, ticks);
+            SREG = sreg;
+        }
+
+    private:
+        uint8_t sreg;
+        uint8_t site;
+        uint8_t start;
+        uint8_t pending;
+    };
+
+    // First thing in TIMER2_OVF_vect
+    static inline void timer2Entry()
+    {
+        uint8_t ticks = TCNT2; // Since the wrap
+        if (ticks > t2MaxTicks)
+            t2MaxTicks = ticks;
+        if (TIFR2 & _BV(TOV2))
+            t2Late++;
+        if (ticks > budgetTicks)
+            overBudget++;
+    }
+
+    // RX_BUDGET_US in Timer2 ticks; PWMController calls this on every
+    // prescaler change
+    static void setTickScale(uint16_t usPerTickQ8);
+
+    // Runs with interrupts still off
+    static inline void window(uint8_t site, uint16_t ticks)
+    {
+        uint32_t usQ8 = (uint32_t)ticks * PWMController::_usPerTickQ8;
+        if (usQ8 > windowMaxUsQ8)
+        {
+            windowMaxUsQ8 = usQ8;
+            windowMaxSite = site;
+        }
+        if (usQ8 > (uint32_t)RX_BUDGET_US << 8)
+            overBudget++;
+    }
+
+    // Timebase monotonicity, fed by the PWMController readers
+    static inline void checkTime(uint64_t value, uint64_t &last)
+    {
+        if (value < last)
+            backwards++;
+        last = value;
+    }
+
+    static void publish();
+    static void reset();
+
+    static volatile uint8_t t2MaxTicks;
+    static volatile uint16_t t2Late;
+    static volatile uint16_t overBudget;
+    static uint8_t budgetTicks;
+    static uint32_t windowMaxUsQ8;
+    static uint8_t windowMaxSite;
+    static uint16_t backwards;
+};
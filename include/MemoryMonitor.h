@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+
+// SRAM high-water-mark instrumentation. The free region between .bss and
+// the top of RAM is painted with CANARY before constructors run; the
+// deepest byte the stack ever overwrote gives the peak stack depth, and
+// the distance from the heap top to the lowest touched byte is the worst
+// headroom seen since boot.
+//
+// Published at ModbusInputReg::MEM_FREE..MEM_STATIC and in the Serial1 dump.
+class MemoryMonitor
+{
+public:
+    static constexpr uint8_t CANARY = 0xC5;
+
+    // Rescans the painted region and publishes the input registers
+    static void update();
+
+    // Bytes between the heap top and the current stack pointer
+    static uint16_t freeRam();
+
+    // Deepest stack extent since boot, in bytes below RAMEND
+    static uint16_t stackPeak() { return stackPeakBytes; }
+
+    // Smallest heap/stack gap since boot (untouched canary bytes)
+    static uint16_t minHeadroom() { return minHeadroomBytes; }
+
+    static uint16_t heapUsed();
+    static uint16_t staticRam(); // .data + .bss
+
+private:
+    static uint8_t *heapTop();
+    static void publish();
+
+    static uint8_t *heapHigh; // Highest heap top seen; freed heap is not canary again
+    static uint8_t *stackLow; // Lowest address the stack is known to have touched
+    static uint16_t stackPeakBytes;
+    static uint16_t minHeadroomBytes;
+};
@@ -15,6 +15,13 @@ private:
     uint16_t globalFreqShadow;
     uint16_t deviceShadows[4];
     uint16_t startShadow;
+    uint16_t profileLengthShadow;
+    uint16_t airLimitShadow;
+    uint16_t waterLimitShadow;
+    uint16_t historyOffsetShadow;
+    uint16_t traceCtrlShadow;
+    uint16_t eventCursorShadow;
+    bool rescanPending;
 
     static constexpr uint8_t BUFFER_SIZE = 64;
     static uint8_t modbusBuffer[BUFFER_SIZE];
@@ -24,13 +31,20 @@ private:
 public:
     ModbusHandler(HardwareSerial &portRef, uint8_t slaveRef);
     void begin(unsigned long baudrate = BAUDRATE);
-    void task();
+    // Returns false when there was no request to serve and nothing to rescan
+    bool task();
 
     uint16_t getHreg(uint16_t addr);
     uint16_t getIreg(uint16_t addr);
     void setHreg(uint16_t addr, uint16_t value);
     void setIreg(uint16_t addr, uint16_t value);
 
+    // Applies a duty on behalf of the firmware, keeping register and shadow in sync
+    void setDuty(uint8_t id, uint16_t duty);
+
+    // Runs the register change scan on the next task() even without a request
+    void requestRescan() { rescanPending = true; }
+
     void handleMotorWrite(uint16_t addr, uint16_t val);
     void handleDeviceWrite(int addr, uint16_t val);
     void handleSystemWrite(int addr, uint16_t val);
@@ -1,30 +1,33 @@
 #pragma once
 #include <Arduino.h>
-#include "TemperatureSensor.h"
-#include "CurrentSensor.h" // Add include
-
-class ModbusHandler;
+#include "PIDController.h"
 
+// Handle for one motor output. All per-motor state lives in motorTable;
+// the object itself only carries its index.
 class Motor
 {
 public:
-    Motor(uint8_t id, uint8_t pwmPin, uint8_t currentPin,
-          TemperatureSensor *tempSensor, ModbusHandler &modbus);
+    Motor();
+    void attach(uint8_t id);
     void begin();
     void update(uint64_t now);
     void setDuty(uint16_t duty);
     void setFrequency(uint32_t freq);
+
+    // Closed-loop current control; open-loop duty is restored when disabled
+    void setClosedLoop(bool enable);
+    void control(int16_t setpoint, const PIDController::Gains &gains);
+
+    // Output cap (0–100 %) set by the protection engine
+    void setDutyLimit(uint8_t limit);
+
     uint8_t getStatus() const;
     float getDuty() const;
     float getTemp() const;
     float getCurr() const;
 
 private:
+    void applyOutput(uint16_t duty);
+
     uint8_t id;
-    uint8_t pwmPin;
-    CurrentSensor currentSensor; // Replace currentPin with CurrentSensor
-    TemperatureSensor *tempSensor;
-    ModbusHandler &modbusHandler;
-    uint16_t dutyCycle;
-    uint8_t status;
-};
\ No newline at end of file
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "PIDController.h"
+
+// Hot per-motor state as statically sized struct-of-arrays. Motor,
+// CurrentSensor and Protection are thin views over this table, so a pass
+// over all motors walks a few dense arrays instead of 15 heap objects.
+struct MotorTable
+{
+    // --- Output stage ---
+    uint16_t dutyCycle[NUM_MOTORS];  // Open-loop duty requested by the master
+    uint16_t outputDuty[NUM_MOTORS]; // Last duty before the protection cap
+    uint8_t dutyLimit[NUM_MOTORS];   // Protection cap (0–100 %)
+    uint16_t closedLoop;             // Bit i = motor i under current control
+    PIDController pid[NUM_MOTORS];
+
+    // --- Current sensing ---
+    uint16_t current[NUM_MOTORS];       // mA, mirrored to CURR_BASE
+    uint16_t lastSample[NUM_MOTORS];    // ms (low 16 bits) of the last conversion
+    uint16_t adcFiltered[NUM_MOTORS];   // EMA of the ADC counts, Q4
+    uint16_t currentOffset[NUM_MOTORS]; // ADC counts at 0 A (CURR_OFFSET_BASE)
+    uint16_t currentGain[NUM_MOTORS];   // mA per count, Q8 (CURR_GAIN_BASE)
+
+    // --- Temperature ---
+    int16_t temperature[NUM_MOTORS]; // 1/100 °C
+    uint16_t sensorFault;            // Bit i = motor i sensor disconnected
+
+    // --- Winding model (ThermalModel) ---
+    int16_t windingRise[NUM_MOTORS];   // Over the case, 1/100 °C
+    int32_t riseRemainder[NUM_MOTORS]; // 1/100 °C × ms not yet applied
+    uint16_t lastModel[NUM_MOTORS];    // ms (low 16 bits) of the last step
+
+    // --- Protection ---
+    uint8_t status[NUM_MOTORS]; // MotorStatus, mirrored to STATUS_BASE
+    uint16_t tripped;           // Latched trips
+    uint16_t idle;              // Bit i = master command for motor i is 0
+};
+
+// Bits of the per-motor masks that map to a motor
+constexpr uint16_t MOTOR_MASK = (uint16_t)((1UL << NUM_MOTORS) - 1);
+
+extern MotorTable motorTable;
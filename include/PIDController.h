@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+// Fixed-point PI(D) regulator producing a duty cycle (0–100 %).
+// Gains are Q16 (65536 = 1.0 % duty per mA of error) over the whole 16-bit
+// register range, so the largest is 65535 / 65536, just under 1.0; gain *
+// error always fits in int32. kp and kd apply per step; ki is handed in per
+// step too, converted from its per-second register value by stepGain(). The
+// integrator is clamped to the output range and frozen while the output is
+// saturated in the direction of the error (anti-windup). The D term acts on
+// the measurement, so setpoint steps do not kick the output.
+class PIDController
+{
+public:
+    struct Gains
+    {
+        uint16_t kp;
+        uint16_t ki;
+        uint16_t kd;
+    };
+
+    static constexpr uint8_t OUTPUT_MAX = 100;
+
+    // Per-second gain -> per-step gain for a step of dtMs, rounded and
+    // saturated to 16 bits
+    static uint16_t stepGain(uint16_t perSecond, uint16_t dtMs);
+
+    PIDController();
+
+    // Bumpless start: integrator preloaded with the current output
+    void reset(uint16_t output, int16_t measurement);
+
+    // Runs one step and returns the duty cycle clamped to [0, outputMax]
+    uint16_t update(int16_t setpoint, int16_t measurement, const Gains &gains,
+                    uint8_t outputMax = OUTPUT_MAX);
+
+private:
+    int32_t integral; // Q16 duty
+    int16_t prevMeasurement;
+};
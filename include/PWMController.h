@@ -13,20 +13,48 @@ public:
     // static void setFrequency(uint8_t pin, uint32_t freq);
     static void setGlobalFrequency(uint32_t freq);
 
-    // Sets the duty cycle (0–1000) for a specific pin
+    // Sets the duty cycle (0–100 %) for a specific pin
     static void setDutyCycle(uint8_t pin, uint16_t duty);
 
+    // 64-bit monotonic timebase driven by Timer2 overflows; restarted at
+    // zero by clearCount() (Modbus START)
     static uint64_t microsCustom();
     static uint64_t millisCustom();
     static void delayCustom(uint64_t ms);
-    static volatile uint64_t _micros64;
-    static uint32_t _us_per_overflow;
     static void clearCount();
 
+    // Microseconds since boot; never cleared, for release times and
+    // intervals that may span a START
+    static uint64_t uptimeMicros();
+
+    // Milliseconds since boot; never cleared, for sample times and dt of
+    // the measurement paths. Loses the sub-ms part at each START, so it
+    // may trail uptimeMicros() / 1000 by a few ms but never steps back.
+    static uint64_t uptimeMillis();
+
+    // Free-running CPU cycle counter (wraps every ~268 s at 16 MHz),
+    // resolution one Timer2 tick; for short interval measurements
+    static uint32_t cycles();
+
+    // Timebase state, advanced by TIMER2_OVF_vect
+    static volatile uint64_t _micros64; // Since boot
+    static uint64_t _microsOffset;      // _micros64 at the last clearCount()
+    static uint64_t _millisOffset;      // Sum of _millis64 at every clearCount()
+    static volatile uint64_t _millis64;
+    static volatile uint16_t _usRemainder; // us past _millis64 (0–999)
+    static uint16_t _usPerOverflow;
+    static uint16_t _usRemPerOverflow;
+    static uint8_t _msPerOverflow;
+    static uint16_t _usPerTickQ8; // us per Timer2 tick, Q8
+
     static float getDuty(uint8_t pin);
 
 private:
+    static void setTimer2Prescaler(uint8_t cs);
+    static void foldEpoch();
+
     static uint32_t currentGlobalFreq;
-    static uint16_t _timer2_top;
+    static uint8_t _cycleRemainder;
+    static uint8_t _timer2_cs;
     static uint16_t _timer2_prescaler;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <Arduino.h>
+#include "PWMController.h"
+
+// Hot-path profiler. Probes wrap the main subsystems and record cycle
+// counts from PWMController::cycles(), which START does not clear, so a
+// probe spanning the START write still records its own length. Counts
+// advance one Timer2 tick at a time, i.e. in steps of the Timer2 prescaler
+// (8 cycles at the default clk/8, up to 1024 at clk/1024); min/max
+// are kept since the last reset, avg and call count cover the last publish
+// window (~1 s).
+// Results are published at ModbusInputReg::DIAG_BASE, 7 registers per
+// probe: calls, min (lo, hi), avg (lo, hi), max (lo, hi), followed by the
+// CPU idle percentage: time spent in passes where no request was served
+// and no periodic slice ran. Writing DIAG_RESET clears everything.
+class Profiler
+{
+public:
+    enum Probe : uint8_t
+    {
+        PROBE_MODBUS = 0,
+        PROBE_MOTOR,
+        PROBE_TEMPERATURE,
+        PROBE_DEVICES,
+        PROBE_TELEMETRY,
+        PROBE_LOOP, // Period between scheduler passes
+        PROBE_COUNT
+    };
+
+    static constexpr uint8_t REGS_PER_PROBE = 7;
+
+    // Times the enclosing block
+    class Scope
+    {
+    public:
+        explicit Scope(uint8_t probe) : probe(probe), start(PWMController::cycles()) {}
+        ~Scope() { Profiler::record(probe, PWMController::cycles() - start); }
+
+    private:
+        uint8_t probe;
+        uint32_t start;
+    };
+
+    static void record(uint8_t probe, uint32_t cycles);
+
+    // Called once per loop pass; `worked` is false when the pass only
+    // polled for work (see Scheduler::run) and counts as idle time
+    static void loopPass(uint32_t start, bool worked);
+
+    static void publish();
+    static void reset();
+
+private:
+    static uint32_t minCycles[PROBE_COUNT];
+    static uint32_t maxCycles[PROBE_COUNT];
+    static uint32_t sumCycles[PROBE_COUNT]; // Current window
+    static uint16_t calls[PROBE_COUNT];     // Current window
+
+    static uint32_t lastPassStart;
+    static uint32_t idleCycles;  // Current window
+    static bool lastPassIdle;
+    static uint32_t windowStart;
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Motor protection engine. Sensor inputs and status live in motorTable
+// (struct-of-arrays) so one pass over all motors is a tight integer loop
+// that can run every loop iteration. Trips are latched until the fault has
+// cleared and the master acknowledges by commanding duty 0.
+class Protection
+{
+public:
+    static void setTemperature(uint8_t id, int16_t centiC, bool connected);
+    static void setIdle(uint8_t id, bool isIdle);
+
+    // Checks every motor against the limits, publishes changed status codes
+    // and pushes new duty limits to the motors
+    static void evaluate();
+
+    // Cost of the last evaluate() pass in CPU cycles
+    static uint16_t lastPassCycles;
+};
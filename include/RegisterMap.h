@@ -0,0 +1,225 @@
+#pragma once
+#include <stdint.h>
+
+// Modbus register map and wire settings, shared by the firmware (through
+// Config.h) and host-side masters (host/HwiMaster.h). No Arduino types here.
+
+// Serial port configuration (8E1, RTU)
+constexpr uint32_t BAUDRATE = 250000;
+
+// Width of every per-motor register block
+constexpr uint8_t MAX_MOTORS = 15;
+
+// Motor status codes (Input STATUS_BASE); codes >= MOTOR_TRIP_TEMP switch the output off
+enum MotorStatus
+{
+    MOTOR_OK = 0,
+    MOTOR_WARNING = 1,      // Above TEMP_WARNING, duty derated to DERATE_DUTY
+    MOTOR_TRIP_TEMP = 2,    // At or above MOTOR_TEMP_CRIT
+    MOTOR_TRIP_CURRENT = 3, // At or above MOTOR_CURR_CRIT
+    MOTOR_SENSOR_FAULT = 4  // Temperature sensor disconnected
+};
+
+// Event codes (EventLog, code byte): faults
+enum ErrorCode
+{
+    ERR_NO_ERROR = 0,
+    ERR_TEMP_LOW = 1,
+    ERR_TEMP_HIGH = 2,           // Motor tripped on temperature; value = winding estimate
+    ERR_SENSOR_DISCONNECTED = 3, // Sensor (motors, then air, water) stopped answering
+    ERR_OVERCURRENT = 4,         // Motor tripped on current; value = mA
+    ERR_MODBUS_CRC_FAIL = 5,
+    ERR_MODBUS_TIMEOUT = 6
+};
+
+// Event codes: state changes
+enum EventCode
+{
+    EVT_BOOT = 16,            // value = reset cause (MCUSR)
+    EVT_MODBUS_RESTART = 17,  // Server restarted after repeated errors
+    EVT_START = 18,
+    EVT_STOP = 19,
+    EVT_DEVICES = 20,         // value = device output mask after the change
+    EVT_MOTOR_STATUS = 21,    // Other MotorStatus changes; value = MotorStatus
+    EVT_SENSOR_RESTORED = 22, // value = first temperature, 1/100 °C
+};
+
+// -------------------------
+// Modbus Register Map
+// -------------------------
+namespace ModbusHoldingReg
+{
+
+    // --- Motor Parameters ---
+    // Holding Registers (writeable by master)
+    constexpr uint16_t DUTY_BASE = 1; // Holding: [1–15] — duty cycle control
+    constexpr uint16_t GLOBAL_FREQ = 0;
+
+    // Closed-loop current control (Holding)
+    constexpr uint16_t CTRL_SETPOINT_BASE = 16; // Holding: [16–30] — current setpoint (mA)
+    constexpr uint16_t CTRL_KP = 31;            // Gains in Q16 (65536 = 1.0 % duty per mA of error)
+    constexpr uint16_t CTRL_KI = 32;            // Per second of control time, scaled by CTRL_PERIOD
+    constexpr uint16_t CTRL_KD = 33;
+    constexpr uint16_t CTRL_MODE = 34;   // Bit i set = motor i runs closed loop
+    constexpr uint16_t CTRL_PERIOD = 35; // Control period in ms (0 = controllers off, all motors open loop)
+
+    // Duty profile upload window (Holding)
+    constexpr uint16_t PROFILE_INDEX = 36;      // Step index for COMMIT
+    constexpr uint16_t PROFILE_TIME_LOW = 37;   // Step offset from START in ms, low word
+    constexpr uint16_t PROFILE_TIME_HIGH = 38;  // Step offset, high word
+    constexpr uint16_t PROFILE_DUTY_BASE = 39;  // Holding: [39–53] — step duty per motor
+    constexpr uint16_t PROFILE_COMMIT = 54;     // 1 = store step, 2 = load step; reads 0 when done
+    constexpr uint16_t PROFILE_LENGTH = 55;     // Number of stored steps
+    constexpr uint16_t PROFILE_ENABLE = 56;     // 1 = run the profile on START
+
+    // Persistent configuration (Holding)
+    constexpr uint16_t CONFIG_COMMIT = 57; // 1 = save persisted registers to EEPROM; reads 0 when done
+
+    // History readout (Holding)
+    constexpr uint16_t HISTORY_PERIOD = 58; // Sample period in ms (0 = off)
+    constexpr uint16_t HISTORY_CTRL = 59;   // 1 = open a snapshot; reads 0 when done
+    constexpr uint16_t HISTORY_OFFSET = 60; // Byte offset shown in HISTORY_WINDOW_BASE
+
+    // Thresholds (Holding registers, writeable by master)
+    constexpr uint16_t MOTOR_TEMP_CRIT = 61;
+    constexpr uint16_t MOTOR_CURR_CRIT = 62;
+
+    // Traffic capture (Holding)
+    constexpr uint16_t TRACE_CTRL = 63; // 1 = stream a binary trace on Serial1 (see Trace.h)
+
+    // Event log readout (EventLog)
+    constexpr uint16_t EVENT_CURSOR = 64; // Sequence of the first entry shown in EVENT_WINDOW_BASE
+
+    // --- System Parameters ---
+    constexpr uint16_t START_REG_ADDR = 65;
+
+    // Air Temp
+    constexpr uint16_t AIR_TEMP_REG = 70;
+    constexpr uint16_t AIR_TEMP_LIMIT = 72;
+
+    // Water Temp
+    constexpr uint16_t WATER_TEMP_REG = 80;
+    constexpr uint16_t WATER_TEMP_LIMIT = 82;
+
+    // --- Diagnostics ---
+    constexpr uint16_t DIAG_RESET = 95; // Write 1 to clear profiler and scheduler stats
+
+    // --- Current calibration (CurrentSensor) ---
+    constexpr uint16_t CURR_OFFSET_BASE = 100; // Holding: [100–114] — ADC counts at 0 A
+    constexpr uint16_t CURR_GAIN_BASE = 115;   // Holding: [115–129] — mA per ADC count, Q8
+    constexpr uint16_t CURR_ZERO = 130;        // Motor mask to auto-zero; reads 0 when done
+
+    // --- Winding model (ThermalModel) ---
+    constexpr uint16_t THERMAL_TAU_BASE = 131; // Holding: [131–145] — winding time constant, s (0 = none)
+    constexpr uint16_t THERMAL_RISE = 146;     // Steady winding rise over the case at 10 A, 1/100 °C
+
+}
+
+namespace ModbusInputReg
+{
+    // Input Registers (read-only to master)
+    constexpr uint16_t CURR_BASE = 16;   // Input: [16–30] — motor currents, mA
+    constexpr uint16_t TEMP_BASE = 31;   // Input: [31–45] — motor temperatures, signed 1/100 °C
+    constexpr uint16_t STATUS_BASE = 46; // Input: [46–60] — motor status (e.g. overtemp, error)
+
+    // --- Duty profile executor ---
+    constexpr uint16_t PROFILE_STATE = 61; // DutyProfile::State
+    constexpr uint16_t PROFILE_STEP = 62;  // Index of the next step to apply
+
+    // --- Protection engine ---
+    constexpr uint16_t PROTECTION_CYCLES = 63; // CPU cycles of the last protection pass
+
+    // --- Persistent configuration ---
+    constexpr uint16_t CONFIG_STATUS = 64;   // ConfigStore::Status
+    constexpr uint16_t CONFIG_SEQUENCE = 65; // Saves since the EEPROM was first written (low word)
+
+    constexpr uint16_t DEV_STATUS_BASE = 90;
+    constexpr uint16_t TIME_LOW = 66;
+
+    // --- Device States ---
+    constexpr uint16_t FAN_REG = 91;
+    constexpr uint16_t MIXER_REG = 92;
+    constexpr uint16_t DISPENSER_REG = 93;
+    constexpr uint16_t PUMP_REG = 94;
+
+    // --- Software PWM engine ---
+    constexpr uint16_t SOFT_PWM_FREQ = 95; // Input: software PWM frequency (Hz)
+    constexpr uint16_t SOFT_PWM_RES = 96;  // Input: software PWM duty levels (0–100 %)
+
+    // --- Scheduler statistics ---
+    // Input: [100–147] — per task: deadline misses, budget overruns, max jitter (us), max slice (us)
+    constexpr uint16_t SCHED_BASE = 100;
+
+    // --- Loop profiler ---
+    // Input: [150–191] — per probe: calls/window, min, avg, max cycles (32-bit lo/hi),
+    // counted in Timer2 ticks, so quantised to the prescaler (8 cycles, up to 1024 at clk/1024)
+    constexpr uint16_t DIAG_BASE = 150;
+    constexpr uint16_t DIAG_IDLE_PCT = 192; // Share of loop time in passes that served no request and ran no periodic slice
+
+    // --- SRAM usage (bytes) ---
+    constexpr uint16_t MEM_FREE = 193;         // Current heap top to stack pointer
+    constexpr uint16_t MEM_STACK_PEAK = 194;   // Deepest stack extent since boot
+    constexpr uint16_t MEM_HEADROOM_MIN = 195; // Smallest heap/stack gap since boot
+    constexpr uint16_t MEM_HEAP_USED = 196;
+    constexpr uint16_t MEM_STATIC = 197;       // .data + .bss
+
+    // --- Boot stages (us since the timebase started, saturating) ---
+    constexpr uint16_t BOOT_SAFE_US = 200;    // Timers up, all outputs driven off
+    constexpr uint16_t BOOT_MODBUS_US = 201;  // Modbus server answering
+    constexpr uint16_t BOOT_CONFIG_US = 202;  // Saved configuration and profile restored
+    constexpr uint16_t BOOT_READY_US = 203;   // Scheduler running, system controllable
+    constexpr uint16_t BOOT_SENSORS_MS = 204; // All 1-Wire buses up (background, ms)
+    constexpr uint16_t BOOT_RESET_CAUSE = 205; // MCUSR at boot (PORF/EXTRF/BORF/WDRF)
+
+    // --- History snapshot ---
+    constexpr uint16_t HISTORY_STATE = 206;   // History::State
+    constexpr uint16_t HISTORY_LENGTH = 207;  // Snapshot bytes (keyframe + records)
+    constexpr uint16_t HISTORY_RECORDS = 208; // Records in the snapshot
+    constexpr uint16_t HISTORY_AGE_MS = 209;  // Newest record's age when the snapshot opened (saturating)
+    // Input: [210–241] — snapshot bytes at HISTORY_OFFSET, two per register
+    constexpr uint16_t HISTORY_WINDOW_BASE = 210;
+
+    // --- Traffic capture ---
+    constexpr uint16_t TRACE_RECORDS = 242; // Records sent since TRACE_CTRL was set
+    constexpr uint16_t TRACE_DROPPED = 243; // Records lost to a full Serial1 buffer
+
+    // --- Board ---
+    constexpr uint16_t BOARD_MOTORS = 244; // Motors fitted; per-motor slots past this stay 0
+
+    // --- Adaptive temperature polling (TempSchedule) ---
+    // Per sensor: motor slots [0–14], then air (15) and water (16)
+    constexpr uint16_t TEMP_TIER_BASE = 245; // Input: [245–261] — TempSchedule::Tier
+    constexpr uint16_t TEMP_RATE_BASE = 262; // Input: [262–278] — signed 1/100 °C per second
+
+    // --- Current calibration ---
+    constexpr uint16_t CURR_RAW_BASE = 280;    // Input: [280–294] — filtered ADC counts per motor
+    constexpr uint16_t CURR_ZERO_FAILED = 295; // Motors driven during the last auto-zero
+
+    // --- Winding model ---
+    // Input: [296–310] — estimated winding temperature, signed 1/100 °C
+    constexpr uint16_t WINDING_TEMP_BASE = 296;
+
+    // --- Event log ---
+    constexpr uint16_t EVENT_HEAD = 312;        // Sequence the next event will take
+    constexpr uint16_t EVENT_CURSOR_USED = 313; // EVENT_CURSOR after clamping to the ring
+    constexpr uint16_t EVENT_LOST = 314;        // Unread events overwritten since boot
+    // Input: [315–338] — 4 entries of 6 registers from the cursor (see EventLog.h)
+    constexpr uint16_t EVENT_WINDOW_BASE = 315;
+
+    // --- Interrupt latency (IrqMonitor), since boot or DIAG_RESET ---
+    constexpr uint16_t IRQ_T2_LATENCY_US = 340; // Longest TIMER2_OVF entry delay
+    constexpr uint16_t IRQ_T2_LATE = 341;       // Overflows served with the next already pending
+    constexpr uint16_t IRQ_CS_MAX_US = 342;     // Longest guarded interrupts-off window
+    constexpr uint16_t IRQ_CS_MAX_SITE = 343;   // IrqMonitor::Site of that window
+    constexpr uint16_t IRQ_RX_BUDGET_US = 344;  // Longest wait USART RX survives (two characters)
+    constexpr uint16_t IRQ_OVER_BUDGET = 345;   // Latencies and windows longer than the budget
+    constexpr uint16_t TIME_BACKWARDS = 346;    // Timebase reads lower than the previous one
+}
+
+// Temperature registers (TEMP_BASE, WINDING_TEMP_BASE, AIR/WATER_TEMP_REG) hold signed 1/100 °C
+// in two's complement; 0x8000 marks a disconnected or unreadable sensor
+constexpr int16_t TEMP_REG_DISCONNECTED = -0x7FFF - 1;
+
+// Register space sizes (ArduinoModbus allocates 2 bytes per register)
+constexpr uint16_t HOLDING_REG_COUNT = 148;
+constexpr uint16_t INPUT_REG_COUNT = 348;
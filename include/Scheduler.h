@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+
+// Static cooperative scheduler for SystemCore::loop().
+//
+// Tasks with period 0 are polled on every pass (Modbus, protection). All
+// other tasks are released every `period` ms and the highest-priority
+// released task gets exactly one slice per pass, so the service latency of
+// the polled tasks is bounded by the longest slice (SystemCore::
+// TEMP_BUDGET_US, one 1-Wire transaction, ~7 ms) plus the polled tasks
+// themselves. A periodic task function returns true while its job has
+// slices left (resumable jobs such as walking 15 sensors) and false once
+// the job is done; a polled one returns true when it did real work (served
+// a request) rather than just checking for some.
+//
+// Per task the scheduler tracks deadline misses (released again before the
+// previous job finished), budget overruns (slice longer than its budget),
+// worst release-to-start jitter and worst slice time, and publishes them at
+// ModbusInputReg::SCHED_BASE + 4 * id. All of it runs on uptimeMicros(), so
+// a START (clearCount) neither stalls releases nor wraps a measurement.
+class Scheduler
+{
+public:
+    typedef bool (*TaskFn)();
+
+    static constexpr uint8_t MAX_TASKS = 12;
+    static constexpr uint8_t REGS_PER_TASK = 4;
+
+    // Registers a task; lower priority value runs first. Returns the task id.
+    static int8_t add(TaskFn fn, uint16_t periodMs, uint8_t priority, uint16_t budgetUs);
+    static void setPeriod(uint8_t id, uint16_t periodMs);
+
+    // Releases a periodic task on the next pass instead of one period from now
+    static void releaseNow(uint8_t id);
+
+    // One scheduling pass: all polled tasks, then one slice of the most
+    // urgent released task. Returns false if the pass was idle: no polled
+    // task did work and no periodic slice was due.
+    static bool run();
+
+    static void resetStats();
+
+private:
+    struct Task
+    {
+        TaskFn fn;
+        uint32_t periodUs;
+        uint32_t nextRelease;  // uptimeMicros(), wraps
+        uint32_t releasedAt;   // uptimeMicros(), wraps
+        uint16_t budgetUs;
+        uint8_t priority;
+        bool pending;          // released, job not finished
+        bool started;          // first slice of the current job has run
+        uint16_t deadlineMisses;
+        uint16_t budgetOverruns;
+        uint32_t maxJitterUs;
+        uint32_t maxSliceUs;
+    };
+
+    static uint32_t runSlice(uint8_t id, uint32_t now, bool &worked);
+    static void publish(uint8_t id);
+
+    static Task tasks[MAX_TASKS];
+    static uint8_t taskCount;
+};
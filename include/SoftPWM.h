@@ -0,0 +1,63 @@
+// SoftPWM.h
+#pragma once
+#include <Arduino.h>
+
+// Interrupt-driven software PWM for motor outputs that have no usable
+// hardware output-compare channel (e.g. pin 4, whose OC0B sits on Timer0).
+//
+// Timer0 free-runs in normal mode at clk/64 (TOP = 0xFF). COMPA at count 0
+// starts a period and raises every active pin; COMPB is re-armed at each
+// falling edge and switched off once the period has none left, so the ISRs
+// only fire on edges and each pass is bounded by MAX_CHANNELS direct port
+// writes.
+class SoftPWM
+{
+public:
+    static constexpr uint8_t MAX_CHANNELS = 4;
+    static constexpr uint16_t RESOLUTION = 256;  // Timer0 ticks per PWM period
+    static constexpr uint16_t PRESCALER = 64;
+    static constexpr uint32_t FREQUENCY = F_CPU / PRESCALER / RESOLUTION; // ~976 Hz
+    static constexpr uint8_t DUTY_STEPS = 101;   // Distinct levels the 0–100 % input reaches
+
+    // Configures Timer0 and enables the compare interrupts
+    static void initialize();
+
+    // Registers a pin as a software PWM channel (output, driven low)
+    static bool attach(uint8_t pin);
+    static bool isAttached(uint8_t pin);
+
+    // Sets the duty cycle (0–100 %) for an attached pin
+    static void setDutyCycle(uint8_t pin, uint16_t duty);
+    static uint16_t getDuty(uint8_t pin);
+
+    // Called from the Timer0 compare ISRs
+    static void startPeriod();
+    static void serviceEdges();
+
+private:
+    // Precomputed edge list; falling edges sorted by tick, always-on channels last
+    struct Schedule
+    {
+        uint8_t onCount;   // channels raised at period start
+        uint8_t edgeCount; // channels with a falling edge inside the period
+        volatile uint8_t *port[MAX_CHANNELS];
+        uint8_t mask[MAX_CHANNELS];
+        uint8_t tick[MAX_CHANNELS];
+    };
+
+    static void rebuildSchedule();
+    static int8_t findChannel(uint8_t pin);
+
+    static uint8_t channelCount;
+    static uint8_t pins[MAX_CHANNELS];
+    static volatile uint8_t *ports[MAX_CHANNELS];
+    static uint8_t masks[MAX_CHANNELS];
+    static uint16_t ticks[MAX_CHANNELS]; // 0 = off, RESOLUTION = always on
+    static uint8_t duties[MAX_CHANNELS];
+
+    // Double-buffered so a period in progress never sees a half-built schedule
+    static Schedule schedules[2];
+    static volatile uint8_t activeSchedule;
+    static volatile bool schedulePending;
+    static volatile uint8_t nextEdge;
+};
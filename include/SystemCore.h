@@ -16,9 +16,6 @@ public:
     // Constructor to initialize internal members (could also be used to preload configs)
     SystemCore();
 
-    // Destructor to clean up dynamically allocated objects
-    ~SystemCore();
-
     // Sets up all subsystems (sensors, motors, Modbus, etc.)
     void setup();
 
@@ -37,23 +34,59 @@ private:
     TemperatureSensor airSensor;   // Ambient air temperature sensor (DS18B20 or similar)
     TemperatureSensor waterSensor; // Water temperature sensor (same interface as above)
 
-    TemperatureSensor *motorSensors[NUM_MOTORS]; // Array of pointers to per-motor temperature sensors
+    // Statically allocated. The only heap user is ArduinoModbus, which
+    // mallocs the register arrays once in ModbusHandler::begin() (~1 KB,
+    // see scripts/ram_report.py and MEM_HEAP_USED)
+    TemperatureSensor motorSensors[NUM_MOTORS]; // Per-motor temperature sensors
 
-    Motor *motors[NUM_MOTORS]; // Array of pointers to core motor control objects
+    Motor motors[NUM_MOTORS]; // Handles onto motorTable
 
     DeviceManager deviceManager; // Controls peripheral devices (fan, mixer, pump, etc.)
 
-    uint64_t accumulated_ticks = 0;
-    uint32_t last_overflow_snapshot = 0;
-    uint16_t current_timer0_prescaler = 64;
-
-    // --- Timekeeping ---
-
-    // Custom millisecond counter (optionally extended to 64-bit for rollover-safe timing)
-    uint64_t millisCustom();
-
-    // Stores prescaler state for custom millis if using a timer overflow counter
-    uint16_t prev_prescaler;
+    // Runs one pass of the per-motor current controllers
+    void runControl();
+
+    // --- Scheduled tasks (registered with Scheduler in setup()) ---
+    // Each returns true while its job has slices left.
+    static bool taskModbus();
+    static bool taskProtection();
+    static bool taskProfile();
+    static bool taskControl();
+    static bool taskMotors();
+    static bool taskTemperatures();
+    static bool taskDevices();
+    static bool taskTelemetry();
+    static bool taskDiagnostics();
+    static bool taskHistory();
+
+    // Air, water and motor sensors by index (0..NUM_MOTORS+1); see taskTemperatures
+    TemperatureSensor &sensorAt(uint8_t i);
+
+    // Feeds a new reading to Protection and TempSchedule
+    void rescheduleSensor(uint8_t i);
+
+    // How often taskTemperatures looks for due conversions; bounds the
+    // jitter of every sensor's adaptive period
+    static constexpr uint16_t TEMP_TICK_MS = 100;
+
+    // The Modbus slice includes sending the reply (RS485 waits for the last
+    // stop bit): up to a full 256-byte RTU frame of 11-bit characters, plus
+    // about 0.5 ms for parsing and the driver's pre/post delays
+    static constexpr uint16_t MODBUS_BUDGET_US = 256 * 11000000UL / BAUDRATE + 500;
+
+    // A periodic slice is at most one 1-Wire transaction (taskTemperatures,
+    // a scratchpad read of ~6.7 ms), so a request waits at most about this
+    // long, plus the polled tasks, before it is parsed
+    static constexpr uint16_t TEMP_BUDGET_US = 7000;
+
+    int8_t controlTaskId;
+    int8_t temperatureTaskId;
+    int8_t historyTaskId;
+    uint8_t sensorsUp;       // Sensors brought up so far in the background
+    uint8_t motorCursor;     // Next motor for taskMotors
+    uint8_t tempCursor;      // Next sensor for taskTemperatures
+    uint8_t telemetryCursor; // Next line for taskTelemetry
+    uint32_t sensorsDown;    // Bit i = sensorAt(i) failed its last read (EventLog edges)
 };
 
 // Declares a global instance accessible throughout the codebase.
@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Adaptive 1-Wire schedule. After every reading the sensor is rated into a
+// tier from its headroom to the limit, its rate of change and (motors only)
+// the applied duty. The tier sets how often it converts and at what
+// resolution, so bus time goes to hot or fast-moving sensors while cold,
+// idle ones back off. Tiers drop one step per reading, so a short lull does
+// not slow a hot motor down.
+//
+// Sensor index as SystemCore::sensorAt: motors, then air, then water.
+// Tier and rate are published at TEMP_TIER_BASE / TEMP_RATE_BASE.
+class TempSchedule
+{
+public:
+    static constexpr uint8_t SENSORS = NUM_MOTORS + 2;
+
+    enum Tier : uint8_t
+    {
+        TIER_IDLE,   // 4 s, 9 bit (0.5 °C)
+        TIER_NORMAL, // 1 s, 10 bit
+        TIER_ACTIVE, // 500 ms, 10 bit
+        TIER_HOT,    // 400 ms, 11 bit (0.125 °C, 375 ms conversion)
+    };
+
+    struct Setting
+    {
+        uint16_t periodMs; // Conversion start to conversion start
+        uint8_t resolution;
+    };
+
+    // Thresholds: headroom in 1/100 °C, rate in 1/100 °C per second, duty in %
+    static constexpr int16_t HOT_HEADROOM = 1000;
+    static constexpr int16_t ACTIVE_HEADROOM = 2000;
+    static constexpr int16_t HOT_RATE = 50;
+    static constexpr int16_t ACTIVE_RATE = 10;
+    static constexpr int16_t STABLE_RATE = 5;
+    static constexpr uint8_t ACTIVE_DUTY = 50;
+
+    // Every sensor starts at TIER_NORMAL
+    static void begin();
+
+    // Re-rates sensor `i` after a reading and returns its new setting.
+    // `limit` is where action starts (warning or device threshold).
+    static Setting update(uint8_t i, int16_t centiC, int16_t ratePerS, int16_t limit,
+                          uint8_t duty, bool connected);
+
+    static Setting setting(uint8_t i) { return SETTINGS[tiers[i]]; }
+
+private:
+    static uint16_t regOffset(uint8_t i); // Air/water sit after the MAX_MOTORS slots
+
+    static const Setting SETTINGS[4];
+    static uint8_t tiers[SENSORS];
+};
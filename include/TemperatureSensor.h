@@ -7,41 +7,69 @@
 // Class to encapsulate a single DS18B20 temperature sensor
 class TemperatureSensor
 {
+public:
+    static constexpr uint8_t RESOLUTION = 10; // Conversion bits (9–12) until the schedule changes it
+
+    // What service() did on the bus
+    enum Step : uint8_t
+    {
+        STEP_IDLE,    // Nothing due
+        STEP_REQUEST, // Conversion started
+        STEP_BUSY,    // Conversion due but not finished (one read slot); retried next tick
+        STEP_READ,    // Conversion read (or found the sensor missing)
+    };
+
 private:
     OneWire oneWire;          // OneWire bus instance, bound to a specific pin
     DallasTemperature sensor; // DallasTemperature library interface for reading sensor(s)
 
     uint16_t regTemp; // Modbus register to store current temperature
-    uint16_t limitTemp;
 
-    int16_t temperature;                 // Last read temperature in 0.1°C precision (e.g., 254 = 25.4°C)
-                                         // Changed from uint16_t to handle negative Celsius values
+    int16_t temperature;                 // Last reading in 1/100 °C (e.g., -512 = -5.12 °C), TEMP_REG_DISCONNECTED if none
     uint8_t status;                      // Encoded sensor status (e.g., 0=OK, 1=too low, 2=too high)
-    uint64_t lastTemperatureRequest = 0; // Instance-specific timestamp
 
     uint32_t lastRequestTime;
     bool conversionPending;
 
+    // Adaptive schedule (TempSchedule)
+    uint16_t periodMs;     // Conversion start to conversion start
+    uint8_t resolution;      // For the next conversion
+    uint8_t convResolution;  // Configured in the sensor, as of the last read
+    uint8_t alarmHigh;       // TH/TL bytes, written back with a new configuration
+    uint8_t alarmLow;
+    int16_t rate;            // 1/100 °C per second, smoothed
+    uint32_t lastSampleTime; // Start of the conversion last read
+    bool hasSample;
+
+    // Direct scratchpad access; one sensor per pin, so Skip ROM addresses it
+    bool readScratchPad(uint8_t *scratch);
+    void learnConfig(const uint8_t *scratch);
+    void writeConfig(uint8_t bits);
+
 public:
     // Constructor: specify GPIO pin and Modbus register mappings
-    TemperatureSensor(uint8_t pin, uint16_t tempReg, uint16_t tempLimit);
+    TemperatureSensor(uint8_t pin, uint16_t tempReg);
+
+    // Unbound sensor for static arrays; call attach() before begin()
+    TemperatureSensor();
+    void attach(uint8_t pin, uint16_t tempReg);
 
-    // Initializes OneWire and DallasTemperature libraries
+    // Reads the sensor's stored configuration (one bus transaction)
     void begin();
 
     // Reads temperature from sensor and updates Modbus registers and status
     void update();
 
-    // Returns latest temperature value in 0.1°C precision (e.g., 325 = 32.5°C)
+    // Returns latest temperature in 1/100 °C (e.g., 3250 = 32.50 °C)
     int16_t getTemperature() const;
 
     // Returns current status code
     uint8_t getStatus() const;
 
-    // Read data from sensors (Take's a bit time so we need it to call before reading temps)
-    void requestTemperatures(uint64_t now);
+    // One bus step: starts a conversion once the period is up, or reads it
+    // once its conversion time has passed and the sensor reports it done
+    Step service(uint32_t nowMs);
 
-    void requestTemperaturesAsync(uint64_t now);
-    bool isConversionComplete();
-    void readTemperatureAsync();
+    void setSchedule(uint16_t periodMs, uint8_t resolution);
+    int16_t getRate() const { return rate; }
 };
\ No newline at end of file
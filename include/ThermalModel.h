@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "MotorTable.h"
+
+// Winding temperature estimate from motor current (I²t). The DS18B20 sits
+// on the motor case and converts at most every 400 ms, while the winding
+// heats within seconds of a current step. Per motor, the winding rise over
+// the case follows a first-order model
+//
+//   d(rise)/dt = (THERMAL_RISE * (I / REF_CURRENT)² - rise) / tau
+//
+// with tau from THERMAL_TAU_BASE. It is integrated in 1/100 °C × ms with
+// the remainder carried to the next step, so small steps are not lost to
+// rounding and there is no division unless a whole 1/100 °C is due. The
+// estimate is the last case reading plus the rise, so every DS18B20
+// conversion re-anchors it; Protection trips on the estimate.
+class ThermalModel
+{
+public:
+    static constexpr uint16_t REF_CURRENT = 10000; // mA at which THERMAL_RISE is given
+    static constexpr int16_t MAX_RISE = 16000;     // 1/100 °C
+    static constexpr uint16_t MAX_STEP = 1000;     // ms, longer gaps (stalls) are cut
+
+    // Steps motor `id` to `nowMs` (uptime, low 16 bits) with its latest
+    // current and publishes the estimate. Runs after every current sample.
+    static void update(uint8_t id, uint16_t nowMs);
+
+    // Case temperature plus modelled rise, 1/100 °C
+    static int16_t estimate(uint8_t id)
+    {
+        int16_t rise = motorTable.windingRise[id];
+        int16_t caseC = motorTable.temperature[id];
+        return caseC > INT16_MAX - rise ? INT16_MAX : caseC + rise;
+    }
+};
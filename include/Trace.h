@@ -0,0 +1,79 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Binary capture of everything that drives the firmware from outside —
+// holding-register writes by the master, ADC and 1-Wire readings — plus the
+// outputs it produced, streamed on Serial1 while TRACE_CTRL is 1 (the text
+// telemetry pauses meanwhile). A trace replays deterministically through
+// the native build (sim/SimReplay.cpp), which compares the outputs.
+//
+// Record: SYNC, type, len, payload[len], CRC-8 (Dallas) over type..payload.
+// Every payload starts with the µs since the previous record (varint).
+//   BEGIN    first reg (u8), values (varint)...   holding registers at start
+//   WRITE    (reg u8, value varint)...           registers one request changed
+//   WRITE_MORE                                   same, more follow for that request
+//   POLL                                         request that changed nothing
+//   ADC      motor (u8), raw (u16)
+//   TEMP     register (u8), 1/16 °C (i16)        as the firmware read it
+//   OUTPUT   motor (u8), duty (u8)               after the protection cap
+//   STATUS   motor (u8), MotorStatus (u8)
+//   DEVICES  output mask (u8)
+//   DROPPED  records lost to a full TX buffer (varint)
+// Multi-byte fixed fields are little-endian.
+class Trace
+{
+public:
+    static constexpr uint8_t SYNC = 0xA5;
+    static constexpr uint8_t MAX_PAYLOAD = 48;
+    static constexpr int16_t TEMP_DISCONNECTED = -127 * 16;
+
+    enum Type : uint8_t
+    {
+        REC_BEGIN = 'B',
+        REC_WRITE = 'W',
+        REC_WRITE_MORE = 'w',
+        REC_POLL = 'P',
+        REC_ADC = 'A',
+        REC_TEMP = 'T',
+        REC_OUTPUT = 'O',
+        REC_STATUS = 'S',
+        REC_DEVICES = 'D',
+        REC_DROPPED = 'X',
+    };
+
+    // Applies TRACE_CTRL; starting snapshots the holding registers
+    static void setEnabled(bool on);
+    static bool active() { return enabled; }
+
+    // --- Inputs ---
+    static void request();                   // After a served Modbus request
+    static void noteHreg(uint16_t addr, uint16_t value); // Firmware-side register write
+    static void adc(uint8_t motor, uint16_t raw);
+    static void temperature(uint16_t reg, int16_t raw16);
+
+    // --- Outputs ---
+    static void output(uint8_t motor, uint8_t duty);
+    static void status(uint8_t motor, uint8_t status);
+    static void devices(uint8_t mask);
+
+private:
+    // Record under construction
+    static void open(uint8_t type);
+    static void put(uint8_t b) { payload[length++] = b; }
+    static void putVarint(uint32_t v);
+    static void putU16(uint16_t v);
+    static bool close(bool block);
+
+    static bool enabled;
+    static uint32_t lastUs;
+    static uint16_t dropped;      // Not yet reported in a DROPPED record
+    static uint16_t droppedTotal; // Since the capture started
+    static uint16_t records;
+    static uint8_t type;
+    static uint8_t length;
+    static uint8_t payload[MAX_PAYLOAD];
+    static uint32_t prevUs;                    // lastUs before the open record, restored on drop
+    static uint16_t shadow[HOLDING_REG_COUNT]; // Holding registers as of the last record
+    static uint8_t lastOutput[NUM_MOTORS];
+};
@@ -0,0 +1,400 @@
+// Multi-drop RS-485 bus simulator for sizing deployments: how many Mega
+// controllers fit on one 250 kbaud line at a given refresh rate.
+//
+// N slaves expose this firmware's register map (sizes and addresses from
+// Config.h) on one shared half-duplex line. The master polls every board
+// round-robin with the standard poll set below. Timing is simulated
+// per character (8E1 = 11 bits), with the RTU 1.75 ms inter-frame gap
+// and a slave turnaround model matching the firmware:
+//   - the server's own silence detection before it answers;
+//   - wait until the next pass of the main loop (taskModbus runs every pass);
+//   - often, a temperature slice that must finish first (one 1-Wire
+//     transaction, budgeted at SystemCore::TEMP_BUDGET_US = 7000 us).
+//     The defaults come from the native simulation's profiler: about
+//     68 temperature slices/s averaging 3.9 ms, so ~26 % of loop time.
+//     On a board, read the task's max slice (SCHED_BASE + 4 * 6 + 3) for
+//     --slice, and PROBE_TEMPERATURE calls x avg cycles per second over
+//     F_CPU (DIAG_BASE + 7 * 2) for --slice-prob;
+//   - frame handling.
+// A reply later than the master timeout stays on the line. If it overlaps
+// the next request, both frames are lost (bus contention).
+//
+//   bussim [options]            sweep 1..--max boards and print a table
+//   bussim --pty [options]      answer a real master on a pseudo-terminal
+//
+// Options (µs unless noted):
+//   --max N         largest board count in the sweep (default 32)
+//   --cycles N      poll cycles per board count (default 200)
+//   --pass US       loop pass time (default 120)
+//   --slice US      long slice a request may land behind (default 7000)
+//   --slice-prob P  chance that it does, 0..1 (default 0.26)
+//   --master US     master turnaround between frames (default 200)
+//   --timeout US    master reply timeout (default 20000)
+//   --seed N
+//
+// Build: g++ -std=gnu++11 -O2 -Iinclude scripts/bussim.cpp -o bussim
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "RegisterMap.h"
+
+namespace
+{
+    constexpr double CHAR_US = 11.0 * 1e6 / BAUDRATE; // 8E1
+    constexpr double FRAME_GAP_US = BAUDRATE > 19200 ? 1750.0 : 3.5 * CHAR_US;
+    constexpr double MODBUS_REQUEST_US = 250.0; // Frame decode + reply build on the slave
+
+    struct Options
+    {
+        int maxBoards = 32;
+        int cycles = 200;
+        double passUs = 120;
+        double sliceUs = 7000;    // SystemCore::TEMP_BUDGET_US
+        double sliceProb = 0.26;  // Share of loop time in temperature slices
+        double masterUs = 200;
+        double timeoutUs = 20000;
+        unsigned seed = 1;
+        bool pty = false;
+    };
+
+    // One request of the poll set
+    struct Request
+    {
+        uint8_t function;
+        uint16_t start;
+        uint16_t count;
+    };
+
+    // What a master reads from each board every cycle: measurements and
+    // status, the commanded duties and the board clock
+    const Request POLL_SET[] = {
+        {0x04, ModbusInputReg::CURR_BASE, ModbusInputReg::STATUS_BASE + MAX_MOTORS - ModbusInputReg::CURR_BASE},
+        {0x04, ModbusInputReg::TIME_LOW, 4},
+        {0x03, ModbusHoldingReg::DUTY_BASE, MAX_MOTORS},
+    };
+
+    // Frame sizes on the wire: address + PDU + CRC
+    uint16_t requestChars(const Request &r)
+    {
+        (void)r;
+        return 8;
+    }
+
+    uint16_t replyChars(const Request &r)
+    {
+        return 5 + 2 * r.count;
+    }
+
+    class Turnaround
+    {
+    public:
+        Turnaround(const Options &o) : opt(o), rng(o.seed) {}
+
+        // End of request to first reply bit
+        double sample()
+        {
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            double us = FRAME_GAP_US + unit(rng) * opt.passUs + MODBUS_REQUEST_US;
+            if (unit(rng) < opt.sliceProb)
+                us += unit(rng) * opt.sliceUs;
+            return us;
+        }
+
+    private:
+        const Options &opt;
+        std::mt19937 rng;
+    };
+
+    struct Result
+    {
+        double cycleAvgUs;
+        double cycleMaxUs;
+        double busyUs;
+        double totalUs;
+        uint32_t ok;
+        uint32_t timeouts;
+        uint32_t collisions;
+    };
+
+    Result simulate(int boards, const Options &opt)
+    {
+        Turnaround turnaround(opt);
+        Result r = {};
+        double t = 0;
+        double lateStart = -1, lateEnd = -1; // Reply still on the line after a timeout
+
+        for (int cycle = 0; cycle < opt.cycles; cycle++)
+        {
+            double cycleStart = t;
+            for (int board = 0; board < boards; board++)
+            {
+                for (const Request &req : POLL_SET)
+                {
+                    double reqEnd = t + requestChars(req) * CHAR_US;
+                    r.busyUs += reqEnd - t;
+
+                    if (lateEnd > t && lateStart < reqEnd)
+                    {
+                        // Late reply and this request collide; the slave sees garbage
+                        r.collisions++;
+                        lateStart = lateEnd = -1;
+                        t = reqEnd + opt.timeoutUs;
+                        continue;
+                    }
+
+                    double replyStart = reqEnd + turnaround.sample();
+                    double replyEnd = replyStart + replyChars(req) * CHAR_US;
+                    if (replyStart - reqEnd > opt.timeoutUs)
+                    {
+                        r.timeouts++;
+                        r.busyUs += replyEnd - replyStart;
+                        lateStart = replyStart;
+                        lateEnd = replyEnd;
+                        t = reqEnd + opt.timeoutUs + opt.masterUs;
+                        continue;
+                    }
+
+                    r.ok++;
+                    r.busyUs += replyEnd - replyStart;
+                    t = replyEnd + FRAME_GAP_US + opt.masterUs;
+                }
+            }
+            double length = t - cycleStart;
+            r.cycleAvgUs += length / opt.cycles;
+            if (length > r.cycleMaxUs)
+                r.cycleMaxUs = length;
+        }
+        r.totalUs = t;
+        return r;
+    }
+
+    void sweep(const Options &opt)
+    {
+        uint32_t perCycle = 0;
+        for (const Request &req : POLL_SET)
+            perCycle += req.count;
+
+        printf("250 kbaud 8E1, %zu requests / %u registers per board per cycle, %d cycles\n",
+               sizeof(POLL_SET) / sizeof(POLL_SET[0]), perCycle, opt.cycles);
+        printf("turnaround: gap %.0f + pass 0..%.0f + slice 0..%.0f (p=%.2f) + %.0f us; timeout %.0f us\n\n",
+               FRAME_GAP_US, opt.passUs, opt.sliceUs, opt.sliceProb, MODBUS_REQUEST_US, opt.timeoutUs);
+        printf("%6s %12s %12s %12s %8s %9s %10s\n", "boards", "cycle avg ms", "cycle max ms",
+               "refresh Hz", "bus %", "timeouts", "collisions");
+
+        for (int n = 1; n <= opt.maxBoards; n++)
+        {
+            Result r = simulate(n, opt);
+            printf("%6d %12.2f %12.2f %12.1f %8.1f %9u %10u\n", n, r.cycleAvgUs / 1000,
+                   r.cycleMaxUs / 1000, 1e6 / r.cycleAvgUs, 100 * r.busyUs / r.totalUs, r.timeouts,
+                   r.collisions);
+        }
+    }
+
+    // --- pty mode: N register maps behind a pseudo-terminal ---
+
+    double nowUs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+    }
+
+    void sleepUntil(double us)
+    {
+        double left = us - nowUs();
+        if (left > 0)
+            usleep((useconds_t)left);
+    }
+
+    uint16_t crc16(const uint8_t *p, size_t len)
+    {
+        uint16_t crc = 0xFFFF;
+        while (len--)
+        {
+            crc ^= *p++;
+            for (int i = 0; i < 8; i++)
+                crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+        return crc;
+    }
+
+    struct Board
+    {
+        uint16_t holding[HOLDING_REG_COUNT] = {};
+        uint16_t input[INPUT_REG_COUNT] = {};
+    };
+
+    // Builds the reply for one request, as the firmware's RTU server would
+    std::vector<uint8_t> answer(Board &b, const uint8_t *f, size_t len)
+    {
+        std::vector<uint8_t> out = {f[0], f[1]};
+        uint8_t fn = f[1];
+        uint16_t start = f[2] << 8 | f[3];
+        uint16_t count = f[4] << 8 | f[5];
+        uint8_t error = 0;
+
+        if ((fn == 0x03 || fn == 0x04) && len == 8)
+        {
+            uint16_t size = fn == 0x03 ? HOLDING_REG_COUNT : INPUT_REG_COUNT;
+            const uint16_t *regs = fn == 0x03 ? b.holding : b.input;
+            if (count == 0 || count > 125)
+                error = 3;
+            else if (start + count > size)
+                error = 2;
+            else
+            {
+                out.push_back(2 * count);
+                for (uint16_t i = 0; i < count; i++)
+                {
+                    out.push_back(regs[start + i] >> 8);
+                    out.push_back(regs[start + i] & 0xFF);
+                }
+            }
+        }
+        else if (fn == 0x06 && len == 8)
+        {
+            if (start >= HOLDING_REG_COUNT)
+                error = 2;
+            else
+            {
+                b.holding[start] = count;
+                out.assign(f, f + 6);
+            }
+        }
+        else if (fn == 0x10 && len >= 9 && len == 9u + f[6])
+        {
+            if (start + count > HOLDING_REG_COUNT || f[6] != 2 * count)
+                error = 2;
+            else
+            {
+                for (uint16_t i = 0; i < count; i++)
+                    b.holding[start + i] = f[7 + 2 * i] << 8 | f[8 + 2 * i];
+                out.assign(f, f + 6);
+            }
+        }
+        else
+            error = 1;
+
+        if (error)
+            out = {f[0], (uint8_t)(fn | 0x80), error};
+        uint16_t crc = crc16(out.data(), out.size());
+        out.push_back(crc & 0xFF);
+        out.push_back(crc >> 8);
+        return out;
+    }
+
+    int runPty(const Options &opt)
+    {
+        int fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0 || grantpt(fd) || unlockpt(fd))
+        {
+            perror("pty");
+            return 1;
+        }
+        printf("%d boards (slave ids 1..%d) on %s, Ctrl-C to stop\n", opt.maxBoards, opt.maxBoards,
+               ptsname(fd));
+        fflush(stdout);
+
+        std::vector<Board> boards(opt.maxBoards);
+        for (int i = 0; i < opt.maxBoards; i++)
+        {
+            Board &b = boards[i];
+            for (uint8_t m = 0; m < MAX_MOTORS; m++)
+                b.input[ModbusInputReg::TEMP_BASE + m] = 2500 + 10 * i + m;
+            b.input[ModbusInputReg::SOFT_PWM_FREQ] = 976;
+        }
+
+        Turnaround turnaround(opt);
+        std::vector<uint8_t> frame;
+        double lastByte = 0;
+        while (true)
+        {
+            pollfd p = {fd, POLLIN, 0};
+            int wait = frame.empty() ? -1 : 1;
+            if (poll(&p, 1, wait) > 0)
+            {
+                uint8_t buf[256];
+                ssize_t n = read(fd, buf, sizeof(buf));
+                if (n <= 0)
+                    continue;
+                frame.insert(frame.end(), buf, buf + n);
+                lastByte = nowUs();
+                continue;
+            }
+            if (frame.empty() || nowUs() - lastByte < FRAME_GAP_US)
+                continue;
+
+            // Complete frame: CRC-checked, addressed to one of the boards
+            bool valid = frame.size() >= 4 &&
+                         crc16(frame.data(), frame.size() - 2) ==
+                             (frame[frame.size() - 2] | frame[frame.size() - 1] << 8);
+            uint8_t id = valid ? frame[0] : 0;
+            if (id >= 1 && id <= opt.maxBoards)
+            {
+                std::vector<uint8_t> reply = answer(boards[id - 1], frame.data(), frame.size());
+                double start = lastByte + turnaround.sample() - FRAME_GAP_US;
+                for (size_t i = 0; i < reply.size(); i++)
+                {
+                    sleepUntil(start + i * CHAR_US);
+                    if (write(fd, &reply[i], 1) != 1)
+                        break;
+                }
+            }
+            frame.clear();
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : "0";
+        if (!strcmp(a, "--pty"))
+        {
+            opt.pty = true;
+            continue;
+        }
+        if (!strcmp(a, "--max"))
+            opt.maxBoards = atoi(v);
+        else if (!strcmp(a, "--cycles"))
+            opt.cycles = atoi(v);
+        else if (!strcmp(a, "--pass"))
+            opt.passUs = atof(v);
+        else if (!strcmp(a, "--slice"))
+            opt.sliceUs = atof(v);
+        else if (!strcmp(a, "--slice-prob"))
+            opt.sliceProb = atof(v);
+        else if (!strcmp(a, "--master"))
+            opt.masterUs = atof(v);
+        else if (!strcmp(a, "--timeout"))
+            opt.timeoutUs = atof(v);
+        else if (!strcmp(a, "--seed"))
+            opt.seed = atoi(v);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", a);
+            return 2;
+        }
+        i++;
+    }
+    if (opt.maxBoards < 1 || opt.maxBoards > 247)
+    {
+        fprintf(stderr, "--max must be 1..247\n");
+        return 2;
+    }
+
+    if (opt.pty)
+        return runPty(opt);
+    sweep(opt);
+    return 0;
+}
@@ -0,0 +1,81 @@
+# PlatformIO post-build script: prints the SRAM budget of the firmware
+# (.data + .bss, plus the heap ArduinoModbus allocates at begin(), against
+# the ATmega2560's 8 KB) and the largest RAM symbols.
+#
+# Enabled from platformio.ini with:  extra_scripts = post:scripts/ram_report.py
+
+Import("env")  # noqa: F821  (injected by SCons)
+
+import os
+import re
+import subprocess
+
+SRAM_SIZE = 8192
+TOP_SYMBOLS = 15
+
+# avr-libc malloc keeps a 2-byte size header in front of every block
+MALLOC_HEADER = 2
+# libmodbus context (modbus_t + RTU backend data), allocated by
+# ModbusRTUServer.begin(); an estimate, the struct is not in the ELF
+MODBUS_CONTEXT_ESTIMATE = 64
+
+
+def modbus_heap():
+    """Bytes ArduinoModbus mallocs for the register arrays configured in
+    ModbusHandler::begin(), from the counts in RegisterMap.h."""
+    path = os.path.join(env.subst("$PROJECT_INCLUDE_DIR"), "RegisterMap.h")  # noqa: F821
+    with open(path) as f:
+        text = f.read()
+    counts = {}
+    for name in ("HOLDING_REG_COUNT", "INPUT_REG_COUNT"):
+        m = re.search(r"\b%s\s*=\s*(\d+)" % name, text)
+        counts[name] = int(m.group(1)) if m else 0
+    blocks = [2 * counts["HOLDING_REG_COUNT"], 2 * counts["INPUT_REG_COUNT"],
+              MODBUS_CONTEXT_ESTIMATE]
+    return counts, sum(b + MALLOC_HEADER for b in blocks if b)
+
+
+def tool(name):
+    prefix = env.subst("$CC").rsplit("gcc", 1)[0]  # noqa: F821
+    return prefix + name
+
+
+def ram_report(source, target, env):
+    elf = str(target[0])
+
+    # Section sizes (SysV format: name size addr)
+    sections = {}
+    out = subprocess.check_output([tool("size"), "-A", elf], universal_newlines=True)
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0] in (".data", ".bss", ".noinit"):
+            sections[parts[0]] = int(parts[1])
+
+    counts, heap = modbus_heap()
+    used = sum(sections.values()) + heap
+    print("\n=== RAM report ===")
+    for name in (".data", ".bss", ".noinit"):
+        if name in sections:
+            print("%-8s %6d B" % (name, sections[name]))
+    print("%-8s %6d B (ArduinoModbus: %d holding + %d input registers, context est.)"
+          % ("heap", heap, counts["HOLDING_REG_COUNT"], counts["INPUT_REG_COUNT"]))
+    print("%-8s %6d B of %d (%.1f %%), %d B left for stack"
+          % ("total", used, SRAM_SIZE, 100.0 * used / SRAM_SIZE, SRAM_SIZE - used))
+
+    # Largest RAM-resident symbols (data/bss; avr-nm reports 0x800000-offset addresses)
+    out = subprocess.check_output([tool("nm"), "-C", "-S", "--size-sort", "-r", elf],
+                                  universal_newlines=True)
+    print("--- largest RAM symbols ---")
+    shown = 0
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4 or parts[2] not in "bBdD":
+            continue
+        print("%6d  %s" % (int(parts[1], 16), parts[3]))
+        shown += 1
+        if shown == TOP_SYMBOLS:
+            break
+    print("")
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", ram_report)  # noqa: F821
@@ -0,0 +1,364 @@
+// Cycle-accurate benchmark runner for the ATmega2560 firmware (env:bench).
+//
+// Loads firmware.elf into simavr and runs it for a fixed simulated time:
+//   - Benchmark markers (OUT to GPIOR0, see include/Benchmark.h) are trapped
+//     with the exact cycle count and folded into per-probe min/avg/max.
+//   - A scripted Modbus master on USART0 sends START, a duty write for every
+//     motor, then alternating FC3/FC4 polls; reply latency is measured from
+//     the last request byte to the first reply byte.
+//   - ADC inputs are held at fixed voltages; the 1-Wire buses idle high with
+//     no sensor attached, so the firmware takes its disconnected-sensor path.
+//   - Every instruction is checked for SREG.I: each interrupt-disabled
+//     window is timed and attributed to the PC where it began (the vector
+//     for ISRs, the instruction after CLI / SREG restore otherwise).
+//
+//   simbench firmware.elf [seconds]
+//
+// Built and run by scripts/simbench.py after `pio run -e bench`.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_adc.h>
+#include <simavr/avr_ioport.h>
+
+#define F_CPU 16000000UL
+#define GPIOR0_ADDR 0x3E        // Data-space address of GPIOR0 (I/O 0x1E)
+#define VECTOR_TABLE_END 0xE4   // 57 vectors x 4 bytes
+#define BAUDRATE 250000UL
+#define CHAR_CYCLES (F_CPU * 11 / BAUDRATE) // 8E1 = 11 bits
+#define SLAVE_ID 1
+#define NUM_MOTORS 15 // env:bench builds the default 15-motor board
+#define POLL_PERIOD_MS 10
+
+static const char *PROBE_NAMES[] = {
+    "", "calibrate", "setDutyCycle", "microsCustom", "ModbusHandler::task", "SystemCore::loop",
+};
+#define PROBE_COUNT (sizeof(PROBE_NAMES) / sizeof(PROBE_NAMES[0]))
+
+// --- Probes ---
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} stat_t;
+
+static stat_t probes[PROBE_COUNT];
+static struct
+{
+    uint8_t probe;
+    uint64_t start;
+} openProbes[8];
+static uint8_t depth = 0;
+static int started = 0;
+
+static void stat_add(stat_t *s, uint64_t v)
+{
+    if (s->count == 0 || v < s->min)
+        s->min = v;
+    if (v > s->max)
+        s->max = v;
+    s->sum += v;
+    s->count++;
+}
+
+static void marker_write(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+    (void)param;
+    avr->data[addr] = v;
+    started = 1;
+
+    if (v)
+    {
+        if (depth < 8)
+        {
+            openProbes[depth].probe = v;
+            openProbes[depth].start = avr->cycle;
+        }
+        depth++;
+    }
+    else if (depth)
+    {
+        depth--;
+        if (depth < 8 && openProbes[depth].probe < PROBE_COUNT)
+            stat_add(&probes[openProbes[depth].probe], avr->cycle - openProbes[depth].start);
+    }
+}
+
+// --- Interrupt-disabled windows, worst per start PC ---
+typedef struct
+{
+    uint32_t pc;
+    uint64_t count;
+    uint64_t max;
+} window_t;
+
+#define WINDOW_SITES 64
+static window_t windows[WINDOW_SITES];
+static int windowSites = 0;
+
+static void window_add(uint32_t pc, uint64_t cycles)
+{
+    int i;
+    for (i = 0; i < windowSites && windows[i].pc != pc; i++)
+        ;
+    if (i == windowSites)
+    {
+        if (windowSites == WINDOW_SITES)
+            return;
+        windows[windowSites].pc = pc;
+        windowSites++;
+    }
+    windows[i].count++;
+    if (cycles > windows[i].max)
+        windows[i].max = cycles;
+}
+
+static int window_cmp(const void *a, const void *b)
+{
+    const window_t *x = a, *y = b;
+    return x->max < y->max ? 1 : x->max > y->max ? -1 : 0;
+}
+
+// --- Modbus master ---
+static avr_irq_t *uartIn;
+static uint8_t txFrame[64];
+static uint8_t txLen = 0, txPos = 0;
+static uint64_t nextByteAt = 0, nextFrameAt = 0, requestEnd = 0;
+static uint32_t sequence = 0;
+static int awaiting = 0;
+static uint32_t requests = 0, replies = 0, replyBytes = 0;
+static stat_t latency;
+
+static uint16_t crc16(const uint8_t *p, uint8_t len)
+{
+    uint16_t crc = 0xFFFF;
+    while (len--)
+    {
+        crc ^= *p++;
+        for (uint8_t i = 0; i < 8; i++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+static void frame_start(const uint8_t *pdu, uint8_t len, uint64_t now)
+{
+    txFrame[0] = SLAVE_ID;
+    memcpy(&txFrame[1], pdu, len);
+    uint16_t crc = crc16(txFrame, len + 1);
+    txFrame[len + 1] = crc & 0xFF;
+    txFrame[len + 2] = crc >> 8;
+    txLen = len + 3;
+    txPos = 0;
+    nextByteAt = now;
+    requests++;
+}
+
+static void next_request(uint64_t now)
+{
+    uint8_t pdu[6 + 2 * NUM_MOTORS];
+    uint32_t n = sequence++;
+
+    if (n == 0)
+    {
+        const uint8_t start[] = {0x06, 0, 65, 0, 1}; // Write 1 to START_REG_ADDR (65)
+        frame_start(start, sizeof(start), now);
+    }
+    else if (n == 1)
+    {
+        pdu[0] = 0x10;
+        pdu[1] = 0;
+        pdu[2] = 1; // DUTY_BASE
+        pdu[3] = 0;
+        pdu[4] = NUM_MOTORS;
+        pdu[5] = 2 * NUM_MOTORS;
+        for (int i = 0; i < NUM_MOTORS; i++)
+        {
+            pdu[6 + 2 * i] = 0;
+            pdu[7 + 2 * i] = 40;
+        }
+        frame_start(pdu, sizeof(pdu), now);
+    }
+    else
+    {
+        const uint8_t fc3[] = {0x03, 0, 0, 0, 2 * NUM_MOTORS + 1};
+        const uint8_t fc4[] = {0x04, 0, 16, 0, 3 * NUM_MOTORS}; // CURR_BASE..STATUS
+        if (n & 1)
+            frame_start(fc3, sizeof(fc3), now);
+        else
+            frame_start(fc4, sizeof(fc4), now);
+    }
+}
+
+static void master_step(uint64_t now)
+{
+    if (txPos < txLen)
+    {
+        if (now >= nextByteAt)
+        {
+            avr_raise_irq(uartIn, txFrame[txPos++]);
+            nextByteAt = now + CHAR_CYCLES;
+            if (txPos == txLen)
+            {
+                requestEnd = now + CHAR_CYCLES;
+                awaiting = 1;
+            }
+        }
+    }
+    else if (now >= nextFrameAt)
+    {
+        nextFrameAt = now + POLL_PERIOD_MS * (F_CPU / 1000);
+        next_request(now);
+    }
+}
+
+static void uart_out(avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)value;
+    avr_t *avr = param;
+    replyBytes++;
+    if (awaiting)
+    {
+        awaiting = 0;
+        replies++;
+        // The UART reports a byte as it is loaded into the shift register
+        stat_add(&latency, avr->cycle > requestEnd ? avr->cycle - requestEnd : 0);
+    }
+}
+
+// --- Stub inputs ---
+static void stub_inputs(avr_t *avr)
+{
+    for (int i = 0; i < 16; i++)
+        avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0 + i), 300 + 20 * i); // mV
+
+    // 1-Wire pins 22-36 (PA0-PA7, PC7-PC1) and 20/21 (PD1/PD0): idle high
+    for (int bit = 0; bit < 8; bit++)
+    {
+        avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('A'), bit), 1);
+        avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), bit), 1);
+    }
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 0), 1);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 1), 1);
+}
+
+static double us(uint64_t cycles)
+{
+    return cycles / (F_CPU / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s firmware.elf [seconds]\n", argv[0]);
+        return 2;
+    }
+    double seconds = argc > 2 ? atof(argv[2]) : 5.0;
+
+    elf_firmware_t fw;
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(argv[1], &fw) != 0)
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    avr_t *avr = avr_make_mcu_by_name("atmega2560");
+    if (!avr)
+        return 1;
+    avr_init(avr);
+    avr->frequency = F_CPU;
+    avr->vcc = avr->avcc = avr->aref = 5000;
+    avr_load_firmware(avr, &fw);
+    avr->log = LOG_WARNING;
+
+    avr_register_io_write(avr, GPIOR0_ADDR, marker_write, NULL);
+
+    uint32_t flags = 0;
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    uartIn = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+                            uart_out, avr);
+    stub_inputs(avr);
+
+    uint64_t end = (uint64_t)(seconds * F_CPU);
+    uint64_t windowStart = 0;
+    uint32_t windowPc = 0;
+    int disabled = 0;
+    stat_t isrWindows, cliWindows;
+    memset(&isrWindows, 0, sizeof(isrWindows));
+    memset(&cliWindows, 0, sizeof(cliWindows));
+
+    int state = cpu_Running;
+    while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed)
+    {
+        state = avr_run(avr);
+        if (!started)
+            continue; // Boot runs with interrupts off for long stretches by design
+
+        master_step(avr->cycle);
+
+        int off = !avr->sreg[S_I];
+        if (off && !disabled)
+        {
+            disabled = 1;
+            windowStart = avr->cycle;
+            windowPc = avr->pc;
+        }
+        else if (!off && disabled)
+        {
+            disabled = 0;
+            uint64_t len = avr->cycle - windowStart;
+            window_add(windowPc, len);
+            stat_add(windowPc < VECTOR_TABLE_END ? &isrWindows : &cliWindows, len);
+        }
+    }
+
+    uint64_t overhead = probes[1].count ? probes[1].min : 0;
+
+    printf("\n=== simavr benchmark: %.2f s simulated ===\n", avr->cycle / (double)F_CPU);
+    printf("%-22s %8s %8s %10s %8s  (cycles, marker cost %llu removed)\n",
+           "probe", "calls", "min", "avg", "max", (unsigned long long)overhead);
+    for (unsigned p = 2; p < PROBE_COUNT; p++)
+    {
+        stat_t *s = &probes[p];
+        if (!s->count)
+            continue;
+        printf("%-22s %8llu %8llu %10.1f %8llu\n", PROBE_NAMES[p], (unsigned long long)s->count,
+               (unsigned long long)(s->min - overhead), s->sum / (double)s->count - overhead,
+               (unsigned long long)(s->max - overhead));
+    }
+
+    printf("\n--- interrupt-disabled windows ---\n");
+    printf("ISRs:            %llu, max %llu cycles (%.1f us)\n", (unsigned long long)isrWindows.count,
+           (unsigned long long)isrWindows.max, us(isrWindows.max));
+    printf("critical sects.: %llu, max %llu cycles (%.1f us)\n", (unsigned long long)cliWindows.count,
+           (unsigned long long)cliWindows.max, us(cliWindows.max));
+    qsort(windows, windowSites, sizeof(window_t), window_cmp);
+    printf("worst sites (avr-addr2line -e firmware.elf <pc>):\n");
+    for (int i = 0; i < windowSites && i < 10; i++)
+        printf("  pc 0x%05x  %8llu x  max %6llu cycles%s\n", windows[i].pc,
+               (unsigned long long)windows[i].count, (unsigned long long)windows[i].max,
+               windows[i].pc < VECTOR_TABLE_END ? "  (vector)" : "");
+
+    printf("\n--- Modbus master ---\n");
+    printf("requests %u, replies %u, reply bytes %u\n", requests, replies, replyBytes);
+    if (latency.count)
+        printf("latency to first reply byte: min %.0f us, avg %.0f us, max %.0f us\n",
+               us(latency.min), us(latency.sum / latency.count), us(latency.max));
+    printf("\n");
+
+    return state == cpu_Crashed ? 1 : 0;
+}
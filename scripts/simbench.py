@@ -0,0 +1,38 @@
+# PlatformIO post-build script for env:bench: builds the simavr runner
+# (scripts/simbench.c) for the host and runs the freshly linked firmware
+# under it, printing per-probe cycle counts and interrupt-disabled windows.
+#
+# Needs simavr and libelf on the host (e.g. `apt install libsimavr-dev
+# libelf-dev`). Simulated run time comes from `custom_bench_seconds`.
+
+Import("env")  # noqa: F821  (injected by SCons)
+
+import os
+import subprocess
+
+
+def simavr_flags():
+    try:
+        out = subprocess.check_output(["pkg-config", "--cflags", "--libs", "simavr"],
+                                      universal_newlines=True)
+        return out.split() + ["-lelf"]
+    except (OSError, subprocess.CalledProcessError):
+        return ["-I/usr/include/simavr", "-lsimavr", "-lelf"]
+
+
+def simbench(source, target, env):
+    elf = str(target[0])
+    src = os.path.join(env.subst("$PROJECT_DIR"), "scripts", "simbench.c")
+    runner = os.path.join(env.subst("$BUILD_DIR"), "simbench")
+    seconds = env.GetProjectOption("custom_bench_seconds", "5")
+
+    try:
+        subprocess.check_call(["cc", "-O2", "-std=gnu99", "-o", runner, src] + simavr_flags())
+    except (OSError, subprocess.CalledProcessError):
+        print("simbench: cannot build the runner; needs a host C compiler, simavr "
+              "and libelf (see scripts/simbench.py)")
+        return 1
+    return subprocess.call([runner, elf, seconds])
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", simbench)  # noqa: F821
@@ -0,0 +1,146 @@
+// Arduino core API for the native (host) build. Pin I/O, ADC and serial
+// ports are backed by the simulation kernel; timing functions charge
+// simulated time instead of spinning. Only what the firmware uses is here.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEFAULT 1
+#define INTERNAL1V1 2
+#define INTERNAL2V56 3
+#define EXTERNAL 0
+
+#define NOT_A_PORT 0
+#define NUM_DIGITAL_PINS 70
+
+#define SERIAL_8N1 0x06
+#define SERIAL_8E1 0x26
+
+enum : uint8_t
+{
+    A0 = 54, A1, A2, A3, A4, A5, A6, A7,
+    A8, A9, A10, A11, A12, A13, A14, A15
+};
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#define bit(b) (1UL << (b))
+
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// Mega 2560 pin map (pins_arduino.h)
+uint8_t digitalPinToPort(uint8_t pin);
+uint8_t digitalPinToBitMask(uint8_t pin);
+volatile uint8_t *portOutputRegister(uint8_t port);
+volatile uint8_t *portModeRegister(uint8_t port);
+volatile uint8_t *portInputRegister(uint8_t port);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+
+// Ideal clocks derived from the simulated cycle counter
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    size_t write(const uint8_t *buf, size_t len);
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = 10) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = 10) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = 10) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = 10);
+    size_t print(unsigned long n, int base = 10);
+    size_t print(double n, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+    template <typename T>
+    size_t println(T value, int format) { return print(value, format) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+struct SimSerialPort;
+
+// UART with simulated line timing: received bytes become available when
+// their last stop bit has arrived, and writes block once the TX ring
+// (SERIAL_TX_BUFFER_SIZE) is full, exactly like the interrupt-driven core.
+class HardwareSerial : public Stream
+{
+public:
+    explicit HardwareSerial(uint8_t index);
+
+    void begin(unsigned long baud, uint8_t config = SERIAL_8N1);
+    void end() {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite();
+    void flush();
+    size_t write(uint8_t b) override;
+    using Print::write;
+    operator bool() { return true; }
+
+    // --- Simulation side (the "other end of the wire") ---
+    // Queues bytes to arrive back to back from now on
+    void simInject(const uint8_t *data, size_t len);
+    // Takes transmitted bytes whose stop bit has gone out; returns count
+    size_t simTakeTx(uint8_t *out, size_t max, uint64_t *firstStartCycle = nullptr);
+    uint64_t simCharCycles() const;
+    uint64_t simLastRxCycle() const; // Arrival of the newest received byte
+    void simEcho(bool on);
+
+private:
+    SimSerialPort *state;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
+
+// Sketch entry points (main.cpp)
+void setup();
+void loop();
@@ -0,0 +1,43 @@
+// ArduinoModbus RTU server for the native build. Same register API as the
+// library; frames are taken from Serial once the line has been silent for
+// 1.75 ms (the RTU inter-frame gap above 19200 baud), checked by CRC and
+// answered for FC3, FC4, FC6 and FC16. Like the library, a reply blocks
+// until it has left the UART.
+#pragma once
+#include "Arduino.h"
+#include "ArduinoRS485.h"
+
+class ModbusRTUServerClass
+{
+public:
+    int begin(int id, unsigned long baudrate, uint16_t config = SERIAL_8N1);
+    void end();
+
+    int configureHoldingRegisters(int startAddress, int nb);
+    int configureInputRegisters(int startAddress, int nb);
+
+    // 1 when a request was answered, 0 when idle, -1 on a bad frame
+    int poll();
+
+    long holdingRegisterRead(int address);
+    int holdingRegisterWrite(int address, uint16_t value);
+    long inputRegisterRead(int address);
+    int inputRegisterWrite(int address, uint16_t value);
+
+private:
+    static constexpr uint16_t FRAME_MAX = 256;
+
+    void reply(const uint8_t *frame, uint8_t len);
+    void exception(uint8_t function, uint8_t code);
+
+    uint8_t id = 0;
+    bool running = false;
+    uint16_t *holding = nullptr;
+    int holdingStart = 0;
+    int holdingCount = 0;
+    uint16_t *input = nullptr;
+    int inputStart = 0;
+    int inputCount = 0;
+};
+
+extern ModbusRTUServerClass ModbusRTUServer;
@@ -0,0 +1,17 @@
+// ArduinoRS485 stand-in for the native build. The simulated bus has no
+// driver-enable line; the RTU server below talks to Serial directly.
+#pragma once
+#include "Arduino.h"
+
+class RS485Class
+{
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    void beginTransmission() {}
+    void endTransmission() {}
+    void receive() {}
+    void noReceive() {}
+};
+
+extern RS485Class RS485;
@@ -0,0 +1,59 @@
+// DallasTemperature subset for the native build, implemented over the
+// simulated OneWire bus the same way the library drives real sensors
+// (bus search for addresses, scratchpad reads with CRC check).
+#pragma once
+#include <stdint.h>
+#include "OneWire.h"
+
+typedef uint8_t DeviceAddress[8];
+typedef uint8_t ScratchPad[9];
+
+#define DEVICE_DISCONNECTED_C -127
+#define DEVICE_DISCONNECTED_F -196.6
+#define DEVICE_DISCONNECTED_RAW -7040
+
+class DallasTemperature
+{
+public:
+    struct request_t
+    {
+        bool result;
+        unsigned long timestamp;
+        operator bool() { return result; }
+    };
+
+    DallasTemperature() : wire(nullptr) {}
+    explicit DallasTemperature(OneWire *w) : wire(w) {}
+    void setOneWire(OneWire *w) { wire = w; }
+
+    void begin();
+    uint8_t getDeviceCount() const { return devices; }
+    bool getAddress(uint8_t *address, uint8_t index);
+    bool isConnected(const uint8_t *address);
+    bool isConnected(const uint8_t *address, uint8_t *scratchPad);
+    bool readScratchPad(const uint8_t *address, uint8_t *scratchPad);
+    void writeScratchPad(const uint8_t *address, const uint8_t *scratchPad);
+
+    void setResolution(uint8_t resolution);
+    bool setResolution(const uint8_t *address, uint8_t resolution, bool skipGlobal = false);
+    uint8_t getResolution(const uint8_t *address);
+    void setWaitForConversion(bool wait) { waitForConversion = wait; }
+    void setCheckForConversion(bool check) { checkForConversion = check; }
+    void setAutoSaveScratchPad(bool save) { autoSave = save; }
+
+    request_t requestTemperatures();
+    bool isConversionComplete();
+    int16_t millisToWaitForConversion(uint8_t resolution);
+
+    int32_t getTemp(const uint8_t *address);
+    float getTempC(const uint8_t *address);
+    float getTempCByIndex(uint8_t index);
+
+private:
+    OneWire *wire;
+    uint8_t devices = 0;
+    uint8_t bitResolution = 9;
+    bool waitForConversion = true;
+    bool checkForConversion = true;
+    bool autoSave = true;
+};
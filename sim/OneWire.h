@@ -0,0 +1,36 @@
+// OneWire bus for the native build. Each pin carries at most one simulated
+// DS18B20 (see Sim::setTemperature); the byte-level protocol is modelled
+// (ROM commands, convert, scratchpad read/write) and every reset and time
+// slot charges its bus time to the simulation clock.
+#pragma once
+#include <stdint.h>
+
+class OneWire
+{
+public:
+    OneWire() : pin(0xFF) {}
+    explicit OneWire(uint8_t pin) { begin(pin); }
+    void begin(uint8_t pin);
+
+    uint8_t reset();
+    void select(const uint8_t rom[8]);
+    void skip();
+    void write(uint8_t v, uint8_t power = 0);
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0);
+    uint8_t read();
+    void read_bytes(uint8_t *buf, uint16_t count);
+    void write_bit(uint8_t v);
+    uint8_t read_bit();
+    void depower() {}
+
+    void reset_search();
+    bool search(uint8_t *newAddr, bool searchMode = true);
+
+    static uint8_t crc8(const uint8_t *addr, uint8_t len);
+
+    uint8_t getPin() const { return pin; }
+
+private:
+    uint8_t pin;
+    bool searchDone = false;
+};
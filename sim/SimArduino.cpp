@@ -0,0 +1,338 @@
+#include <deque>
+#include <stdio.h>
+#include "Arduino.h"
+#include "SimKernel.h"
+
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE 64
+#endif
+
+// --- Mega 2560 pin map (port 1 = A ... 12 = L, as in pins_arduino.h) ---
+namespace
+{
+    enum : uint8_t
+    {
+        PA_ = 1, PB_, PC_, PD_, PE_, PF_, PG_, PH_, PJ_ = 10, PK_, PL_
+    };
+
+    const uint8_t PIN_PORT[NUM_DIGITAL_PINS] = {
+        PE_, PE_, PE_, PE_, PG_, PE_, PH_, PH_, PH_, PH_, // 0-9
+        PB_, PB_, PB_, PB_, PJ_, PJ_, PH_, PH_, PD_, PD_, // 10-19
+        PD_, PD_, PA_, PA_, PA_, PA_, PA_, PA_, PA_, PA_, // 20-29
+        PC_, PC_, PC_, PC_, PC_, PC_, PC_, PC_, PD_, PG_, // 30-39
+        PG_, PG_, PL_, PL_, PL_, PL_, PL_, PL_, PL_, PL_, // 40-49
+        PB_, PB_, PB_, PB_, PF_, PF_, PF_, PF_, PF_, PF_, // 50-59
+        PF_, PF_, PK_, PK_, PK_, PK_, PK_, PK_, PK_, PK_, // 60-69
+    };
+
+    const uint8_t PIN_BIT[NUM_DIGITAL_PINS] = {
+        0, 1, 4, 5, 5, 3, 3, 4, 5, 6, // 0-9
+        4, 5, 6, 7, 1, 0, 1, 0, 3, 2, // 10-19
+        1, 0, 0, 1, 2, 3, 4, 5, 6, 7, // 20-29
+        7, 6, 5, 4, 3, 2, 1, 0, 7, 2, // 30-39
+        1, 0, 7, 6, 5, 4, 3, 2, 1, 0, // 40-49
+        3, 2, 1, 0, 0, 1, 2, 3, 4, 5, // 50-59
+        6, 7, 0, 1, 2, 3, 4, 5, 6, 7, // 60-69
+    };
+
+    volatile uint8_t *const PORT_OUT[13] = {
+        nullptr, &PORTA, &PORTB, &PORTC, &PORTD, &PORTE, &PORTF,
+        &PORTG, &PORTH, nullptr, &PORTJ, &PORTK, &PORTL};
+    volatile uint8_t *const PORT_DDR[13] = {
+        nullptr, &DDRA, &DDRB, &DDRC, &DDRD, &DDRE, &DDRF,
+        &DDRG, &DDRH, nullptr, &DDRJ, &DDRK, &DDRL};
+
+    uint16_t adcValue[16];
+}
+
+uint8_t digitalPinToPort(uint8_t pin)
+{
+    return pin < NUM_DIGITAL_PINS ? PIN_PORT[pin] : NOT_A_PORT;
+}
+
+uint8_t digitalPinToBitMask(uint8_t pin)
+{
+    return pin < NUM_DIGITAL_PINS ? _BV(PIN_BIT[pin]) : 0;
+}
+
+volatile uint8_t *portOutputRegister(uint8_t port)
+{
+    return port < 13 ? PORT_OUT[port] : nullptr;
+}
+
+volatile uint8_t *portModeRegister(uint8_t port)
+{
+    return port < 13 ? PORT_DDR[port] : nullptr;
+}
+
+volatile uint8_t *portInputRegister(uint8_t port)
+{
+    return portOutputRegister(port); // Inputs read back the output latch
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    volatile uint8_t *ddr = portModeRegister(digitalPinToPort(pin));
+    if (!ddr)
+        return;
+    if (mode == OUTPUT)
+        *ddr |= digitalPinToBitMask(pin);
+    else
+        *ddr &= (uint8_t)~digitalPinToBitMask(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    volatile uint8_t *out = portOutputRegister(digitalPinToPort(pin));
+    if (!out)
+        return;
+    uint8_t sreg = SREG;
+    cli();
+    if (value)
+        *out |= digitalPinToBitMask(pin);
+    else
+        *out &= (uint8_t)~digitalPinToBitMask(pin);
+    SREG = sreg;
+}
+
+int digitalRead(uint8_t pin)
+{
+    return Sim::pinLevel(pin);
+}
+
+uint8_t Sim::pinLevel(uint8_t pin)
+{
+    volatile uint8_t *out = portOutputRegister(digitalPinToPort(pin));
+    return out && (*out & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+    uint8_t channel = pin >= A0 ? pin - A0 : pin;
+    Sim::advance(Sim::ADC_CONVERSION_CYCLES);
+    return channel < 16 ? adcValue[channel] : 0;
+}
+
+void analogReference(uint8_t) {}
+
+void Sim::setAnalog(uint8_t channel, uint16_t value)
+{
+    if (channel < 16)
+        adcValue[channel] = value > 1023 ? 1023 : value;
+}
+
+uint16_t Sim::analog(uint8_t channel)
+{
+    return channel < 16 ? adcValue[channel] : 0;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(Sim::now() / (F_CPU / 1000UL));
+}
+
+unsigned long micros()
+{
+    return (unsigned long)(Sim::now() / Sim::CYCLES_PER_US);
+}
+
+void delay(unsigned long ms)
+{
+    Sim::advance((uint64_t)ms * (F_CPU / 1000UL));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    Sim::advance((uint64_t)us * Sim::CYCLES_PER_US);
+}
+
+// --- Print ---
+
+size_t Print::write(const uint8_t *buf, size_t len)
+{
+    size_t n = 0;
+    while (len--)
+        n += write(*buf++);
+    return n;
+}
+
+size_t Print::print(long n, int base)
+{
+    if (base == 10)
+    {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%ld", n);
+        return write(buf);
+    }
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    char buf[40];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    if (base < 2)
+        base = 10;
+    do
+    {
+        unsigned long d = n % base;
+        *--p = d < 10 ? '0' + d : 'A' + d - 10;
+        n /= base;
+    } while (n);
+    return write(p);
+}
+
+size_t Print::print(double n, int digits)
+{
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+}
+
+// --- HardwareSerial ---
+
+struct SimSerialPort
+{
+    uint8_t index;
+    uint64_t charCycles = 0;
+    bool echo = false;
+
+    struct Byte
+    {
+        uint64_t at; // Cycle the stop bit completes
+        uint8_t value;
+    };
+    std::deque<Byte> rx;
+    std::deque<Byte> tx;
+    uint64_t rxLast = 0;
+    uint64_t txFree = 0; // Line idle from this cycle
+};
+
+HardwareSerial::HardwareSerial(uint8_t index)
+    : state(new SimSerialPort())
+{
+    state->index = index;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint8_t config)
+{
+    // Start + 8 data + parity? + stop
+    uint8_t bits = (config & 0x30) ? 11 : 10;
+    state->charCycles = (uint64_t)F_CPU * bits / baud;
+}
+
+int HardwareSerial::available()
+{
+    int n = 0;
+    for (const SimSerialPort::Byte &b : state->rx)
+    {
+        if (b.at > Sim::now())
+            break;
+        n++;
+    }
+    return n;
+}
+
+int HardwareSerial::read()
+{
+    if (state->rx.empty() || state->rx.front().at > Sim::now())
+        return -1;
+    uint8_t v = state->rx.front().value;
+    state->rx.pop_front();
+    return v;
+}
+
+int HardwareSerial::peek()
+{
+    if (state->rx.empty() || state->rx.front().at > Sim::now())
+        return -1;
+    return state->rx.front().value;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    size_t queued = 0;
+    for (const SimSerialPort::Byte &b : state->tx)
+    {
+        if (b.at > Sim::now())
+            queued++;
+    }
+    return queued >= SERIAL_TX_BUFFER_SIZE ? 0 : (int)(SERIAL_TX_BUFFER_SIZE - 1 - queued);
+}
+
+void HardwareSerial::flush()
+{
+    Sim::advanceTo(state->txFree);
+}
+
+size_t HardwareSerial::write(uint8_t b)
+{
+    // Full TX ring: wait for the UDRE interrupt to make room, as the core does
+    while (availableForWrite() == 0)
+    {
+        for (const SimSerialPort::Byte &q : state->tx)
+        {
+            if (q.at > Sim::now())
+            {
+                Sim::advanceTo(q.at);
+                break;
+            }
+        }
+    }
+
+    Sim::advance(Sim::SERIAL_BYTE_CYCLES);
+    uint64_t start = state->txFree > Sim::now() ? state->txFree : Sim::now();
+    state->txFree = start + state->charCycles;
+    state->tx.push_back({state->txFree, b});
+    while (state->tx.size() > 4096 && state->tx.front().at <= Sim::now())
+        state->tx.pop_front(); // Nobody is listening on this port
+
+    if (state->echo)
+        fputc(b, stdout);
+    return 1;
+}
+
+void HardwareSerial::simInject(const uint8_t *data, size_t len)
+{
+    uint64_t at = state->rxLast > Sim::now() ? state->rxLast : Sim::now();
+    for (size_t i = 0; i < len; i++)
+    {
+        at += state->charCycles;
+        state->rx.push_back({at, data[i]});
+    }
+    state->rxLast = at;
+}
+
+size_t HardwareSerial::simTakeTx(uint8_t *out, size_t max, uint64_t *firstStartCycle)
+{
+    size_t n = 0;
+    while (n < max && !state->tx.empty() && state->tx.front().at <= Sim::now())
+    {
+        if (n == 0 && firstStartCycle)
+            *firstStartCycle = state->tx.front().at - state->charCycles;
+        out[n++] = state->tx.front().value;
+        state->tx.pop_front();
+    }
+    return n;
+}
+
+uint64_t HardwareSerial::simCharCycles() const
+{
+    return state->charCycles;
+}
+
+uint64_t HardwareSerial::simLastRxCycle() const
+{
+    return state->rxLast;
+}
+
+void HardwareSerial::simEcho(bool on)
+{
+    state->echo = on;
+}
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+HardwareSerial Serial3(3);
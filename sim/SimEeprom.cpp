@@ -0,0 +1,68 @@
+#include <string.h>
+#include <avr/eeprom.h>
+#include "Arduino.h"
+#include "SimKernel.h"
+
+namespace
+{
+    uint8_t cells[E2END + 1];
+    bool erased = false;
+    uint64_t readyAt = 0;
+
+    uint8_t *cell(const void *addr)
+    {
+        if (!erased)
+        {
+            memset(cells, 0xFF, sizeof(cells));
+            erased = true;
+        }
+        return &cells[(uintptr_t)addr & E2END];
+    }
+}
+
+bool eeprom_is_ready()
+{
+    return Sim::now() >= readyAt;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    // Reads stall until a pending write has finished
+    Sim::advanceTo(readyAt);
+    return *cell(addr);
+}
+
+uint16_t eeprom_read_word(const uint16_t *addr)
+{
+    const uint8_t *p = (const uint8_t *)addr;
+    return eeprom_read_byte(p) | (uint16_t)eeprom_read_byte(p + 1) << 8;
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t len)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    while (len--)
+        *d++ = eeprom_read_byte(s++);
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+    Sim::advanceTo(readyAt);
+    *cell(addr) = value;
+    readyAt = Sim::now() + Sim::EEPROM_WRITE_CYCLES;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    if (eeprom_read_byte(addr) != value)
+        eeprom_write_byte(addr, value);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t len)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    uint8_t *d = (uint8_t *)dst;
+    while (len--)
+        eeprom_update_byte(d++, *s++);
+}
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include "Arduino.h"
+#include "SimKernel.h"
+
+// --- Register file ---
+volatile uint8_t
+    TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, ASSR,
+    GTCCR, TCCR1A, TCCR1B, TCCR1C, TCCR3A, TCCR3B, TCCR3C, TCCR4A, TCCR4B, TCCR4C, TCCR5A, TCCR5B,
+    TCCR5C, TIMSK1, TIMSK3, TIMSK4, TIMSK5, SREG, PORTA, PORTB, PORTC, PORTD, PORTE, PORTF, PORTG,
+    PORTH, PORTJ, PORTK, PORTL, DDRA, DDRB, DDRC, DDRD, DDRE, DDRF, DDRG, DDRH, DDRJ, DDRK, DDRL,
+    PINA, PINB, PING, PINL, UCSR0A, UCSR0B, UCSR1A, UDR0, GPIOR0, GPIOR1, GPIOR2, MCUSR, SPL, SPH,
+    ADCSRA, ADMUX, ADCL, ADCH;
+volatile uint16_t
+    ICR1, ICR3, ICR4, ICR5, OCR1A, OCR1B, OCR1C, OCR3A, OCR3B, OCR3C, OCR4A, OCR4B, OCR4C, OCR5A,
+    OCR5B, OCR5C, TCNT1, TCNT3, TCNT4, TCNT5, SP, ADC;
+SimFlagRegister
+    TIFR0, TIFR2, TIFR1, TIFR3, TIFR4, TIFR5;
+
+// ISRs defined by the firmware; weak so unused vectors stay null
+extern "C" void sim_vector_timer0_compa(void) __attribute__((weak));
+extern "C" void sim_vector_timer0_compb(void) __attribute__((weak));
+extern "C" void sim_vector_timer0_ovf(void) __attribute__((weak));
+extern "C" void sim_vector_timer2_ovf(void) __attribute__((weak));
+
+namespace
+{
+    // Clock-select -> prescaler (Timer0 and Timer2 differ)
+    const uint16_t TIMER0_PRESCALERS[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    const uint16_t TIMER2_PRESCALERS[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+    uint64_t cycle = 0;
+    uint32_t timer0Acc = 0; // Cycles since the last Timer0 tick
+    uint32_t timer2Acc = 0;
+    bool inIsr = false;
+    Sim::Stats counters;
+
+    void runIsr(void (*isr)(void), uint64_t &count)
+    {
+        count++;
+        if (!isr)
+            return;
+        // Hardware clears I on entry and RETI sets it again
+        inIsr = true;
+        SREG &= (uint8_t)~_BV(SREG_I);
+        isr();
+        SREG |= _BV(SREG_I);
+        inIsr = false;
+    }
+
+    // Services pending flags in vector order (TIMER2_OVF = 15, TIMER0_COMPA = 21, ...)
+    void dispatch()
+    {
+        if (inIsr || !(SREG & _BV(SREG_I)))
+            return;
+
+        if ((TIFR2 & _BV(TOV2)) && (TIMSK2 & _BV(TOIE2)))
+        {
+            TIFR2 = _BV(TOV2);
+            runIsr(sim_vector_timer2_ovf, counters.timer2Ovf);
+        }
+        if ((TIFR0 & _BV(OCF0A)) && (TIMSK0 & _BV(OCIE0A)))
+        {
+            TIFR0 = _BV(OCF0A);
+            runIsr(sim_vector_timer0_compa, counters.timer0CompA);
+        }
+        if ((TIFR0 & _BV(OCF0B)) && (TIMSK0 & _BV(OCIE0B)))
+        {
+            TIFR0 = _BV(OCF0B);
+            runIsr(sim_vector_timer0_compb, counters.timer0CompB);
+        }
+        if ((TIFR0 & _BV(TOV0)) && (TIMSK0 & _BV(TOIE0)))
+        {
+            TIFR0 = _BV(TOV0);
+            uint64_t dummy = 0;
+            runIsr(sim_vector_timer0_ovf, dummy);
+        }
+    }
+
+    // Cycles until the next Timer0 compare match or wrap
+    uint64_t timer0NextEvent(uint16_t prescaler)
+    {
+        uint8_t t = TCNT0;
+        uint16_t ticks = 256 - t; // to wrap
+        uint8_t a = OCR0A, b = OCR0B;
+        if (a > t && a - t < ticks)
+            ticks = a - t;
+        if (b > t && b - t < ticks)
+            ticks = b - t;
+        return (uint64_t)ticks * prescaler - timer0Acc;
+    }
+
+    uint64_t timer2NextEvent(uint16_t prescaler)
+    {
+        return (uint64_t)(256 - TCNT2) * prescaler - timer2Acc;
+    }
+
+    void stepTimers(uint64_t cycles)
+    {
+        uint16_t p0 = TIMER0_PRESCALERS[TCCR0B & 0x07];
+        if (p0)
+        {
+            timer0Acc += cycles;
+            while (timer0Acc >= p0)
+            {
+                timer0Acc -= p0;
+                uint8_t t = TCNT0 + 1;
+                TCNT0 = t;
+                if (t == 0)
+                    TIFR0.set(_BV(TOV0));
+                if (t == OCR0A)
+                    TIFR0.set(_BV(OCF0A));
+                if (t == OCR0B)
+                    TIFR0.set(_BV(OCF0B));
+            }
+        }
+
+        uint16_t p2 = TIMER2_PRESCALERS[TCCR2B & 0x07];
+        if (p2)
+        {
+            timer2Acc += cycles;
+            uint32_t ticks = timer2Acc / p2;
+            timer2Acc %= p2;
+            uint32_t t = TCNT2 + ticks;
+            if (t >= 256)
+                TIFR2.set(_BV(TOV2)); // Steps never cross more than one wrap
+            TCNT2 = (uint8_t)t;
+        }
+    }
+}
+
+void Sim::begin()
+{
+    cycle = 0;
+    timer0Acc = 0;
+    timer2Acc = 0;
+    counters = Stats();
+
+    // Arduino init(): Timer0 fast PWM clk/64 with its overflow ISR,
+    // Timer2 phase-correct clk/64, interrupts on
+    TCCR0A = _BV(WGM01) | _BV(WGM00);
+    TCCR0B = _BV(CS01) | _BV(CS00);
+    TIMSK0 = _BV(TOIE0);
+    TCCR2A = _BV(WGM20);
+    TCCR2B = _BV(CS22);
+    MCUSR = _BV(PORF);
+    SREG = _BV(SREG_I);
+}
+
+uint64_t Sim::now()
+{
+    return cycle;
+}
+
+void Sim::advance(uint64_t cycles)
+{
+    dispatch(); // Anything that became pending while interrupts were off
+
+    while (cycles)
+    {
+        // A prescaler reset restarts the Timer2 prescaler count (self-clearing)
+        if (GTCCR & _BV(PSRASY))
+        {
+            timer2Acc = 0;
+            GTCCR &= (uint8_t)~_BV(PSRASY);
+        }
+
+        // Step to the next timer event so ISRs run at the right count
+        uint64_t step = cycles;
+        uint16_t p0 = TIMER0_PRESCALERS[TCCR0B & 0x07];
+        uint16_t p2 = TIMER2_PRESCALERS[TCCR2B & 0x07];
+        if (p0)
+        {
+            uint64_t e = timer0NextEvent(p0);
+            if (e < step)
+                step = e;
+        }
+        if (p2)
+        {
+            uint64_t e = timer2NextEvent(p2);
+            if (e < step)
+                step = e;
+        }
+        if (step == 0)
+            step = 1;
+
+        stepTimers(step);
+        cycle += step;
+        cycles -= step;
+        dispatch();
+    }
+}
+
+void Sim::advanceTo(uint64_t target)
+{
+    if (target > cycle)
+        advance(target - cycle);
+}
+
+const Sim::Stats &Sim::stats()
+{
+    return counters;
+}
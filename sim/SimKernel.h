@@ -0,0 +1,55 @@
+// Simulation kernel for the native build.
+//
+// Time is a 64-bit CPU cycle counter at F_CPU. It only moves when something
+// charges time: the harness charges a fixed cost per loop pass, and the
+// peripheral shims charge what the real operation takes on the bus (ADC
+// conversion, 1-Wire slots, UART characters, delay()). Firmware arithmetic
+// itself is free, so measured figures are a lower bound dominated by I/O.
+//
+// While time advances, Timer0 and Timer2 count with their configured
+// prescalers, compare/overflow flags are raised, and the matching ISRs run
+// whenever SREG.I is set — the same interrupt interleaving the firmware sees
+// on the target, at whatever speed the host can manage.
+#pragma once
+#include <stdint.h>
+
+namespace Sim
+{
+    // --- Cost model (CPU cycles) ---
+    constexpr uint32_t CYCLES_PER_US = F_CPU / 1000000UL;
+    constexpr uint32_t LOOP_PASS_CYCLES = 40 * CYCLES_PER_US;      // Scheduler pass + register scans
+    constexpr uint32_t ADC_CONVERSION_CYCLES = 13 * 128;          // 13 ADC clocks at clk/128
+    constexpr uint32_t ONEWIRE_RESET_CYCLES = 960 * CYCLES_PER_US; // Reset pulse + presence
+    constexpr uint32_t ONEWIRE_SLOT_CYCLES = 65 * CYCLES_PER_US;   // One read/write time slot
+    constexpr uint32_t EEPROM_WRITE_CYCLES = 3300 * CYCLES_PER_US;
+    constexpr uint32_t MODBUS_REQUEST_CYCLES = 250 * CYCLES_PER_US; // Frame decode + reply build
+    constexpr uint32_t SERIAL_BYTE_CYCLES = 2 * CYCLES_PER_US;     // Copy into the TX ring
+
+    // Resets time and the register file to what the Arduino core's init()
+    // leaves behind (interrupts on, Timer2 at clk/64)
+    void begin();
+
+    uint64_t now();                   // Cycles since begin()
+    inline double seconds() { return now() / (double)F_CPU; }
+
+    void advance(uint64_t cycles);    // Charge time; runs due ISRs
+    void advanceTo(uint64_t cycle);
+
+    // Interrupt counters
+    struct Stats
+    {
+        uint64_t timer0CompA;
+        uint64_t timer0CompB;
+        uint64_t timer2Ovf;
+    };
+    const Stats &stats();
+
+    // --- Peripheral models driven by the harness ---
+    void setAnalog(uint8_t channel, uint16_t value); // ADC channel 0–15, 10-bit
+    uint16_t analog(uint8_t channel);
+    uint8_t pinLevel(uint8_t pin);                   // Output latch of a digital pin
+
+    // One DS18B20 on the 1-Wire bus at `pin`
+    void setTemperature(uint8_t pin, float celsius);
+    void setSensorPresent(uint8_t pin, bool present);
+}
@@ -0,0 +1,274 @@
+// Native entry point: boots the firmware exactly as the Arduino core would
+// (init(), setup(), then loop() forever) against the simulated peripherals,
+// with a small plant model for the motors and a scripted Modbus master on
+// Serial. At the end it prints simulated vs. wall time and what the
+// firmware itself measured (scheduler, profiler and boot registers).
+//
+//   hwi_sim [seconds] [--echo] [--capture trace.bin] [--replay trace.bin]
+//
+// --echo copies the Serial1 telemetry stream to stdout.
+// --capture turns on TRACE_CTRL at 0.5 s and saves the Serial1 trace.
+// --replay drives the firmware from a trace instead of the plant and the
+//   script (runs until the trace is exhausted) and compares the outputs.
+//
+// Left out of `pio test` builds, where each suite in test/ has its own main().
+#include <chrono>
+#include "SimMaster.h"
+#include "SimReplay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "ArduinoModbus.h"
+#include "SimKernel.h"
+#include "Config.h"
+#include "MotorTable.h"
+#include "Scheduler.h"
+#include "EventLog.h"
+
+#ifndef PIO_UNIT_TESTING
+
+namespace
+{
+    constexpr uint64_t MS = 1000ULL * Sim::CYCLES_PER_US;
+
+    // --- Plant: current follows the applied duty, temperature lags it ---
+    struct Plant
+    {
+        uint64_t next = 0;
+        float celsius[NUM_MOTORS];
+
+        // Sensor zero spread around Vcc/2, for the auto-zero to find
+        static uint16_t zeroCounts(uint8_t i) { return 510 + i % 5; }
+
+        void begin()
+        {
+            for (uint8_t i = 0; i < NUM_MOTORS; i++)
+            {
+                celsius[i] = 25.0f;
+                Sim::setTemperature(Board::TEMP_PINS[i], celsius[i]);
+                Sim::setAnalog(Board::CURRENT_PINS[i] - A0, zeroCounts(i));
+            }
+            Sim::setTemperature(AIR_TEMP_PIN, 24.0f);
+            Sim::setTemperature(WATER_TEMP_PIN, 18.0f);
+        }
+
+        void step()
+        {
+            if (Sim::now() < next)
+                return;
+            next = Sim::now() + MS;
+
+            for (uint8_t i = 0; i < NUM_MOTORS; i++)
+            {
+                uint16_t duty = motorTable.outputDuty[i];
+                if (duty > motorTable.dutyLimit[i])
+                    duty = motorTable.dutyLimit[i];
+
+                // ACS712-30A at 5 V: 100 mA per % duty, 13.5 counts per A
+                Sim::setAnalog(Board::CURRENT_PINS[i] - A0, zeroCounts(i) + duty * 135 / 100);
+
+                // Settles at 25 °C + 0.4 °C per % duty, 20 s time constant
+                float target = 25.0f + duty * 0.4f;
+                celsius[i] += (target - celsius[i]) * (1.0f / 20000.0f);
+                Sim::setTemperature(Board::TEMP_PINS[i], celsius[i]);
+            }
+        }
+    };
+
+    // --- Scripted traffic: current auto-zero at 0.55 s, START at 1 s, a new
+    // duty for every motor each second from 3 s, and register polls every
+    // 50 ms in between ---
+    struct Script
+    {
+        static constexpr uint64_t POLL_PERIOD = 50 * MS;
+
+        bool capture = false; // Sets TRACE_CTRL at 0.5 s
+        uint64_t next = 0;
+        uint32_t sequence = 0;
+
+        void step(SimMaster &master)
+        {
+            if (Sim::now() < next || !master.idle())
+                return;
+            next += POLL_PERIOD;
+
+            uint32_t n = sequence++;
+            uint32_t second = n / (1000 / 50);
+            uint32_t slot = n % (1000 / 50);
+
+            if (capture && n == 10)
+                master.write(ModbusHoldingReg::TRACE_CTRL, 1);
+            else if (n == 11)
+                master.write(ModbusHoldingReg::CURR_ZERO, MOTOR_MASK);
+            else if (second == 1 && slot == 0)
+                master.write(ModbusHoldingReg::START_REG_ADDR, 1);
+            else if (second >= 3 && slot == 1)
+            {
+                uint16_t duties[NUM_MOTORS];
+                for (uint8_t i = 0; i < NUM_MOTORS; i++)
+                    duties[i] = (second * 20) % 100;
+                master.write(ModbusHoldingReg::DUTY_BASE, duties, NUM_MOTORS);
+            }
+            else if (slot & 1)
+                master.readHolding(0, 2 * NUM_MOTORS + 1);
+            else
+                master.readInput(ModbusInputReg::CURR_BASE, 3 * NUM_MOTORS);
+        }
+    };
+
+    double us(uint64_t cycles)
+    {
+        return cycles / (double)Sim::CYCLES_PER_US;
+    }
+
+    long ireg(uint16_t reg)
+    {
+        return ModbusRTUServer.inputRegisterRead(reg);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 10.0;
+    bool echo = false;
+    const char *capturePath = nullptr;
+    const char *replayPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--echo"))
+            echo = true;
+        else if (!strcmp(argv[i], "--capture") && i + 1 < argc)
+            capturePath = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replayPath = argv[++i];
+        else
+            seconds = atof(argv[i]);
+    }
+
+    Plant plant;
+    Script script;
+    SimMaster master;
+    SimReplay replay;
+    FILE *capture = nullptr;
+
+    if (replayPath && !replay.load(replayPath))
+    {
+        fprintf(stderr, "%s: no trace found\n", replayPath);
+        return 1;
+    }
+    if (capturePath)
+    {
+        capture = fopen(capturePath, "wb");
+        if (!capture)
+        {
+            perror(capturePath);
+            return 1;
+        }
+        script.capture = true;
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    Sim::begin();
+    plant.begin();
+    Serial1.simEcho(echo && !capture && !replayPath);
+    setup();
+
+    uint64_t end = (uint64_t)(seconds * F_CPU);
+    uint64_t passes = 0;
+    while (replayPath ? !replay.finished() : Sim::now() < end)
+    {
+        loop();
+        Sim::advance(Sim::LOOP_PASS_CYCLES);
+        if (replayPath)
+            replay.step(master);
+        else
+        {
+            plant.step();
+            script.step(master);
+        }
+        master.step();
+
+        if (capture)
+        {
+            uint8_t chunk[256];
+            size_t n;
+            while ((n = Serial1.simTakeTx(chunk, sizeof(chunk))) > 0)
+                fwrite(chunk, 1, n, capture);
+        }
+        passes++;
+    }
+    if (capture)
+        fclose(capture);
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    const Sim::Stats &stats = Sim::stats();
+
+    printf("\n--- Simulation ---\n");
+    printf("simulated %.3f s in %.3f s wall (%.1fx), %llu loop passes\n",
+           Sim::seconds(), wall, Sim::seconds() / wall, (unsigned long long)passes);
+    printf("ISRs: TIMER0_COMPA %llu, TIMER0_COMPB %llu, TIMER2_OVF %llu\n",
+           (unsigned long long)stats.timer0CompA, (unsigned long long)stats.timer0CompB,
+           (unsigned long long)stats.timer2Ovf);
+
+    printf("\n--- Modbus master ---\n");
+    printf("requests %u, responses %u, timeouts %u, errors %u\n",
+           master.requests, master.responses, master.timeouts, master.errors);
+    if (master.responses)
+        printf("latency (end of request to first reply byte): min %.0f us, avg %.0f us, max %.0f us\n",
+               us(master.latencyMin), us(master.latencySum / master.responses), us(master.latencyMax));
+    if (replayPath)
+        replay.report();
+
+    printf("\n--- Boot (firmware registers) ---\n");
+    printf("safe %ld us, modbus %ld us, config %ld us, ready %ld us, sensors %ld ms, reset cause 0x%02lX\n",
+           ireg(ModbusInputReg::BOOT_SAFE_US), ireg(ModbusInputReg::BOOT_MODBUS_US),
+           ireg(ModbusInputReg::BOOT_CONFIG_US), ireg(ModbusInputReg::BOOT_READY_US),
+           ireg(ModbusInputReg::BOOT_SENSORS_MS), ireg(ModbusInputReg::BOOT_RESET_CAUSE));
+
+    printf("\n--- Scheduler (per task: misses, overruns, max jitter us, max slice us) ---\n");
+    for (uint8_t t = 0; t < Scheduler::MAX_TASKS; t++)
+    {
+        uint16_t reg = ModbusInputReg::SCHED_BASE + t * Scheduler::REGS_PER_TASK;
+        if (ireg(reg) || ireg(reg + 1) || ireg(reg + 2) || ireg(reg + 3))
+            printf("task %2u: %5ld %5ld %6ld %6ld\n", t, ireg(reg), ireg(reg + 1), ireg(reg + 2), ireg(reg + 3));
+    }
+    printf("idle %ld %%, protection pass %ld cycles\n",
+           ireg(ModbusInputReg::DIAG_IDLE_PCT), ireg(ModbusInputReg::PROTECTION_CYCLES));
+
+    printf("\n--- Motors ---\n");
+    for (uint8_t i = 0; i < NUM_MOTORS; i++)
+        printf("motor %2u: duty %3u%%, current %5ld mA (zero %u), temp %5d, winding %5d, status %ld, poll tier %ld, rate %4d\n", i,
+               motorTable.outputDuty[i], ireg(ModbusInputReg::CURR_BASE + i), motorTable.currentOffset[i],
+               (int16_t)ireg(ModbusInputReg::TEMP_BASE + i), (int16_t)ireg(ModbusInputReg::WINDING_TEMP_BASE + i),
+               ireg(ModbusInputReg::STATUS_BASE + i),
+               ireg(ModbusInputReg::TEMP_TIER_BASE + i), (int16_t)ireg(ModbusInputReg::TEMP_RATE_BASE + i));
+    printf("air %d, water %d, poll tiers %ld/%ld\n", (int16_t)ireg(ModbusHoldingReg::AIR_TEMP_REG),
+           (int16_t)ireg(ModbusHoldingReg::WATER_TEMP_REG),
+           ireg(ModbusInputReg::TEMP_TIER_BASE + MAX_MOTORS), ireg(ModbusInputReg::TEMP_TIER_BASE + MAX_MOTORS + 1));
+    printf("current auto-zero: pending 0x%04x, failed 0x%04lx\n",
+           (unsigned)ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::CURR_ZERO),
+           ireg(ModbusInputReg::CURR_ZERO_FAILED));
+
+    printf("\n--- Interrupts ---\n");
+    printf("TIMER2_OVF latency max %ld us, late %ld; longest interrupts-off window %ld us (site %ld)\n",
+           ireg(ModbusInputReg::IRQ_T2_LATENCY_US), ireg(ModbusInputReg::IRQ_T2_LATE),
+           ireg(ModbusInputReg::IRQ_CS_MAX_US), ireg(ModbusInputReg::IRQ_CS_MAX_SITE));
+    printf("RX budget %ld us, over budget %ld, timebase went backwards %ld times\n",
+           ireg(ModbusInputReg::IRQ_RX_BUDGET_US), ireg(ModbusInputReg::IRQ_OVER_BUDGET),
+           ireg(ModbusInputReg::TIME_BACKWARDS));
+
+    printf("\n--- Event log (head %ld, lost %ld) ---\n", ireg(ModbusInputReg::EVENT_HEAD),
+           ireg(ModbusInputReg::EVENT_LOST));
+    for (uint16_t seq = EventLog::headSequence() - EVENT_LOG_ENTRIES; seq != EventLog::headSequence(); seq++)
+    {
+        EventLog::Entry e;
+        if (EventLog::get(seq, e))
+            printf("#%-5u %8lu ms  code %2u  motor %3u  value %u\n", seq, (unsigned long)e.timeLow, e.code,
+                   e.motor, e.value);
+    }
+    return 0;
+}
+
+#endif // PIO_UNIT_TESTING
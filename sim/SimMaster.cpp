@@ -0,0 +1,112 @@
+#include <util/crc16.h>
+#include "SimMaster.h"
+#include "Arduino.h"
+#include "Config.h"
+
+namespace
+{
+    uint16_t crc(const uint8_t *data, size_t len)
+    {
+        uint16_t c = 0xFFFF;
+        while (len--)
+            c = _crc16_update(c, *data++);
+        return c;
+    }
+}
+
+void SimMaster::queue(const std::vector<uint8_t> &pdu)
+{
+    pending.push_back(pdu);
+}
+
+void SimMaster::readHolding(uint16_t start, uint16_t count)
+{
+    queue({0x03, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(count >> 8), (uint8_t)count});
+}
+
+void SimMaster::readInput(uint16_t start, uint16_t count)
+{
+    queue({0x04, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(count >> 8), (uint8_t)count});
+}
+
+void SimMaster::write(uint16_t reg, uint16_t value)
+{
+    queue({0x06, (uint8_t)(reg >> 8), (uint8_t)reg, (uint8_t)(value >> 8), (uint8_t)value});
+}
+
+void SimMaster::write(uint16_t start, const uint16_t *values, uint16_t count)
+{
+    std::vector<uint8_t> pdu = {0x10, (uint8_t)(start >> 8), (uint8_t)start,
+                                (uint8_t)(count >> 8), (uint8_t)count, (uint8_t)(2 * count)};
+    for (uint16_t i = 0; i < count; i++)
+    {
+        pdu.push_back(values[i] >> 8);
+        pdu.push_back(values[i] & 0xFF);
+    }
+    queue(pdu);
+}
+
+void SimMaster::send(const std::vector<uint8_t> &pdu)
+{
+    std::vector<uint8_t> frame;
+    frame.push_back(SLAVE_ID);
+    frame.insert(frame.end(), pdu.begin(), pdu.end());
+    uint16_t c = crc(frame.data(), frame.size());
+    frame.push_back(c & 0xFF);
+    frame.push_back(c >> 8);
+
+    Serial.simInject(frame.data(), frame.size());
+    requestEnd = Serial.simLastRxCycle();
+
+    uint8_t function = pdu[0];
+    uint16_t count = (uint16_t)pdu[3] << 8 | pdu[4];
+    expected = function == 0x03 || function == 0x04 ? 5 + 2 * count : 8;
+    rx.clear();
+    waiting = true;
+    requests++;
+}
+
+void SimMaster::receive()
+{
+    uint64_t first = 0;
+    uint8_t chunk[64];
+    size_t n;
+    while ((n = Serial.simTakeTx(chunk, sizeof(chunk), &first)) > 0)
+    {
+        if (rx.empty())
+            responseStart = first;
+        rx.insert(rx.end(), chunk, chunk + n);
+    }
+
+    bool exception = rx.size() >= 2 && (rx[1] & 0x80);
+    size_t want = exception ? 5 : expected;
+    if (rx.size() >= want)
+    {
+        uint16_t c = crc(rx.data(), want - 2);
+        if (exception || c != (rx[want - 2] | (uint16_t)rx[want - 1] << 8))
+            errors++;
+
+        uint64_t latency = responseStart - requestEnd;
+        latencyMin = latency < latencyMin ? latency : latencyMin;
+        latencyMax = latency > latencyMax ? latency : latencyMax;
+        latencySum += latency;
+        responses++;
+        waiting = false;
+    }
+    else if (Sim::now() > requestEnd + TIMEOUT)
+    {
+        timeouts++;
+        waiting = false;
+    }
+}
+
+void SimMaster::step()
+{
+    if (waiting)
+        receive();
+    if (!waiting && !pending.empty())
+    {
+        send(pending.front());
+        pending.pop_front();
+    }
+}
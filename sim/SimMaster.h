@@ -0,0 +1,44 @@
+// Modbus RTU master on the far end of Serial for the native build. One
+// request is in flight at a time; the next is sent once the reply is in or
+// after TIMEOUT. Latency runs from the last request byte to the first
+// reply byte.
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "SimKernel.h"
+
+class SimMaster
+{
+public:
+    static constexpr uint64_t TIMEOUT = 100000ULL * Sim::CYCLES_PER_US;
+
+    // Queues a request; `pdu` starts with the function code
+    void queue(const std::vector<uint8_t> &pdu);
+    void readHolding(uint16_t start, uint16_t count);
+    void readInput(uint16_t start, uint16_t count);
+    void write(uint16_t reg, uint16_t value);
+    void write(uint16_t start, const uint16_t *values, uint16_t count);
+
+    bool idle() const { return !waiting && pending.empty(); }
+    void step(); // Sends, receives and times out; call every loop pass
+
+    uint32_t requests = 0;
+    uint32_t responses = 0;
+    uint32_t timeouts = 0;
+    uint32_t errors = 0;
+    uint64_t latencyMin = UINT64_MAX;
+    uint64_t latencyMax = 0;
+    uint64_t latencySum = 0;
+
+private:
+    void send(const std::vector<uint8_t> &pdu);
+    void receive();
+
+    std::deque<std::vector<uint8_t>> pending;
+    bool waiting = false;
+    uint64_t requestEnd = 0;
+    uint64_t responseStart = 0;
+    uint16_t expected = 0;
+    std::vector<uint8_t> rx;
+};
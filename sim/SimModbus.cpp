@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <util/crc16.h>
+#include "ArduinoModbus.h"
+#include "SimKernel.h"
+
+RS485Class RS485;
+ModbusRTUServerClass ModbusRTUServer;
+
+namespace
+{
+    constexpr uint64_t FRAME_GAP_CYCLES = 1750 * Sim::CYCLES_PER_US;
+
+    uint16_t crc(const uint8_t *data, uint8_t len)
+    {
+        uint16_t c = 0xFFFF;
+        while (len--)
+            c = _crc16_update(c, *data++);
+        return c;
+    }
+
+    uint16_t word(const uint8_t *p)
+    {
+        return (uint16_t)p[0] << 8 | p[1];
+    }
+}
+
+int ModbusRTUServerClass::begin(int slave, unsigned long baudrate, uint16_t config)
+{
+    id = slave;
+    Serial.begin(baudrate, config);
+    running = true;
+    return 1;
+}
+
+void ModbusRTUServerClass::end()
+{
+    running = false;
+}
+
+int ModbusRTUServerClass::configureHoldingRegisters(int startAddress, int nb)
+{
+    free(holding);
+    holding = (uint16_t *)calloc(nb, sizeof(uint16_t));
+    holdingStart = startAddress;
+    holdingCount = nb;
+    return holding != nullptr;
+}
+
+int ModbusRTUServerClass::configureInputRegisters(int startAddress, int nb)
+{
+    free(input);
+    input = (uint16_t *)calloc(nb, sizeof(uint16_t));
+    inputStart = startAddress;
+    inputCount = nb;
+    return input != nullptr;
+}
+
+long ModbusRTUServerClass::holdingRegisterRead(int address)
+{
+    if (address < holdingStart || address >= holdingStart + holdingCount)
+        return -1;
+    return holding[address - holdingStart];
+}
+
+int ModbusRTUServerClass::holdingRegisterWrite(int address, uint16_t value)
+{
+    if (address < holdingStart || address >= holdingStart + holdingCount)
+        return 0;
+    holding[address - holdingStart] = value;
+    return 1;
+}
+
+long ModbusRTUServerClass::inputRegisterRead(int address)
+{
+    if (address < inputStart || address >= inputStart + inputCount)
+        return -1;
+    return input[address - inputStart];
+}
+
+int ModbusRTUServerClass::inputRegisterWrite(int address, uint16_t value)
+{
+    if (address < inputStart || address >= inputStart + inputCount)
+        return 0;
+    input[address - inputStart] = value;
+    return 1;
+}
+
+void ModbusRTUServerClass::reply(const uint8_t *frame, uint8_t len)
+{
+    uint16_t c = crc(frame, len);
+    Serial.write(frame, len);
+    Serial.write((uint8_t)(c & 0xFF));
+    Serial.write((uint8_t)(c >> 8));
+    Serial.flush(); // RS485Class::endTransmission() waits for the last stop bit
+}
+
+void ModbusRTUServerClass::exception(uint8_t function, uint8_t code)
+{
+    const uint8_t frame[3] = {id, (uint8_t)(function | 0x80), code};
+    reply(frame, sizeof(frame));
+}
+
+int ModbusRTUServerClass::poll()
+{
+    if (!running || !Serial.available())
+        return 0;
+    if (Sim::now() < Serial.simLastRxCycle() + FRAME_GAP_CYCLES)
+        return 0; // Frame still arriving
+
+    uint8_t frame[FRAME_MAX];
+    uint16_t len = 0;
+    while (Serial.available())
+    {
+        int b = Serial.read();
+        if (len < FRAME_MAX)
+            frame[len++] = b;
+    }
+
+    if (len < 4 || crc(frame, len - 2) != (frame[len - 2] | (uint16_t)frame[len - 1] << 8))
+        return -1;
+    if (frame[0] != id)
+        return 0; // Another slave's request
+
+    Sim::advance(Sim::MODBUS_REQUEST_CYCLES);
+
+    uint8_t function = frame[1];
+    uint8_t out[FRAME_MAX];
+    out[0] = id;
+    out[1] = function;
+
+    if (function == 0x03 || function == 0x04)
+    {
+        if (len != 8)
+            return -1;
+        uint16_t start = word(&frame[2]);
+        uint16_t count = word(&frame[4]);
+        uint16_t *table = function == 0x03 ? holding : input;
+        int base = function == 0x03 ? holdingStart : inputStart;
+        int size = function == 0x03 ? holdingCount : inputCount;
+
+        if (count == 0 || count > 125)
+        {
+            exception(function, 0x03);
+            return 1;
+        }
+        if (start < base || start + count > base + size)
+        {
+            exception(function, 0x02);
+            return 1;
+        }
+        out[2] = count * 2;
+        for (uint16_t i = 0; i < count; i++)
+        {
+            uint16_t v = table[start - base + i];
+            out[3 + 2 * i] = v >> 8;
+            out[4 + 2 * i] = v & 0xFF;
+        }
+        reply(out, 3 + count * 2);
+    }
+    else if (function == 0x06)
+    {
+        if (len != 8)
+            return -1;
+        if (!holdingRegisterWrite(word(&frame[2]), word(&frame[4])))
+        {
+            exception(function, 0x02);
+            return 1;
+        }
+        reply(frame, 6); // Echo of the request
+    }
+    else if (function == 0x10)
+    {
+        uint16_t start = word(&frame[2]);
+        uint16_t count = word(&frame[4]);
+        if (len < 9 || frame[6] != count * 2 || len != 9 + count * 2)
+            return -1;
+        if (count == 0 || count > 123)
+        {
+            exception(function, 0x03);
+            return 1;
+        }
+        if (start < holdingStart || start + count > holdingStart + holdingCount)
+        {
+            exception(function, 0x02);
+            return 1;
+        }
+        for (uint16_t i = 0; i < count; i++)
+            holding[start - holdingStart + i] = word(&frame[7 + 2 * i]);
+        reply(frame, 6);
+    }
+    else
+    {
+        exception(function, 0x01);
+    }
+    return 1;
+}
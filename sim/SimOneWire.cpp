@@ -0,0 +1,489 @@
+#include <math.h>
+#include <string.h>
+#include "Arduino.h"
+#include "OneWire.h"
+#include "DallasTemperature.h"
+#include "SimKernel.h"
+
+// --- DS18B20 device model, one per pin ---
+namespace
+{
+    enum Phase : uint8_t
+    {
+        IDLE,      // Waiting for a reset
+        ROM,       // Expecting a ROM command
+        MATCH,     // Receiving the 8 address bytes of MATCH ROM
+        FUNCTION,  // Addressed, expecting a function command
+        READ_PAD,  // Streaming the scratchpad
+        WRITE_PAD, // Receiving TH, TL, config
+        READ_ROM,  // Streaming the ROM code
+    };
+
+    struct Device
+    {
+        bool initialised = false;
+        bool present = true;
+        float celsius = 25.0f;
+        uint8_t rom[8];
+        uint8_t pad[9];
+        uint8_t savedPad[3]; // TH, TL, config in the sensor's EEPROM
+        uint64_t convertDone = 0;
+        bool converting = false;
+
+        Phase phase = IDLE;
+        uint8_t index = 0;
+        bool matched = true;
+    };
+
+    Device devices[NUM_DIGITAL_PINS];
+
+    uint8_t resolutionOf(const uint8_t *pad)
+    {
+        return 9 + ((pad[4] >> 5) & 0x03);
+    }
+
+    void sealPad(Device &d)
+    {
+        d.pad[8] = OneWire::crc8(d.pad, 8);
+    }
+
+    Device &device(uint8_t pin)
+    {
+        Device &d = devices[pin < NUM_DIGITAL_PINS ? pin : 0];
+        if (!d.initialised)
+        {
+            d.initialised = true;
+            const uint8_t rom[7] = {0x28, pin, 'S', 'I', 'M', 0x00, 0x00};
+            memcpy(d.rom, rom, 7);
+            d.rom[7] = OneWire::crc8(d.rom, 7);
+
+            // Power-on scratchpad: 85 °C, 12-bit
+            const uint8_t pad[8] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10};
+            memcpy(d.pad, pad, 8);
+            sealPad(d);
+            memcpy(d.savedPad, &d.pad[2], 3);
+        }
+        return d;
+    }
+
+    // Latches the converted temperature once the conversion time has passed
+    void settle(Device &d)
+    {
+        if (!d.converting || Sim::now() < d.convertDone)
+            return;
+        d.converting = false;
+
+        uint8_t res = resolutionOf(d.pad);
+        int16_t raw = (int16_t)lroundf(d.celsius * 16.0f);
+        raw &= (int16_t)(0xFFFF << (12 - res)); // Undefined low bits read as 0
+        d.pad[0] = raw & 0xFF;
+        d.pad[1] = (uint16_t)raw >> 8;
+        sealPad(d);
+    }
+
+    // One time slot. The OneWire library keeps interrupts off for the
+    // timing-critical start of each slot (writing a 0: 65 us, a 1: 10 us,
+    // a read: 13 us), so ISRs due meanwhile wait as they do on the board.
+    void slot(uint32_t offUs)
+    {
+        uint8_t sreg = SREG;
+        cli();
+        Sim::advance((uint64_t)offUs * Sim::CYCLES_PER_US);
+        SREG = sreg;
+        Sim::advance(Sim::ONEWIRE_SLOT_CYCLES - (uint64_t)offUs * Sim::CYCLES_PER_US);
+    }
+
+    void writeSlots(uint8_t v, uint8_t bits)
+    {
+        while (bits--)
+        {
+            slot(v & 1 ? 10 : 65);
+            v >>= 1;
+        }
+    }
+
+    void readSlots(uint32_t bits)
+    {
+        while (bits--)
+            slot(13);
+    }
+}
+
+void Sim::setTemperature(uint8_t pin, float celsius)
+{
+    device(pin).celsius = celsius;
+}
+
+void Sim::setSensorPresent(uint8_t pin, bool present)
+{
+    device(pin).present = present;
+}
+
+// --- OneWire ---
+
+void OneWire::begin(uint8_t p)
+{
+    pin = p;
+    searchDone = false;
+}
+
+uint8_t OneWire::reset()
+{
+    // 480 us low with interrupts on, then 70 us off around the presence
+    // sample, then the rest of the reset time slot
+    Sim::advance(480 * Sim::CYCLES_PER_US);
+    uint8_t sreg = SREG;
+    cli();
+    Sim::advance(70 * Sim::CYCLES_PER_US);
+    SREG = sreg;
+    Sim::advance(Sim::ONEWIRE_RESET_CYCLES - 550 * Sim::CYCLES_PER_US);
+    Device &d = device(pin);
+    settle(d);
+    d.phase = d.present ? ROM : IDLE;
+    d.matched = true;
+    return d.present;
+}
+
+void OneWire::select(const uint8_t rom[8])
+{
+    write(0x55);
+    for (uint8_t i = 0; i < 8; i++)
+        write(rom[i]);
+}
+
+void OneWire::skip()
+{
+    write(0xCC);
+}
+
+void OneWire::write(uint8_t v, uint8_t)
+{
+    writeSlots(v, 8);
+    Device &d = device(pin);
+    settle(d);
+
+    switch (d.phase)
+    {
+    case ROM:
+        if (v == 0xCC)
+            d.phase = FUNCTION;
+        else if (v == 0x55)
+        {
+            d.phase = MATCH;
+            d.index = 0;
+        }
+        else if (v == 0x33)
+        {
+            d.phase = READ_ROM;
+            d.index = 0;
+        }
+        else
+            d.phase = IDLE;
+        break;
+
+    case MATCH:
+        if (v != d.rom[d.index])
+            d.matched = false;
+        if (++d.index == 8)
+            d.phase = d.matched ? FUNCTION : IDLE;
+        break;
+
+    case FUNCTION:
+        d.index = 0;
+        if (v == 0x44) // CONVERT T
+        {
+            d.converting = true;
+            d.convertDone = Sim::now() + (750000UL >> (12 - resolutionOf(d.pad))) * Sim::CYCLES_PER_US;
+            d.phase = IDLE;
+        }
+        else if (v == 0xBE) // READ SCRATCHPAD
+            d.phase = READ_PAD;
+        else if (v == 0x4E) // WRITE SCRATCHPAD
+            d.phase = WRITE_PAD;
+        else if (v == 0x48) // COPY SCRATCHPAD
+        {
+            memcpy(d.savedPad, &d.pad[2], 3);
+            d.phase = IDLE;
+        }
+        else if (v == 0xB8) // RECALL E2
+        {
+            memcpy(&d.pad[2], d.savedPad, 3);
+            sealPad(d);
+            d.phase = IDLE;
+        }
+        else
+            d.phase = IDLE;
+        break;
+
+    case WRITE_PAD:
+        d.pad[2 + d.index] = v;
+        if (d.index == 2)
+            d.pad[4] = (v & 0x60) | 0x1F; // Only R1:R0 are writable
+        sealPad(d);
+        if (++d.index == 3)
+            d.phase = IDLE;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool)
+{
+    while (count--)
+        write(*buf++);
+}
+
+uint8_t OneWire::read()
+{
+    readSlots(8);
+    Device &d = device(pin);
+    settle(d);
+
+    if (d.phase == READ_PAD && d.index < 9)
+        return d.pad[d.index++];
+    if (d.phase == READ_ROM && d.index < 8)
+        return d.rom[d.index++];
+    return 0xFF; // Released bus reads as ones
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count)
+{
+    while (count--)
+        *buf++ = read();
+}
+
+void OneWire::write_bit(uint8_t v)
+{
+    writeSlots(v, 1);
+}
+
+uint8_t OneWire::read_bit()
+{
+    readSlots(1);
+    Device &d = device(pin);
+    if (!d.present)
+        return 1;
+    settle(d);
+    return d.converting ? 0 : 1; // Conversion in progress holds the line low
+}
+
+void OneWire::reset_search()
+{
+    searchDone = false;
+}
+
+bool OneWire::search(uint8_t *newAddr, bool)
+{
+    if (searchDone)
+        return false;
+    if (!reset())
+    {
+        searchDone = true;
+        return false;
+    }
+    // SEARCH ROM, then id bit, complement, direction per ROM bit
+    writeSlots(0xF0, 8);
+    const uint8_t *rom = device(pin).rom;
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        readSlots(2);
+        writeSlots(rom[i / 8] >> (i % 8), 1);
+    }
+    memcpy(newAddr, device(pin).rom, 8);
+    device(pin).phase = FUNCTION;
+    searchDone = true; // Single device per bus
+    return true;
+}
+
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
+{
+    uint8_t crc = 0;
+    while (len--)
+    {
+        uint8_t in = *addr++;
+        for (uint8_t i = 8; i; i--)
+        {
+            uint8_t mix = (crc ^ in) & 0x01;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0x8C;
+            in >>= 1;
+        }
+    }
+    return crc;
+}
+
+// --- DallasTemperature ---
+
+void DallasTemperature::begin()
+{
+    DeviceAddress address;
+    wire->reset_search();
+    devices = 0;
+    while (wire->search(address))
+    {
+        if (OneWire::crc8(address, 7) != address[7])
+            continue;
+        devices++;
+        uint8_t res = getResolution(address);
+        if (res > bitResolution)
+            bitResolution = res;
+    }
+}
+
+bool DallasTemperature::getAddress(uint8_t *address, uint8_t index)
+{
+    uint8_t depth = 0;
+    wire->reset_search();
+    while (depth <= index && wire->search(address))
+    {
+        if (depth == index && OneWire::crc8(address, 7) == address[7])
+            return true;
+        depth++;
+    }
+    return false;
+}
+
+bool DallasTemperature::readScratchPad(const uint8_t *address, uint8_t *scratchPad)
+{
+    if (!wire->reset())
+        return false;
+    wire->select(address);
+    wire->write(0xBE);
+    for (uint8_t i = 0; i < 9; i++)
+        scratchPad[i] = wire->read();
+    return wire->reset() != 0;
+}
+
+bool DallasTemperature::isConnected(const uint8_t *address)
+{
+    ScratchPad scratchPad;
+    return isConnected(address, scratchPad);
+}
+
+bool DallasTemperature::isConnected(const uint8_t *address, uint8_t *scratchPad)
+{
+    bool ok = readScratchPad(address, scratchPad);
+    bool zeros = true;
+    for (uint8_t i = 0; i < 9; i++)
+        zeros &= scratchPad[i] == 0;
+    return ok && !zeros && OneWire::crc8(scratchPad, 8) == scratchPad[8];
+}
+
+void DallasTemperature::writeScratchPad(const uint8_t *address, const uint8_t *scratchPad)
+{
+    wire->reset();
+    wire->select(address);
+    wire->write(0x4E);
+    wire->write(scratchPad[2]);
+    wire->write(scratchPad[3]);
+    wire->write(scratchPad[4]);
+
+    if (autoSave)
+    {
+        wire->reset();
+        wire->select(address);
+        wire->write(0x48);
+        delay(20); // Library waits for the sensor's EEPROM write
+    }
+    wire->reset();
+}
+
+void DallasTemperature::setResolution(uint8_t resolution)
+{
+    bitResolution = constrain(resolution, 9, 12);
+    DeviceAddress address;
+    for (uint8_t i = 0; i < devices; i++)
+    {
+        if (getAddress(address, i))
+            setResolution(address, bitResolution, true);
+    }
+}
+
+bool DallasTemperature::setResolution(const uint8_t *address, uint8_t resolution, bool)
+{
+    ScratchPad scratchPad;
+    if (!isConnected(address, scratchPad))
+        return false;
+
+    resolution = constrain(resolution, 9, 12);
+    uint8_t config = ((resolution - 9) << 5) | 0x1F;
+    if (scratchPad[4] != config)
+    {
+        scratchPad[4] = config;
+        writeScratchPad(address, scratchPad);
+    }
+    return true;
+}
+
+uint8_t DallasTemperature::getResolution(const uint8_t *address)
+{
+    ScratchPad scratchPad;
+    if (!isConnected(address, scratchPad))
+        return 0;
+    return resolutionOf(scratchPad);
+}
+
+DallasTemperature::request_t DallasTemperature::requestTemperatures()
+{
+    request_t req = {true, millis()};
+    wire->reset();
+    wire->skip();
+    wire->write(0x44);
+
+    if (waitForConversion)
+    {
+        unsigned long start = millis();
+        unsigned long limit = millisToWaitForConversion(bitResolution);
+        while (!isConversionComplete() && millis() - start < limit)
+            ;
+    }
+    return req;
+}
+
+bool DallasTemperature::isConversionComplete()
+{
+    return wire->read_bit() == 1;
+}
+
+int16_t DallasTemperature::millisToWaitForConversion(uint8_t resolution)
+{
+    switch (resolution)
+    {
+    case 9:
+        return 94;
+    case 10:
+        return 188;
+    case 11:
+        return 375;
+    default:
+        return 750;
+    }
+}
+
+int32_t DallasTemperature::getTemp(const uint8_t *address)
+{
+    ScratchPad scratchPad;
+    if (!isConnected(address, scratchPad))
+        return DEVICE_DISCONNECTED_RAW;
+    // 1/128 °C, as the library's calculateTemperature()
+    return (((int16_t)(int8_t)scratchPad[1]) << 11) | (((int16_t)scratchPad[0]) << 3);
+}
+
+float DallasTemperature::getTempC(const uint8_t *address)
+{
+    int32_t raw = getTemp(address);
+    if (raw <= DEVICE_DISCONNECTED_RAW)
+        return DEVICE_DISCONNECTED_C;
+    return raw * 0.0078125f;
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t index)
+{
+    DeviceAddress address;
+    if (!getAddress(address, index))
+        return DEVICE_DISCONNECTED_C;
+    return getTempC(address);
+}
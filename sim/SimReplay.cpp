@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include "SimReplay.h"
+#include "Arduino.h"
+#include "Trace.h"
+
+namespace
+{
+    // Temperature register -> 1-Wire pin
+    int sensorPin(uint8_t reg)
+    {
+        if (reg >= ModbusInputReg::TEMP_BASE && reg < ModbusInputReg::TEMP_BASE + NUM_MOTORS)
+            return Board::TEMP_PINS[reg - ModbusInputReg::TEMP_BASE];
+        if (reg == ModbusHoldingReg::AIR_TEMP_REG)
+            return AIR_TEMP_PIN;
+        if (reg == ModbusHoldingReg::WATER_TEMP_REG)
+            return WATER_TEMP_PIN;
+        return -1;
+    }
+}
+
+bool SimReplay::load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    SimTraceReader reader;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        reader.feed(chunk, n);
+    fclose(f);
+
+    SimTraceReader::Record r;
+    bool begun = false;
+    uint64_t clock = 0;
+    while (reader.next(r))
+    {
+        if (!begun && r.type != Trace::REC_BEGIN)
+            continue;
+        clock = begun ? clock + r.dt : 0;
+        begun = true;
+
+        Output out;
+        if (r.type == Trace::REC_BEGIN)
+        {
+            size_t pos = 1;
+            for (uint16_t reg = r.data[0]; pos < r.data.size() && reg < HOLDING_REG_COUNT; reg++)
+                image[reg] = SimTraceReader::varint(r.data, pos);
+        }
+        else if (r.type == Trace::REC_DROPPED)
+        {
+            size_t pos = 0;
+            recordedDrops += SimTraceReader::varint(r.data, pos);
+        }
+        else if (toOutput(r, clock, out))
+            expected.push_back(out);
+        else
+            inputs.push_back({clock, r.type, r.data});
+    }
+    return begun;
+}
+
+bool SimReplay::toOutput(const SimTraceReader::Record &r, uint64_t at, Output &out)
+{
+    if (r.type != Trace::REC_OUTPUT && r.type != Trace::REC_STATUS && r.type != Trace::REC_DEVICES)
+        return false;
+    out.at = at;
+    out.type = r.type;
+    out.id = r.type == Trace::REC_DEVICES ? 0 : r.data[0];
+    out.value = r.type == Trace::REC_DEVICES ? r.data[0] : r.data[1];
+    return true;
+}
+
+void SimReplay::apply(const Event &e, SimMaster &master)
+{
+    switch (e.type)
+    {
+    case Trace::REC_WRITE:
+    case Trace::REC_WRITE_MORE:
+    {
+        size_t pos = 0;
+        while (pos < e.data.size())
+        {
+            uint16_t reg = e.data[pos++];
+            writes.push_back(reg);
+            writes.push_back(SimTraceReader::varint(e.data, pos));
+        }
+        if (e.type == Trace::REC_WRITE_MORE)
+            break;
+
+        // One FC16 per run of consecutive registers
+        for (size_t i = 0; i < writes.size();)
+        {
+            uint16_t start = writes[i];
+            std::vector<uint16_t> values;
+            while (i < writes.size() && writes[i] == start + values.size())
+            {
+                values.push_back(writes[i + 1]);
+                i += 2;
+            }
+            master.write(start, values.data(), values.size());
+        }
+        writes.clear();
+        counts[0]++;
+        break;
+    }
+
+    case Trace::REC_POLL:
+        master.readHolding(0, 1);
+        counts[1]++;
+        break;
+
+    case Trace::REC_ADC:
+        Sim::setAnalog(Board::CURRENT_PINS[e.data[0]] - A0, e.data[1] | e.data[2] << 8);
+        counts[2]++;
+        break;
+
+    case Trace::REC_TEMP:
+    {
+        int pin = sensorPin(e.data[0]);
+        int16_t raw = (int16_t)(e.data[1] | e.data[2] << 8);
+        if (pin < 0)
+            break;
+        Sim::setSensorPresent(pin, raw != Trace::TEMP_DISCONNECTED);
+        if (raw != Trace::TEMP_DISCONNECTED)
+            Sim::setTemperature(pin, raw / 16.0f);
+        counts[3]++;
+        break;
+    }
+    }
+}
+
+// Parses the replayed firmware's own trace
+void SimReplay::collect()
+{
+    uint8_t chunk[256];
+    size_t n;
+    while ((n = Serial1.simTakeTx(chunk, sizeof(chunk))) > 0)
+        replayTrace.feed(chunk, n);
+
+    SimTraceReader::Record r;
+    while (replayTrace.next(r))
+    {
+        if (!replayBegun && r.type != Trace::REC_BEGIN)
+            continue;
+        replayClock = replayBegun ? replayClock + r.dt : 0;
+        replayBegun = true;
+
+        Output out;
+        if (toOutput(r, replayClock, out))
+            actual.push_back(out);
+        else if (r.type == Trace::REC_DROPPED)
+        {
+            size_t pos = 0;
+            replayDrops += SimTraceReader::varint(r.data, pos);
+        }
+    }
+}
+
+void SimReplay::step(SimMaster &master)
+{
+    collect();
+
+    switch (phase)
+    {
+    case BOOTING:
+        if (Sim::now() < BOOT_CYCLES)
+            break;
+        // One FC16 carries at most 123 registers: everything above
+        // TRACE_CTRL first, then the block that switches the capture on
+        master.write(ModbusHoldingReg::TRACE_CTRL + 1, image + ModbusHoldingReg::TRACE_CTRL + 1,
+                     HOLDING_REG_COUNT - ModbusHoldingReg::TRACE_CTRL - 1);
+        phase = PRIMING_HIGH;
+        break;
+
+    case PRIMING_HIGH:
+        if (!master.idle())
+            break;
+        master.write(0, image, ModbusHoldingReg::TRACE_CTRL + 1); // Ends with TRACE_CTRL = 1
+        phase = PRIMING;
+        break;
+
+    case PRIMING:
+        if (!master.idle())
+            break;
+        t0 = Sim::now();
+        phase = RUNNING;
+        // fall through
+    case RUNNING:
+        while (cursor < inputs.size() && Sim::now() >= t0 + inputs[cursor].at * Sim::CYCLES_PER_US)
+            apply(inputs[cursor++], master);
+        if (cursor == inputs.size())
+        {
+            settleEnd = Sim::now() + SETTLE_CYCLES;
+            phase = SETTLING;
+        }
+        break;
+
+    case SETTLING:
+        if (Sim::now() >= settleEnd && master.idle())
+            phase = DONE;
+        break;
+
+    case DONE:
+        break;
+    }
+}
+
+void SimReplay::report() const
+{
+    printf("\n--- Replay ---\n");
+    printf("inputs: %u requests with writes, %u without, %u ADC, %u temperature\n",
+           counts[0], counts[1], counts[2], counts[3]);
+    if (recordedDrops || replayDrops)
+        printf("dropped records: %u in the recording, %u in the replay (comparison is partial)\n",
+               recordedDrops, replayDrops);
+
+    // Compare in order per output channel
+    std::map<uint16_t, std::vector<const Output *>> want, got;
+    for (const Output &o : expected)
+        want[o.type << 8 | o.id].push_back(&o);
+    for (const Output &o : actual)
+        got[o.type << 8 | o.id].push_back(&o);
+
+    uint32_t matched = 0, mismatched = 0, missing = 0, extra = 0;
+    int64_t shiftSum = 0, shiftMin = INT64_MAX, shiftMax = INT64_MIN;
+    const Output *firstWant = nullptr, *firstGot = nullptr;
+
+    for (const auto &entry : want)
+    {
+        const std::vector<const Output *> &w = entry.second;
+        auto found = got.find(entry.first);
+        size_t gotCount = found == got.end() ? 0 : found->second.size();
+        for (size_t i = 0; i < w.size(); i++)
+        {
+            if (i >= gotCount)
+            {
+                missing++;
+                if (!firstWant || w[i]->at < firstWant->at)
+                {
+                    firstWant = w[i];
+                    firstGot = nullptr;
+                }
+                continue;
+            }
+            const Output *g = found->second[i];
+            if (g->value != w[i]->value)
+            {
+                mismatched++;
+                if (!firstWant || w[i]->at < firstWant->at)
+                {
+                    firstWant = w[i];
+                    firstGot = g;
+                }
+                continue;
+            }
+            matched++;
+            int64_t shift = (int64_t)g->at - (int64_t)w[i]->at;
+            shiftSum += shift;
+            shiftMin = shift < shiftMin ? shift : shiftMin;
+            shiftMax = shift > shiftMax ? shift : shiftMax;
+        }
+        if (gotCount > w.size())
+            extra += gotCount - w.size();
+    }
+    for (const auto &entry : got)
+    {
+        if (!want.count(entry.first))
+            extra += entry.second.size();
+    }
+
+    printf("outputs: %zu recorded, %zu replayed: %u match, %u differ, %u missing, %u extra\n",
+           expected.size(), actual.size(), matched, mismatched, missing, extra);
+    if (matched)
+        printf("timing shift of matching outputs: min %+lld us, avg %+.0f us, max %+lld us\n",
+               (long long)shiftMin, shiftSum / (double)matched, (long long)shiftMax);
+    if (firstWant)
+    {
+        printf("first divergence at %.3f s: %c[%u] recorded %u, replayed ", firstWant->at / 1e6,
+               firstWant->type, firstWant->id, firstWant->value);
+        if (firstGot)
+            printf("%u at %.3f s\n", firstGot->value, firstGot->at / 1e6);
+        else
+            printf("nothing\n");
+    }
+    printf("result: %s\n", mismatched || missing || extra ? "DIVERGED" : "IDENTICAL");
+}
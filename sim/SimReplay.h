@@ -0,0 +1,73 @@
+// Replays a trace captured with TRACE_CTRL (include/Trace.h) into the
+// native build. The recorded register image is written first, which also
+// starts a capture in the replayed firmware; after that every recorded
+// request is re-sent through SimMaster and every ADC / 1-Wire reading is
+// applied at its recorded time. The outputs the firmware produces are
+// parsed from its own trace on Serial1 and compared with the recorded ones,
+// in order per motor, with their timing shift.
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "SimMaster.h"
+#include "SimTrace.h"
+#include "Config.h"
+
+class SimReplay
+{
+public:
+    bool load(const char *path);
+    void step(SimMaster &master); // Call every loop pass
+    bool finished() const { return phase == DONE; }
+    void report() const;
+
+private:
+    static constexpr uint64_t BOOT_CYCLES = 1500000ULL * Sim::CYCLES_PER_US;   // Sensors up
+    static constexpr uint64_t SETTLE_CYCLES = 1000000ULL * Sim::CYCLES_PER_US; // After the last input
+
+    struct Event
+    {
+        uint64_t at; // µs after BEGIN
+        uint8_t type;
+        std::vector<uint8_t> data;
+    };
+
+    struct Output
+    {
+        uint64_t at;
+        uint8_t type;
+        uint8_t id;
+        uint8_t value;
+    };
+
+    enum Phase : uint8_t
+    {
+        BOOTING,
+        PRIMING_HIGH,
+        PRIMING,
+        RUNNING,
+        SETTLING,
+        DONE,
+    };
+
+    static bool toOutput(const SimTraceReader::Record &r, uint64_t at, Output &out);
+    void apply(const Event &e, SimMaster &master);
+    void collect();
+
+    std::vector<Event> inputs;
+    std::vector<Output> expected;
+    std::vector<Output> actual;
+    uint16_t image[HOLDING_REG_COUNT] = {};
+    uint32_t recordedDrops = 0;
+    uint32_t replayDrops = 0;
+
+    Phase phase = BOOTING;
+    uint64_t t0 = 0;
+    uint64_t settleEnd = 0;
+    size_t cursor = 0;
+    std::vector<uint16_t> writes; // reg, value pairs of the request being rebuilt
+    uint32_t counts[4] = {};      // writes, polls, ADC, temperature
+
+    SimTraceReader replayTrace;
+    bool replayBegun = false;
+    uint64_t replayClock = 0;
+};
@@ -0,0 +1,56 @@
+#include <util/crc16.h>
+#include "SimTrace.h"
+#include "Trace.h"
+
+void SimTraceReader::feed(const uint8_t *bytes, size_t count)
+{
+    buffer.insert(buffer.end(), bytes, bytes + count);
+}
+
+bool SimTraceReader::next(Record &out)
+{
+    while (true)
+    {
+        size_t start = 0;
+        while (start < buffer.size() && buffer[start] != Trace::SYNC)
+            start++;
+        buffer.erase(buffer.begin(), buffer.begin() + start);
+        if (buffer.size() < 3)
+            return false;
+
+        uint8_t length = buffer[2];
+        if (buffer.size() < (size_t)length + 4)
+            return false;
+
+        uint8_t crc = 0;
+        for (size_t i = 1; i < (size_t)length + 3; i++)
+            crc = _crc_ibutton_update(crc, buffer[i]);
+        if (length == 0 || crc != buffer[length + 3])
+        {
+            buffer.erase(buffer.begin()); // False SYNC; resynchronise
+            continue;
+        }
+
+        std::vector<uint8_t> payload(buffer.begin() + 3, buffer.begin() + 3 + length);
+        out.type = buffer[1];
+        buffer.erase(buffer.begin(), buffer.begin() + length + 4);
+
+        size_t pos = 0;
+        out.dt = varint(payload, pos);
+        out.data.assign(payload.begin() + pos, payload.end());
+        return true;
+    }
+}
+
+uint32_t SimTraceReader::varint(const std::vector<uint8_t> &data, size_t &pos)
+{
+    uint32_t value = 0;
+    for (uint8_t shift = 0; pos < data.size() && shift < 32; shift += 7)
+    {
+        uint8_t b = data[pos++];
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    return value;
+}
@@ -0,0 +1,27 @@
+// Parser for the binary trace the firmware streams on Serial1 (format in
+// include/Trace.h). Bytes may arrive in any chunking and may contain other
+// output; records are found by SYNC and kept only if the CRC matches.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+class SimTraceReader
+{
+public:
+    struct Record
+    {
+        uint8_t type;
+        uint32_t dt;               // µs since the previous record
+        std::vector<uint8_t> data; // Payload after dt
+    };
+
+    void feed(const uint8_t *bytes, size_t count);
+    bool next(Record &out);
+
+    // Varint at data[pos]; advances pos
+    static uint32_t varint(const std::vector<uint8_t> &data, size_t &pos);
+
+private:
+    std::vector<uint8_t> buffer;
+};
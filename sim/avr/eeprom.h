@@ -0,0 +1,13 @@
+// Simulated 4 KB EEPROM. Contents start erased (0xFF); a byte write keeps
+// eeprom_is_ready() false for the datasheet's 3.3 ms.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+uint16_t eeprom_read_word(const uint16_t *addr);
+void eeprom_read_block(void *dst, const void *src, size_t len);
+void eeprom_write_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_block(const void *src, void *dst, size_t len);
+bool eeprom_is_ready();
@@ -0,0 +1,9 @@
+// Simulated interrupt control for the native build. ISR bodies become plain
+// C functions that the kernel calls when their flag is set and SREG.I is on.
+#pragma once
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void)
+
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= (uint8_t)~_BV(SREG_I))
@@ -0,0 +1,368 @@
+// Simulated ATmega2560 I/O register file for the native build.
+//
+// Registers are plain variables owned by SimKernel.cpp. The timer
+// interrupt flag registers (TIFRn) keep the hardware's write-one-to-clear
+// behaviour, which the firmware relies on (TIFR2 = _BV(TOV2)). TCNT0 and
+// TCNT2 advance, and their interrupts fire, whenever the kernel advances
+// simulated time (see SimKernel.h).
+#pragma once
+#include <stdint.h>
+
+#define _BV(b) (1 << (b))
+#define RAMSTART 0x200
+#define RAMEND 0x21FF
+#define E2END 0xFFF
+
+// Write-one-to-clear interrupt flag register
+class SimFlagRegister
+{
+public:
+    operator uint8_t() const { return value; }
+    SimFlagRegister &operator=(uint8_t v)
+    {
+        value &= (uint8_t)~v;
+        return *this;
+    }
+    SimFlagRegister &operator|=(uint8_t v) { return *this = v; } // RMW clears the written ones too
+    void set(uint8_t mask) { value |= mask; }
+
+private:
+    volatile uint8_t value = 0;
+};
+
+// 8-bit registers
+extern volatile uint8_t TCCR0A;
+extern volatile uint8_t TCCR0B;
+extern volatile uint8_t TCNT0;
+extern volatile uint8_t OCR0A;
+extern volatile uint8_t OCR0B;
+extern volatile uint8_t TIMSK0;
+extern volatile uint8_t TCCR2A;
+extern volatile uint8_t TCCR2B;
+extern volatile uint8_t TCNT2;
+extern volatile uint8_t OCR2A;
+extern volatile uint8_t OCR2B;
+extern volatile uint8_t TIMSK2;
+extern volatile uint8_t ASSR;
+extern volatile uint8_t GTCCR;
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint8_t TCCR1C;
+extern volatile uint8_t TCCR3A;
+extern volatile uint8_t TCCR3B;
+extern volatile uint8_t TCCR3C;
+extern volatile uint8_t TCCR4A;
+extern volatile uint8_t TCCR4B;
+extern volatile uint8_t TCCR4C;
+extern volatile uint8_t TCCR5A;
+extern volatile uint8_t TCCR5B;
+extern volatile uint8_t TCCR5C;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t TIMSK3;
+extern volatile uint8_t TIMSK4;
+extern volatile uint8_t TIMSK5;
+extern volatile uint8_t SREG;
+extern volatile uint8_t PORTA;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t PORTC;
+extern volatile uint8_t PORTD;
+extern volatile uint8_t PORTE;
+extern volatile uint8_t PORTF;
+extern volatile uint8_t PORTG;
+extern volatile uint8_t PORTH;
+extern volatile uint8_t PORTJ;
+extern volatile uint8_t PORTK;
+extern volatile uint8_t PORTL;
+extern volatile uint8_t DDRA;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t DDRC;
+extern volatile uint8_t DDRD;
+extern volatile uint8_t DDRE;
+extern volatile uint8_t DDRF;
+extern volatile uint8_t DDRG;
+extern volatile uint8_t DDRH;
+extern volatile uint8_t DDRJ;
+extern volatile uint8_t DDRK;
+extern volatile uint8_t DDRL;
+extern volatile uint8_t PINA;
+extern volatile uint8_t PINB;
+extern volatile uint8_t PING;
+extern volatile uint8_t PINL;
+extern volatile uint8_t UCSR0A;
+extern volatile uint8_t UCSR0B;
+extern volatile uint8_t UCSR1A;
+extern volatile uint8_t UDR0;
+extern volatile uint8_t GPIOR0;
+extern volatile uint8_t GPIOR1;
+extern volatile uint8_t GPIOR2;
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t SPL;
+extern volatile uint8_t SPH;
+extern volatile uint8_t ADCSRA;
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t ADCL;
+extern volatile uint8_t ADCH;
+
+// 16-bit registers
+extern volatile uint16_t ICR1;
+extern volatile uint16_t ICR3;
+extern volatile uint16_t ICR4;
+extern volatile uint16_t ICR5;
+extern volatile uint16_t OCR1A;
+extern volatile uint16_t OCR1B;
+extern volatile uint16_t OCR1C;
+extern volatile uint16_t OCR3A;
+extern volatile uint16_t OCR3B;
+extern volatile uint16_t OCR3C;
+extern volatile uint16_t OCR4A;
+extern volatile uint16_t OCR4B;
+extern volatile uint16_t OCR4C;
+extern volatile uint16_t OCR5A;
+extern volatile uint16_t OCR5B;
+extern volatile uint16_t OCR5C;
+extern volatile uint16_t TCNT1;
+extern volatile uint16_t TCNT3;
+extern volatile uint16_t TCNT4;
+extern volatile uint16_t TCNT5;
+extern volatile uint16_t SP;
+extern volatile uint16_t ADC;
+
+// Interrupt flag registers
+extern SimFlagRegister TIFR0;
+extern SimFlagRegister TIFR2;
+extern SimFlagRegister TIFR1;
+extern SimFlagRegister TIFR3;
+extern SimFlagRegister TIFR4;
+extern SimFlagRegister TIFR5;
+
+// Interrupt vectors dispatched by the kernel (see avr/interrupt.h)
+#define TIMER0_COMPA_vect sim_vector_timer0_compa
+#define TIMER0_COMPB_vect sim_vector_timer0_compb
+#define TIMER0_OVF_vect sim_vector_timer0_ovf
+#define TIMER2_OVF_vect sim_vector_timer2_ovf
+
+// Bit names
+#define WGM00 0
+#define WGM01 1
+#define WGM02 3
+#define WGM03 4
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define COM0A1 7
+#define COM0A0 6
+#define COM0B1 5
+#define COM0B0 4
+#define COM0C1 3
+#define COM0C0 2
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define OCIE0C 3
+#define TOV0 0
+#define OCF0A 1
+#define OCF0B 2
+#define OCF0C 3
+#define WGM10 0
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define COM1A1 7
+#define COM1A0 6
+#define COM1B1 5
+#define COM1B0 4
+#define COM1C1 3
+#define COM1C0 2
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCIE1C 3
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+#define OCF1C 3
+#define WGM20 0
+#define WGM21 1
+#define WGM22 3
+#define WGM23 4
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define COM2A1 7
+#define COM2A0 6
+#define COM2B1 5
+#define COM2B0 4
+#define COM2C1 3
+#define COM2C0 2
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define OCIE2C 3
+#define TOV2 0
+#define OCF2A 1
+#define OCF2B 2
+#define OCF2C 3
+#define WGM30 0
+#define WGM31 1
+#define WGM32 3
+#define WGM33 4
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define COM3A1 7
+#define COM3A0 6
+#define COM3B1 5
+#define COM3B0 4
+#define COM3C1 3
+#define COM3C0 2
+#define TOIE3 0
+#define OCIE3A 1
+#define OCIE3B 2
+#define OCIE3C 3
+#define TOV3 0
+#define OCF3A 1
+#define OCF3B 2
+#define OCF3C 3
+#define WGM40 0
+#define WGM41 1
+#define WGM42 3
+#define WGM43 4
+#define CS40 0
+#define CS41 1
+#define CS42 2
+#define COM4A1 7
+#define COM4A0 6
+#define COM4B1 5
+#define COM4B0 4
+#define COM4C1 3
+#define COM4C0 2
+#define TOIE4 0
+#define OCIE4A 1
+#define OCIE4B 2
+#define OCIE4C 3
+#define TOV4 0
+#define OCF4A 1
+#define OCF4B 2
+#define OCF4C 3
+#define WGM50 0
+#define WGM51 1
+#define WGM52 3
+#define WGM53 4
+#define CS50 0
+#define CS51 1
+#define CS52 2
+#define COM5A1 7
+#define COM5A0 6
+#define COM5B1 5
+#define COM5B0 4
+#define COM5C1 3
+#define COM5C0 2
+#define TOIE5 0
+#define OCIE5A 1
+#define OCIE5B 2
+#define OCIE5C 3
+#define TOV5 0
+#define OCF5A 1
+#define OCF5B 2
+#define OCF5C 3
+#define PSRASY 1
+#define PSRSYNC 0
+#define TSM 7
+#define DOR0 3
+#define RXC0 7
+#define SREG_I 7
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define PA0 0
+#define PB0 0
+#define PC0 0
+#define PD0 0
+#define PE0 0
+#define PF0 0
+#define PG0 0
+#define PH0 0
+#define PJ0 0
+#define PK0 0
+#define PL0 0
+#define PA1 1
+#define PB1 1
+#define PC1 1
+#define PD1 1
+#define PE1 1
+#define PF1 1
+#define PG1 1
+#define PH1 1
+#define PJ1 1
+#define PK1 1
+#define PL1 1
+#define PA2 2
+#define PB2 2
+#define PC2 2
+#define PD2 2
+#define PE2 2
+#define PF2 2
+#define PG2 2
+#define PH2 2
+#define PJ2 2
+#define PK2 2
+#define PL2 2
+#define PA3 3
+#define PB3 3
+#define PC3 3
+#define PD3 3
+#define PE3 3
+#define PF3 3
+#define PG3 3
+#define PH3 3
+#define PJ3 3
+#define PK3 3
+#define PL3 3
+#define PA4 4
+#define PB4 4
+#define PC4 4
+#define PD4 4
+#define PE4 4
+#define PF4 4
+#define PG4 4
+#define PH4 4
+#define PJ4 4
+#define PK4 4
+#define PL4 4
+#define PA5 5
+#define PB5 5
+#define PC5 5
+#define PD5 5
+#define PE5 5
+#define PF5 5
+#define PG5 5
+#define PH5 5
+#define PJ5 5
+#define PK5 5
+#define PL5 5
+#define PA6 6
+#define PB6 6
+#define PC6 6
+#define PD6 6
+#define PE6 6
+#define PF6 6
+#define PG6 6
+#define PH6 6
+#define PJ6 6
+#define PK6 6
+#define PL6 6
+#define PA7 7
+#define PB7 7
+#define PC7 7
+#define PD7 7
+#define PE7 7
+#define PF7 7
+#define PG7 7
+#define PH7 7
+#define PJ7 7
+#define PK7 7
+#define PL7 7
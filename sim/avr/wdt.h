@@ -0,0 +1,10 @@
+// Watchdog is not simulated; the calls are accepted and ignored.
+#pragma once
+
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+
+inline void wdt_enable(int) {}
+inline void wdt_disable() {}
+inline void wdt_reset() {}
@@ -0,0 +1,16 @@
+// ATOMIC_BLOCK for the native build: SREG.I is cleared for the block and
+// restored (or forced on) afterwards, as in avr-libc.
+#pragma once
+#include <avr/interrupt.h>
+
+#define ATOMIC_RESTORESTATE uint8_t sim_sreg_save __attribute__((__cleanup__(sim_restore_sreg))) = SREG
+#define ATOMIC_FORCEON uint8_t sim_sreg_save __attribute__((__cleanup__(sim_force_on))) = 0
+#define ATOMIC_BLOCK(type) for (type, sim_atomic_once = sim_cli(); sim_atomic_once; sim_atomic_once = 0)
+
+static inline uint8_t sim_cli()
+{
+    cli();
+    return 1;
+}
+static inline void sim_restore_sreg(const uint8_t *s) { SREG = *s; }
+static inline void sim_force_on(const uint8_t *) { sei(); }
@@ -0,0 +1,45 @@
+#include "Benchmark.h"
+#include "SystemCore.h"
+#include "PWMController.h"
+#include "Config.h"
+
+bool Benchmark::primed = false;
+
+void Benchmark::loop(SystemCore &core)
+{
+    if (!primed)
+    {
+        primed = true;
+        runMicroBenchmarks();
+    }
+
+    Scope probe(LOOP_PASS);
+    core.loop();
+}
+
+void Benchmark::runMicroBenchmarks()
+{
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        Scope probe(CALIBRATE);
+    }
+
+    // Every motor pin (hardware timers and SoftPWM) across the duty range
+    static const uint8_t DUTIES[] = {0, 1, 25, 50, 99, 100, 0};
+    for (uint8_t d = 0; d < sizeof(DUTIES); d++)
+    {
+        for (uint8_t i = 0; i < NUM_MOTORS; i++)
+        {
+            Scope probe(SET_DUTY);
+            PWMController::setDutyCycle(Board::PWM_PINS[i], DUTIES[d]);
+        }
+    }
+
+    volatile uint64_t sink;
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        Scope probe(MICROS);
+        sink = PWMController::microsCustom();
+    }
+    (void)sink;
+}
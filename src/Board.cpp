@@ -0,0 +1,6 @@
+#include "Board.h"
+
+// Storage for the selected board's pin tables (indexed at run time)
+constexpr uint8_t Board::PWM_PINS[];
+constexpr uint8_t Board::CURRENT_PINS[];
+constexpr uint8_t Board::TEMP_PINS[];
@@ -0,0 +1,171 @@
+#include "ConfigStore.h"
+#include "EepromWriter.h"
+#include "ModbusHandler.h"
+#include "Globals.h"
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+static constexpr uint16_t CONFIG_MAGIC = 0x4346; // "CF"
+
+constexpr ConfigStore::Range ConfigStore::RANGES[] = {
+    {ModbusHoldingReg::GLOBAL_FREQ, 1},
+    {ModbusHoldingReg::DUTY_BASE, NUM_MOTORS},
+    {ModbusHoldingReg::CTRL_SETPOINT_BASE, NUM_MOTORS},
+    {ModbusHoldingReg::CTRL_KP, 5}, // KP, KI, KD, MODE, PERIOD
+    {ModbusHoldingReg::PROFILE_ENABLE, 1},
+    {ModbusHoldingReg::MOTOR_TEMP_CRIT, 2}, // TEMP_CRIT, CURR_CRIT
+    {ModbusHoldingReg::AIR_TEMP_LIMIT, 1},
+    {ModbusHoldingReg::WATER_TEMP_LIMIT, 1},
+    {ModbusHoldingReg::CURR_OFFSET_BASE, NUM_MOTORS},
+    {ModbusHoldingReg::CURR_GAIN_BASE, NUM_MOTORS},
+    {ModbusHoldingReg::THERMAL_TAU_BASE, NUM_MOTORS},
+    {ModbusHoldingReg::THERMAL_RISE, 1},
+};
+
+constexpr uint8_t ConfigStore::rangeTotal(uint8_t i)
+{
+    return i == sizeof(RANGES) / sizeof(RANGES[0]) ? 0 : RANGES[i].count + rangeTotal(i + 1);
+}
+
+ConfigStore::Record ConfigStore::record;
+uint8_t ConfigStore::slot = EEPROM_CONFIG_SLOTS - 1; // First save lands in slot 0
+bool ConfigStore::valid = false;
+bool ConfigStore::commitRequested = false;
+bool ConfigStore::saving = false;
+ConfigStore::Status ConfigStore::status = ConfigStore::DEFAULTS;
+
+static_assert(ModbusHoldingReg::CTRL_PERIOD == ModbusHoldingReg::CTRL_KP + 4 &&
+                  ModbusHoldingReg::MOTOR_CURR_CRIT == ModbusHoldingReg::MOTOR_TEMP_CRIT + 1,
+              "ConfigStore ranges assume contiguous controller and threshold registers");
+
+uint16_t ConfigStore::slotAddress(uint8_t s)
+{
+    return EEPROM_CONFIG_ADDR + (uint16_t)s * SLOT_SIZE;
+}
+
+uint16_t ConfigStore::checksum(const Record &r)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&r);
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < offsetof(Record, crc); i++)
+        crc = _crc16_update(crc, p[i]);
+    return crc;
+}
+
+bool ConfigStore::readSlot(uint8_t s, Record &r)
+{
+    eeprom_read_block(&r, reinterpret_cast<const void *>(slotAddress(s)), sizeof(r));
+    return r.magic == CONFIG_MAGIC && r.version == VERSION &&
+           r.count == VALUE_COUNT && r.crc == checksum(r);
+}
+
+void ConfigStore::capture(uint16_t *values)
+{
+    for (const Range &range : RANGES)
+    {
+        for (uint8_t i = 0; i < range.count; i++)
+            *values++ = modbusHandler->getHreg(range.first + i);
+    }
+}
+
+void ConfigStore::begin()
+{
+    static_assert(rangeTotal() == VALUE_COUNT, "VALUE_COUNT does not match the registers in RANGES");
+    static_assert(sizeof(Record) <= SLOT_SIZE, "Config record outgrew its slot");
+    static_assert(EEPROM_CONFIG_ADDR + EEPROM_CONFIG_SLOTS * SLOT_SIZE <= E2END + 1,
+                  "Config slots do not fit the EEPROM");
+
+    // Newest valid record wins; a torn write fails its CRC and is skipped
+    Record candidate;
+    valid = false;
+    for (uint8_t s = 0; s < EEPROM_CONFIG_SLOTS; s++)
+    {
+        if (!readSlot(s, candidate))
+            continue;
+        if (!valid || (int32_t)(candidate.sequence - record.sequence) > 0)
+        {
+            record = candidate;
+            slot = s;
+            valid = true;
+        }
+    }
+
+    if (valid)
+    {
+        // Straight into the register image; ModbusHandler's shadows still
+        // hold the defaults, so the forced change scan applies the values
+        const uint16_t *v = record.values;
+        for (const Range &range : RANGES)
+        {
+            for (uint8_t i = 0; i < range.count; i++)
+                modbusHandler->setHreg(range.first + i, *v++);
+        }
+        status = RESTORED;
+        modbusHandler->requestRescan();
+    }
+    else
+    {
+        record.sequence = 0;
+        status = DEFAULTS;
+    }
+
+    modbusHandler->setHreg(ModbusHoldingReg::CONFIG_COMMIT, 0);
+    publish();
+}
+
+void ConfigStore::requestCommit(uint16_t cmd)
+{
+    if (cmd == 1)
+        commitRequested = true; // Runs after a save in progress
+    else
+        modbusHandler->setHreg(ModbusHoldingReg::CONFIG_COMMIT, 0xFFFF);
+}
+
+void ConfigStore::service()
+{
+    if (EepromWriter::busy())
+        return;
+
+    if (saving)
+    {
+        saving = false;
+        status = SAVED;
+        if (!commitRequested)
+            modbusHandler->setHreg(ModbusHoldingReg::CONFIG_COMMIT, 0);
+        publish();
+        return;
+    }
+
+    if (!commitRequested)
+        return;
+    commitRequested = false;
+
+    uint16_t values[VALUE_COUNT];
+    capture(values);
+    if (valid && memcmp(values, record.values, sizeof(values)) == 0)
+    {
+        // Nothing changed since the newest record; spare the EEPROM
+        modbusHandler->setHreg(ModbusHoldingReg::CONFIG_COMMIT, 0);
+        return;
+    }
+
+    memcpy(record.values, values, sizeof(values));
+    record.magic = CONFIG_MAGIC;
+    record.version = VERSION;
+    record.count = VALUE_COUNT;
+    record.sequence++;
+    record.crc = checksum(record);
+
+    slot = (slot + 1) % EEPROM_CONFIG_SLOTS;
+    EepromWriter::write(slotAddress(slot), &record, sizeof(record));
+    valid = true;
+    saving = true;
+    status = SAVING;
+    publish();
+}
+
+void ConfigStore::publish()
+{
+    modbusHandler->setIreg(ModbusInputReg::CONFIG_STATUS, status);
+    modbusHandler->setIreg(ModbusInputReg::CONFIG_SEQUENCE, record.sequence & 0xFFFF);
+}
@@ -1,49 +1,114 @@
 #include "CurrentSensor.h"
 #include "ModbusHandler.h"
+#include "MotorTable.h"
 #include "Config.h"
 #include "Globals.h"
+#include "Trace.h"
 
-CurrentSensor::CurrentSensor(uint8_t pin, uint16_t regAddr)
-    : pin(pin), regAddr(regAddr), filteredValue(0),
-      smoothingFactor(DEFAULT_SMOOTHING), lastSampleTime(0) {}
+uint16_t CurrentSensor::zeroMask = 0;
+uint16_t CurrentSensor::zeroFailed = 0;
+uint16_t CurrentSensor::zeroSum[NUM_MOTORS];
+uint8_t CurrentSensor::zeroCount[NUM_MOTORS];
 
-void CurrentSensor::begin()
+void CurrentSensor::begin(uint8_t id)
 {
+    uint8_t pin = Board::CURRENT_PINS[id];
     pinMode(pin, INPUT);
-    if (pin == A0)
-        analogReference(INTERNAL1V1);
+    // The reference is global to the ADC, so every channel shares it
+    if (id == 0)
+        analogReference(CURR_ADC_REFERENCE);
 
-    // Initial reading to start filter
-    uint16_t raw = analogRead(pin);
-    // float current = float(raw - 512) / 1024 * 5 / 185 * 1000;
-    current = raw;
-    modbusHandler->setIreg(regAddr, raw);
+    setCalibration(id, CURR_DEFAULT_OFFSET, CURR_DEFAULT_GAIN);
+    motorTable.adcFiltered[id] = CURR_DEFAULT_OFFSET << 4;
+    // First conversion comes from the motors task once the system is up
 }
 
-void CurrentSensor::update(uint64_t now)
+void CurrentSensor::update(uint8_t id, uint64_t now)
 {
-    if (now - lastSampleTime < SAMPLE_INTERVAL)
+    uint16_t now16 = (uint16_t)now;
+    if ((uint16_t)(now16 - motorTable.lastSample[id]) < SAMPLE_INTERVAL)
         return;
 
-    lastSampleTime = now;
-    uint16_t raw = analogRead(pin);
+    motorTable.lastSample[id] = now16;
+    sample(id);
+}
+
+uint16_t CurrentSensor::sample(uint8_t id)
+{
+    uint16_t raw = analogRead(Board::CURRENT_PINS[id]);
+    Trace::adc(id, raw);
+    if (zeroMask & (1U << id))
+        zeroStep(id, raw);
 
-    // Exponential smoothing
-    // filteredValue = smoothingFactor * raw + (1 - smoothingFactor) * filteredValue;
-    // float voltage = (raw - 512) / 1024 * 5;
-    // current = voltage / 66 * 1000; // 27.03 for 1V ref
-    current = raw;
+    // EMA 1/4 in Q4 counts; at most 1023 << 4, so the product with a
+    // 16-bit gain below stays inside int32
+    uint16_t filtered = motorTable.adcFiltered[id];
+    filtered += ((int16_t)(raw << 4) - (int16_t)filtered) / 4;
+    motorTable.adcFiltered[id] = filtered;
 
-    // Update Modbus register
-    modbusHandler->setIreg(regAddr, raw);
+    int32_t mA = ((int32_t)filtered - ((int32_t)motorTable.currentOffset[id] << 4)) *
+                     motorTable.currentGain[id] >> 12;
+    uint16_t current = mA < 0 ? 0 : (mA > 0xFFFF ? 0xFFFF : (uint16_t)mA);
+    motorTable.current[id] = current;
+
+    modbusHandler->setIreg(ModbusInputReg::CURR_BASE + id, current);
+    modbusHandler->setIreg(ModbusInputReg::CURR_RAW_BASE + id, (filtered + 8) >> 4);
+    return current;
 }
 
-float CurrentSensor::getCurrent() const
+uint16_t CurrentSensor::getCurrent(uint8_t id)
 {
-    return current;
+    return motorTable.current[id];
 }
 
-// void CurrentSensor::setSmoothingFactor(float factor)
-// {
-//     smoothingFactor = constrain(factor, 0.0f, 1.0f);
-// }
\ No newline at end of file
+void CurrentSensor::setCalibration(uint8_t id, uint16_t offset, uint16_t gain)
+{
+    motorTable.currentOffset[id] = offset;
+    motorTable.currentGain[id] = gain;
+}
+
+void CurrentSensor::startZero(uint16_t mask)
+{
+    if (zeroMask)
+        return;
+
+    zeroMask = mask & MOTOR_MASK;
+    zeroFailed = 0;
+    for (uint8_t i = 0; i < NUM_MOTORS; i++)
+    {
+        zeroSum[i] = 0;
+        zeroCount[i] = 0;
+    }
+    modbusHandler->setHreg(ModbusHoldingReg::CURR_ZERO, zeroMask);
+    if (!zeroMask)
+        modbusHandler->setIreg(ModbusInputReg::CURR_ZERO_FAILED, 0);
+}
+
+// Raw counts, not the EMA, so the result does not carry its settling
+void CurrentSensor::zeroStep(uint8_t id, uint16_t raw)
+{
+    if (motorTable.outputDuty[id] != 0)
+    {
+        zeroDone(id, false);
+        return;
+    }
+
+    zeroSum[id] += raw; // ZERO_SAMPLES * 1023 fits
+    if (++zeroCount[id] < ZERO_SAMPLES)
+        return;
+
+    uint16_t offset = (zeroSum[id] + ZERO_SAMPLES / 2) / ZERO_SAMPLES;
+    modbusHandler->setHreg(ModbusHoldingReg::CURR_OFFSET_BASE + id, offset);
+    setCalibration(id, offset, motorTable.currentGain[id]);
+    zeroDone(id, true);
+}
+
+void CurrentSensor::zeroDone(uint8_t id, bool ok)
+{
+    zeroMask &= ~(1U << id);
+    if (!ok)
+        zeroFailed |= 1U << id;
+    modbusHandler->setHreg(ModbusHoldingReg::CURR_ZERO, zeroMask);
+    if (!zeroMask)
+        modbusHandler->setIreg(ModbusInputReg::CURR_ZERO_FAILED, zeroFailed);
+}
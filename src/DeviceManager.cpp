@@ -1,78 +1,90 @@
 #include "DeviceManager.h"
 #include "ModbusHandler.h"
+#include "MotorTable.h"
 #include "Config.h"
 #include "Globals.h"
+#include "Trace.h"
+#include "EventLog.h"
+#include "IrqMonitor.h"
 
-void DeviceManager::begin() {
-    pinMode(FAN_PIN, OUTPUT);
-    pinMode(MIXER_PIN, OUTPUT);
-    pinMode(DISPENSER_PIN, OUTPUT);
-    pinMode(PUMP_PIN, OUTPUT);
+static_assert(FAN_PIN == 40 && MIXER_PIN == 41 && DISPENSER_PIN == 42 && PUMP_PIN == 43,
+              "DeviceManager port bits assume the device pins are 40-43");
 
-    // Optional: clear state
-    digitalWrite(FAN_PIN, LOW);
-    digitalWrite(MIXER_PIN, LOW);
-    digitalWrite(DISPENSER_PIN, LOW);
-    digitalWrite(PUMP_PIN, LOW);
+void DeviceManager::forceOff() {
+    // Outputs low before they become outputs
+    uint8_t sreg = SREG;
+    cli();
+    PORTG &= ~(FAN_PORTG | MIXER_PORTG);
+    PORTL &= ~(DISPENSER_PORTL | PUMP_PORTL);
+    DDRG |= FAN_PORTG | MIXER_PORTG;
+    DDRL |= DISPENSER_PORTL | PUMP_PORTL;
+    SREG = sreg;
+    outputs = 0;
 }
 
-void DeviceManager::update(const TemperatureSensor& airSensor, 
-                           const TemperatureSensor& waterSensor, 
-                           const Motor* const* motors) {
-    // --- Fan logic ---
-    uint16_t airTemp = airSensor.getTemperature();
-    uint16_t airLimit = modbusHandler->getHreg(ModbusHoldingReg::AIR_TEMP_LIMIT);
-    bool fanState = false;
+void DeviceManager::begin() {
+    forceOff();
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++)
+        modbusHandler->setIreg(ModbusInputReg::FAN_REG + i, 0);
 
-    if (airTemp != 0xFFFF) {
-        fanState = (airTemp >= airLimit);
-    }
-    controlFan(fanState);
+    airLimit = modbusHandler->getHreg(ModbusHoldingReg::AIR_TEMP_LIMIT);
+    waterLimit = modbusHandler->getHreg(ModbusHoldingReg::WATER_TEMP_LIMIT);
+}
 
-    // --- Mixer logic ---
-    uint16_t waterTemp = waterSensor.getTemperature();
-    uint16_t waterLimit = modbusHandler->getHreg(ModbusHoldingReg::WATER_TEMP_LIMIT);
-    bool mixerState = false;
+void DeviceManager::update(const TemperatureSensor& airSensor, 
+                           const TemperatureSensor& waterSensor) {
+    uint8_t state = 0;
 
-    if (waterTemp != 0xFFFF) {
-        mixerState = (waterTemp >= waterLimit);
-    }
-    controlMixer(mixerState);
+    // --- Fan logic ---
+    // Limits and readings are both signed 1/100 °C
+    int16_t airTemp = airSensor.getTemperature();
+    if (airTemp != TEMP_REG_DISCONNECTED && airTemp >= (int16_t)airLimit)
+        state |= 1 << FAN;
 
-    // --- Dispenser logic ---
-    bool dispenserState = (waterTemp != 0xFFFF && waterTemp >= waterLimit);
-    controlDispenser(dispenserState);
+    // --- Mixer and dispenser logic ---
+    int16_t waterTemp = waterSensor.getTemperature();
+    if (waterTemp != TEMP_REG_DISCONNECTED && waterTemp >= (int16_t)waterLimit)
+        state |= (1 << MIXER) | (1 << DISPENSER);
 
     // --- Pump logic ---
-    bool pumpState = false;
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        if (motors[i]->getStatus() < 2 && 
-            modbusHandler->getHreg(ModbusHoldingReg::DUTY_BASE + i) > 0) {
-            pumpState = true;
-            break;
-        }
-    }
-    controlPump(pumpState);
+    // Any motor commanded on and not tripped (status < MOTOR_TRIP_TEMP)
+    if (~motorTable.idle & ~motorTable.tripped & MOTOR_MASK)
+        state |= 1 << PUMP;
+
+    setOutputs(ALL_DEVICES, state);
 }
 
-// Device control methods with Modbus feedback
+void DeviceManager::setOutputs(uint8_t mask, uint8_t state) {
+    uint8_t changed = (outputs ^ state) & mask;
+    if (!changed)
+        return;
+    outputs ^= changed;
 
-void DeviceManager::controlFan(bool state) {
-    digitalWrite(FAN_PIN, state ? HIGH : LOW);
-    modbusHandler->setIreg(ModbusInputReg::FAN_REG, state ? 1 : 0);
-}
+    uint8_t gMask = 0, lMask = 0;
+    if (changed & (1 << FAN))       gMask |= FAN_PORTG;
+    if (changed & (1 << MIXER))     gMask |= MIXER_PORTG;
+    if (changed & (1 << DISPENSER)) lMask |= DISPENSER_PORTL;
+    if (changed & (1 << PUMP))      lMask |= PUMP_PORTL;
 
-void DeviceManager::controlMixer(bool state) {
-    digitalWrite(MIXER_PIN, state ? HIGH : LOW);
-    modbusHandler->setIreg(ModbusInputReg::MIXER_REG, state ? 1 : 0);
-}
+    uint8_t gBits = 0, lBits = 0;
+    if (outputs & (1 << FAN))       gBits |= FAN_PORTG;
+    if (outputs & (1 << MIXER))     gBits |= MIXER_PORTG;
+    if (outputs & (1 << DISPENSER)) lBits |= DISPENSER_PORTL;
+    if (outputs & (1 << PUMP))      lBits |= PUMP_PORTL;
 
-void DeviceManager::controlDispenser(bool state) {
-    digitalWrite(DISPENSER_PIN, state ? HIGH : LOW);
-    modbusHandler->setIreg(ModbusInputReg::DISPENSER_REG, state ? 1 : 0);
-}
+    // PORTG also carries the software PWM pin 4 (PG5), which the Timer0
+    // ISRs toggle, so the read-modify-write must not be interrupted
+    {
+        IrqMonitor::Critical cs(IrqMonitor::SITE_DEVICES);
+        PORTG = (PORTG & ~gMask) | (gBits & gMask);
+        PORTL = (PORTL & ~lMask) | (lBits & lMask);
+    }
 
-void DeviceManager::controlPump(bool state) {
-    digitalWrite(PUMP_PIN, state ? HIGH : LOW);
-    modbusHandler->setIreg(ModbusInputReg::PUMP_REG, state ? 1 : 0);
-}
\ No newline at end of file
+    // Modbus feedback for the outputs that changed
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        if (changed & (1 << i))
+            modbusHandler->setIreg(ModbusInputReg::FAN_REG + i, (outputs >> i) & 1);
+    }
+    Trace::devices(outputs);
+    EventLog::log(EVT_DEVICES, EventLog::NO_MOTOR, outputs);
+}
@@ -0,0 +1,175 @@
+#include "DutyProfile.h"
+#include "EepromWriter.h"
+#include "ModbusHandler.h"
+#include "Globals.h"
+#include "PWMController.h"
+#include <avr/eeprom.h>
+
+static constexpr uint16_t PROFILE_MAGIC = 0x5046; // "PF"
+
+DutyProfile::Header DutyProfile::header;
+DutyProfile::Step DutyProfile::staged;
+DutyProfile::Step DutyProfile::pending;
+uint8_t DutyProfile::nextStep = 0;
+uint8_t DutyProfile::command = DutyProfile::CMD_NONE;
+bool DutyProfile::storing = false;
+bool DutyProfile::headerDirty = false;
+DutyProfile::State DutyProfile::state = DutyProfile::IDLE;
+
+static_assert(sizeof(DutyProfile::Step) * PROFILE_MAX_STEPS + 4 <= EEPROM_CONFIG_ADDR - EEPROM_PROFILE_ADDR,
+              "Duty profile does not fit its EEPROM region");
+
+void DutyProfile::begin()
+{
+    eeprom_read_block(&header, reinterpret_cast<const void *>(EEPROM_PROFILE_ADDR), sizeof(header));
+    if (header.magic != PROFILE_MAGIC || header.length > PROFILE_MAX_STEPS)
+    {
+        header.magic = PROFILE_MAGIC;
+        header.length = 0;
+    }
+
+    modbusHandler->setHreg(ModbusHoldingReg::PROFILE_LENGTH, header.length);
+    state = IDLE;
+    publish();
+}
+
+void DutyProfile::requestCommand(uint16_t cmd)
+{
+    if (command == CMD_NONE && (cmd == CMD_STORE_STEP || cmd == CMD_LOAD_STEP))
+        command = cmd;
+}
+
+void DutyProfile::setLength(uint16_t length)
+{
+    if (length > PROFILE_MAX_STEPS)
+    {
+        length = PROFILE_MAX_STEPS;
+        modbusHandler->setHreg(ModbusHoldingReg::PROFILE_LENGTH, length);
+    }
+    if (length != header.length)
+    {
+        header.length = length;
+        headerDirty = true;
+    }
+}
+
+void DutyProfile::start()
+{
+    if (!modbusHandler->getHreg(ModbusHoldingReg::PROFILE_ENABLE) || header.length == 0)
+    {
+        state = IDLE;
+        publish();
+        return;
+    }
+
+    nextStep = 0;
+    loadStep(0, pending);
+    state = RUNNING;
+    publish();
+}
+
+void DutyProfile::stop()
+{
+    if (state != IDLE)
+    {
+        state = IDLE;
+        publish();
+    }
+}
+
+void DutyProfile::poll()
+{
+    serviceCommand();
+
+    if (state != RUNNING)
+        return;
+
+    uint64_t now = PWMController::millisCustom();
+    while (now >= pending.timeMs)
+    {
+        for (uint8_t i = 0; i < NUM_MOTORS; i++)
+            modbusHandler->setDuty(i, pending.duty[i]);
+
+        if (++nextStep >= header.length)
+        {
+            state = FINISHED;
+            publish();
+            return;
+        }
+        loadStep(nextStep, pending);
+        publish();
+    }
+}
+
+uint16_t DutyProfile::stepAddress(uint8_t index)
+{
+    return EEPROM_PROFILE_ADDR + sizeof(Header) + (uint16_t)index * sizeof(Step);
+}
+
+// One EEPROM operation at a time; PROFILE_COMMIT reads back 0 once the
+// command has completed, or 0xFFFF if it was rejected.
+void DutyProfile::serviceCommand()
+{
+    if (EepromWriter::busy())
+        return;
+
+    if (storing)
+    {
+        storing = false;
+        command = CMD_NONE;
+        modbusHandler->setHreg(ModbusHoldingReg::PROFILE_COMMIT, 0);
+        return;
+    }
+
+    if (command != CMD_NONE)
+    {
+        uint16_t index = modbusHandler->getHreg(ModbusHoldingReg::PROFILE_INDEX);
+        if (index >= PROFILE_MAX_STEPS)
+        {
+            command = CMD_NONE;
+            modbusHandler->setHreg(ModbusHoldingReg::PROFILE_COMMIT, 0xFFFF);
+            return;
+        }
+
+        if (command == CMD_STORE_STEP)
+        {
+            staged.timeMs = modbusHandler->getHreg(ModbusHoldingReg::PROFILE_TIME_LOW) |
+                            ((uint32_t)modbusHandler->getHreg(ModbusHoldingReg::PROFILE_TIME_HIGH) << 16);
+            for (uint8_t i = 0; i < NUM_MOTORS; i++)
+            {
+                uint16_t duty = modbusHandler->getHreg(ModbusHoldingReg::PROFILE_DUTY_BASE + i);
+                staged.duty[i] = duty > 100 ? 100 : duty;
+            }
+            EepromWriter::write(stepAddress(index), &staged, sizeof(staged));
+            storing = true;
+            return;
+        }
+
+        // CMD_LOAD_STEP
+        loadStep(index, staged);
+        modbusHandler->setHreg(ModbusHoldingReg::PROFILE_TIME_LOW, staged.timeMs & 0xFFFF);
+        modbusHandler->setHreg(ModbusHoldingReg::PROFILE_TIME_HIGH, staged.timeMs >> 16);
+        for (uint8_t i = 0; i < NUM_MOTORS; i++)
+            modbusHandler->setHreg(ModbusHoldingReg::PROFILE_DUTY_BASE + i, staged.duty[i]);
+        command = CMD_NONE;
+        modbusHandler->setHreg(ModbusHoldingReg::PROFILE_COMMIT, 0);
+        return;
+    }
+
+    if (headerDirty)
+    {
+        headerDirty = false;
+        EepromWriter::write(EEPROM_PROFILE_ADDR, &header, sizeof(header));
+    }
+}
+
+void DutyProfile::loadStep(uint8_t index, DutyProfile::Step &step)
+{
+    eeprom_read_block(&step, reinterpret_cast<const void *>(stepAddress(index)), sizeof(step));
+}
+
+void DutyProfile::publish()
+{
+    modbusHandler->setIreg(ModbusInputReg::PROFILE_STATE, state);
+    modbusHandler->setIreg(ModbusInputReg::PROFILE_STEP, nextStep);
+}
@@ -0,0 +1,40 @@
+#include "EepromWriter.h"
+#include <avr/eeprom.h>
+
+const uint8_t *EepromWriter::source = nullptr;
+uint16_t EepromWriter::address = 0;
+uint16_t EepromWriter::remaining = 0;
+
+bool EepromWriter::write(uint16_t addr, const void *src, uint16_t len)
+{
+    if (remaining)
+        return false;
+
+    source = static_cast<const uint8_t *>(src);
+    address = addr;
+    remaining = len;
+    return true;
+}
+
+bool EepromWriter::busy()
+{
+    return remaining != 0;
+}
+
+void EepromWriter::service()
+{
+    while (remaining && eeprom_is_ready())
+    {
+        uint8_t *dst = reinterpret_cast<uint8_t *>(address);
+        uint8_t value = *source;
+        bool changed = eeprom_read_byte(dst) != value;
+        if (changed)
+            eeprom_write_byte(dst, value);
+
+        source++;
+        address++;
+        remaining--;
+        if (changed)
+            break; // next byte once this write completes
+    }
+}
@@ -0,0 +1,91 @@
+#include "EventLog.h"
+#include "ModbusHandler.h"
+#include "PWMController.h"
+#include "Globals.h"
+
+static_assert((EVENT_LOG_ENTRIES & (EVENT_LOG_ENTRIES - 1)) == 0, "EVENT_LOG_ENTRIES must be a power of two");
+static_assert(sizeof(EventLog::Entry) == 12, "Event entry layout changed");
+
+EventLog::Entry EventLog::ring[EVENT_LOG_ENTRIES];
+uint16_t EventLog::head = 0;
+uint16_t EventLog::cursor = 0;
+uint16_t EventLog::lost = 0;
+uint8_t EventLog::count = 0;
+
+void EventLog::begin()
+{
+    head = 0;
+    cursor = 0;
+    lost = 0;
+    count = 0;
+    modbusHandler->setHreg(ModbusHoldingReg::EVENT_CURSOR, 0);
+    publish();
+}
+
+void EventLog::log(uint8_t code, uint8_t motor, uint16_t value)
+{
+    // Full of unread entries: the oldest goes, and the cursor with it
+    if ((uint16_t)(head - cursor) == EVENT_LOG_ENTRIES)
+    {
+        cursor++;
+        lost++;
+    }
+
+    uint64_t now = PWMController::millisCustom();
+    Entry &e = ring[head & (EVENT_LOG_ENTRIES - 1)];
+    e.timeLow = (uint32_t)now;
+    e.timeHigh = (uint32_t)(now >> 32);
+    e.code = code;
+    e.motor = motor;
+    e.value = value;
+    head++;
+    if (count < EVENT_LOG_ENTRIES)
+        count++;
+    publish();
+}
+
+void EventLog::setCursor(uint16_t sequence)
+{
+    uint16_t behind = head - sequence;
+    if (behind > count)
+    {
+        // Either older than the ring (lost) or ahead of the head (nothing to skip to)
+        if (behind < 0x8000)
+            lost += behind - count;
+        sequence = behind < 0x8000 ? head - count : head;
+    }
+    if (sequence == cursor)
+        return;
+    cursor = sequence;
+    publish();
+}
+
+bool EventLog::get(uint16_t sequence, Entry &entry)
+{
+    uint16_t behind = head - sequence;
+    if (behind == 0 || behind > count)
+        return false;
+    entry = ring[sequence & (EVENT_LOG_ENTRIES - 1)];
+    return true;
+}
+
+void EventLog::publish()
+{
+    modbusHandler->setIreg(ModbusInputReg::EVENT_HEAD, head);
+    modbusHandler->setIreg(ModbusInputReg::EVENT_CURSOR_USED, cursor);
+    modbusHandler->setIreg(ModbusInputReg::EVENT_LOST, lost);
+
+    uint16_t reg = ModbusInputReg::EVENT_WINDOW_BASE;
+    for (uint8_t n = 0; n < EVENT_WINDOW_ENTRIES; n++)
+    {
+        Entry e;
+        if (!get(cursor + n, e))
+            memset(&e, 0, sizeof(e));
+        modbusHandler->setIreg(reg++, e.timeLow & 0xFFFF);
+        modbusHandler->setIreg(reg++, e.timeLow >> 16);
+        modbusHandler->setIreg(reg++, e.timeHigh & 0xFFFF);
+        modbusHandler->setIreg(reg++, e.timeHigh >> 16);
+        modbusHandler->setIreg(reg++, e.code | (uint16_t)e.motor << 8);
+        modbusHandler->setIreg(reg++, e.value);
+    }
+}
@@ -2,4 +2,4 @@
 
 ModbusHandler *modbusHandler = nullptr;
 DeviceManager *deviceManager = nullptr;
-Motor **motors = nullptr; // Changed from Motor* to Motor**
\ No newline at end of file
+Motor *motors = nullptr; // SystemCore::motors, indexed by motor id
@@ -0,0 +1,158 @@
+#include "History.h"
+#include "ModbusHandler.h"
+#include "MotorTable.h"
+#include "PWMController.h"
+#include "Globals.h"
+
+static_assert((HISTORY_BYTES & (HISTORY_BYTES - 1)) == 0, "HISTORY_BYTES must be a power of two");
+
+static constexpr uint16_t RING_MASK = HISTORY_BYTES - 1;
+static constexpr uint8_t MAX_RECORD = 5 + History::CHANNELS * 3; // Worst-case varints
+
+uint8_t History::ring[HISTORY_BYTES];
+uint32_t History::head = 0;
+uint32_t History::tail = 0;
+uint16_t History::records = 0;
+uint64_t History::lastTime = 0;
+uint16_t History::last[History::CHANNELS];
+uint64_t History::baseTime = 0;
+uint16_t History::base[History::CHANNELS];
+uint8_t History::keyframe[History::KEYFRAME_BYTES];
+uint32_t History::snapStart = 0;
+uint32_t History::snapEnd = 0;
+uint16_t History::offset = 0;
+History::State History::state = History::CLOSED;
+
+// Zigzag (sign in bit 0) then 7 bits per byte, high bit = more bytes follow
+uint8_t History::encode(uint8_t *out, int32_t value)
+{
+    uint32_t z = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint8_t n = 0;
+    while (z >= 0x80)
+    {
+        out[n++] = (uint8_t)z | 0x80;
+        z >>= 7;
+    }
+    out[n++] = (uint8_t)z;
+    return n;
+}
+
+uint8_t History::decode(uint32_t &pos, int32_t &value)
+{
+    uint32_t z = 0;
+    uint8_t shift = 0;
+    uint8_t n = 0;
+    uint8_t b;
+    do
+    {
+        b = ring[pos++ & RING_MASK];
+        z |= (uint32_t)(b & 0x7F) << shift;
+        shift += 7;
+        n++;
+    } while (b & 0x80);
+    value = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+    return n;
+}
+
+void History::current(uint16_t *values)
+{
+    for (uint8_t i = 0; i < NUM_MOTORS; i++)
+    {
+        values[i] = motorTable.current[i];
+        values[NUM_MOTORS + i] = (uint16_t)motorTable.temperature[i];
+    }
+}
+
+// Folds the oldest record into the keyframe and drops it from the ring
+void History::evictOldest()
+{
+    int32_t v;
+    decode(tail, v);
+    baseTime += v;
+    for (uint8_t c = 0; c < CHANNELS; c++)
+    {
+        decode(tail, v);
+        base[c] += (uint16_t)v;
+    }
+    records--;
+}
+
+void History::sample()
+{
+    uint64_t now = PWMController::uptimeMillis();
+    uint16_t values[CHANNELS];
+    current(values);
+
+    uint8_t rec[MAX_RECORD];
+    uint8_t len = encode(rec, (int32_t)(now - lastTime));
+    for (uint8_t c = 0; c < CHANNELS; c++)
+        len += encode(rec + len, (int16_t)(values[c] - last[c]));
+
+    while (head + len - tail > HISTORY_BYTES)
+        evictOldest();
+
+    for (uint8_t i = 0; i < len; i++)
+        ring[head++ & RING_MASK] = rec[i];
+    records++;
+    lastTime = now;
+    memcpy(last, values, sizeof(last));
+
+    if (state == OPEN && tail > snapStart)
+        state = STALE;
+    modbusHandler->setIreg(ModbusInputReg::HISTORY_STATE, state);
+}
+
+void History::open()
+{
+    uint8_t *k = keyframe;
+    for (uint8_t i = 0; i < 8; i++)
+        *k++ = (uint8_t)(baseTime >> (8 * i));
+    for (uint8_t c = 0; c < CHANNELS; c++)
+    {
+        *k++ = base[c] & 0xFF;
+        *k++ = base[c] >> 8;
+    }
+
+    snapStart = tail;
+    snapEnd = head;
+    offset = 0;
+    state = OPEN;
+
+    modbusHandler->setIreg(ModbusInputReg::HISTORY_LENGTH, KEYFRAME_BYTES + (uint16_t)(snapEnd - snapStart));
+    modbusHandler->setIreg(ModbusInputReg::HISTORY_RECORDS, records);
+    uint64_t age = PWMController::uptimeMillis() - lastTime;
+    modbusHandler->setIreg(ModbusInputReg::HISTORY_AGE_MS, age > 0xFFFF ? 0xFFFF : (uint16_t)age);
+    modbusHandler->setHreg(ModbusHoldingReg::HISTORY_OFFSET, 0);
+    fillWindow();
+}
+
+void History::setOffset(uint16_t newOffset)
+{
+    offset = newOffset;
+    if (state != CLOSED)
+        fillWindow();
+}
+
+uint8_t History::streamByte(uint16_t at)
+{
+    if (at < KEYFRAME_BYTES)
+        return keyframe[at];
+
+    uint32_t pos = snapStart + (at - KEYFRAME_BYTES);
+    if (pos >= snapEnd)
+        return 0;
+    if (pos < tail)
+        state = STALE; // Overwritten since the snapshot
+    return ring[pos & RING_MASK];
+}
+
+void History::fillWindow()
+{
+    for (uint8_t r = 0; r < HISTORY_WINDOW_SIZE; r++)
+    {
+        uint16_t at = offset + 2 * r;
+        uint16_t word = (uint16_t)streamByte(at) << 8 | streamByte(at + 1);
+        modbusHandler->setIreg(ModbusInputReg::HISTORY_WINDOW_BASE + r, word);
+    }
+    modbusHandler->setIreg(ModbusInputReg::HISTORY_STATE, state);
+}
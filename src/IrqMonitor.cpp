@@ -0,0 +1,50 @@
+#include "IrqMonitor.h"
+#include "ModbusHandler.h"
+#include "Globals.h"
+
+volatile uint8_t IrqMonitor::t2MaxTicks = 0;
+volatile uint16_t IrqMonitor::t2Late = 0;
+volatile uint16_t IrqMonitor::overBudget = 0;
+uint8_t IrqMonitor::budgetTicks = 255;
+uint32_t IrqMonitor::windowMaxUsQ8 = 0;
+uint8_t IrqMonitor::windowMaxSite = IrqMonitor::SITE_NONE;
+uint16_t IrqMonitor::backwards = 0;
+
+void IrqMonitor::setTickScale(uint16_t usPerTickQ8)
+{
+    uint32_t ticks = ((uint32_t)RX_BUDGET_US << 8) / usPerTickQ8;
+    budgetTicks = ticks > 255 ? 255 : (uint8_t)ticks;
+}
+
+void IrqMonitor::publish()
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t t2Ticks = t2MaxTicks;
+    uint16_t late = t2Late;
+    uint16_t over = overBudget;
+    SREG = sreg;
+
+    uint16_t t2Us = ((uint32_t)t2Ticks * PWMController::_usPerTickQ8) >> 8;
+    uint32_t windowUs = windowMaxUsQ8 >> 8;
+    modbusHandler->setIreg(ModbusInputReg::IRQ_T2_LATENCY_US, t2Us);
+    modbusHandler->setIreg(ModbusInputReg::IRQ_T2_LATE, late);
+    modbusHandler->setIreg(ModbusInputReg::IRQ_CS_MAX_US, windowUs > 0xFFFF ? 0xFFFF : windowUs);
+    modbusHandler->setIreg(ModbusInputReg::IRQ_CS_MAX_SITE, windowMaxSite);
+    modbusHandler->setIreg(ModbusInputReg::IRQ_RX_BUDGET_US, RX_BUDGET_US);
+    modbusHandler->setIreg(ModbusInputReg::IRQ_OVER_BUDGET, over);
+    modbusHandler->setIreg(ModbusInputReg::TIME_BACKWARDS, backwards);
+}
+
+void IrqMonitor::reset()
+{
+    uint8_t sreg = SREG;
+    cli();
+    t2MaxTicks = 0;
+    t2Late = 0;
+    overBudget = 0;
+    SREG = sreg;
+    windowMaxUsQ8 = 0;
+    windowMaxSite = SITE_NONE;
+    backwards = 0;
+}
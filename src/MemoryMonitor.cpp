@@ -0,0 +1,110 @@
+#include "MemoryMonitor.h"
+#include "ModbusHandler.h"
+#include "Config.h"
+#include "Globals.h"
+
+#if defined(__AVR__)
+
+// Provided by the linker / avr-libc malloc
+extern uint8_t __heap_start;
+extern uint8_t _end;
+extern char *__brkval;
+
+uint8_t *MemoryMonitor::heapHigh = &__heap_start;
+uint8_t *MemoryMonitor::stackLow = (uint8_t *)RAMEND;
+uint16_t MemoryMonitor::stackPeakBytes = 0;
+uint16_t MemoryMonitor::minHeadroomBytes = 0xFFFF;
+
+// Paints [_end, RAMEND] with the canary. Runs in .init3: SP and r1 are set
+// up (.init2) but .data/.bss are not yet copied (.init4) and nothing sits
+// on the stack, so the whole range is free. Written in asm because a naked
+// init fragment must not touch the stack or rely on a libc memset.
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack()
+{
+    asm volatile(
+        "    ldi r30, lo8(_end)      \n"
+        "    ldi r31, hi8(_end)      \n"
+        "    ldi r24, %[canary]      \n"
+        "    ldi r25, hi8(%[top])    \n"
+        "1:  st Z+, r24              \n"
+        "    cpi r30, lo8(%[top])    \n"
+        "    cpc r31, r25            \n"
+        "    brlo 1b                 \n"
+        :
+        : [canary] "M"(MemoryMonitor::CANARY), [top] "i"(RAMEND + 1)
+        : "r24", "r25", "r30", "r31", "memory");
+}
+
+uint8_t *MemoryMonitor::heapTop()
+{
+    return __brkval ? (uint8_t *)__brkval : &__heap_start;
+}
+
+uint16_t MemoryMonitor::freeRam()
+{
+    uint8_t top;
+    return (uint16_t)(&top - heapTop());
+}
+
+uint16_t MemoryMonitor::heapUsed()
+{
+    return (uint16_t)(heapTop() - &__heap_start);
+}
+
+uint16_t MemoryMonitor::staticRam()
+{
+    return (uint16_t)(&_end - (uint8_t *)RAMSTART);
+}
+
+void MemoryMonitor::update()
+{
+    if (heapTop() > heapHigh)
+        heapHigh = heapTop();
+
+    // Walk up from the heap high-water mark to the first byte the stack has
+    // written. Everything above stackLow is already known to be used, so
+    // only the untouched gap is scanned (a few thousand bytes at most, ~1 ms).
+    uint8_t *p = heapHigh;
+    uint8_t *limit = stackLow;
+    while (p < limit && *p == CANARY)
+        p++;
+
+    uint16_t headroom = p > heapHigh ? (uint16_t)(p - heapHigh) : 0;
+    if (p < stackLow)
+        stackLow = p;
+    stackPeakBytes = (uint16_t)((uint8_t *)RAMEND - stackLow + 1);
+    if (headroom < minHeadroomBytes)
+        minHeadroomBytes = headroom;
+
+    publish();
+}
+
+#else
+
+// Native build: no linker-placed heap/stack to inspect, everything reads 0
+uint8_t *MemoryMonitor::heapHigh = nullptr;
+uint8_t *MemoryMonitor::stackLow = nullptr;
+uint16_t MemoryMonitor::stackPeakBytes = 0;
+uint16_t MemoryMonitor::minHeadroomBytes = 0;
+
+uint8_t *MemoryMonitor::heapTop() { return nullptr; }
+uint16_t MemoryMonitor::freeRam() { return 0; }
+uint16_t MemoryMonitor::heapUsed() { return 0; }
+uint16_t MemoryMonitor::staticRam() { return 0; }
+
+void MemoryMonitor::update()
+{
+    publish();
+}
+
+#endif
+
+void MemoryMonitor::publish()
+{
+    modbusHandler->setIreg(ModbusInputReg::MEM_FREE, freeRam());
+    modbusHandler->setIreg(ModbusInputReg::MEM_STACK_PEAK, stackPeakBytes);
+    modbusHandler->setIreg(ModbusInputReg::MEM_HEADROOM_MIN, minHeadroomBytes);
+    modbusHandler->setIreg(ModbusInputReg::MEM_HEAP_USED, heapUsed());
+    modbusHandler->setIreg(ModbusInputReg::MEM_STATIC, staticRam());
+}
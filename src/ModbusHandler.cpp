@@ -4,6 +4,16 @@
 #include "Config.h"
 #include "Globals.h"
 #include "PWMController.h"
+#include "DutyProfile.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+#include "ConfigStore.h"
+#include "History.h"
+#include "Trace.h"
+#include "CurrentSensor.h"
+#include "MotorTable.h"
+#include "EventLog.h"
+#include "IrqMonitor.h"
 
 ModbusHandler::ModbusHandler(HardwareSerial &portRef, uint8_t slaveRef)
     : port(portRef), slaveID(slaveRef)
@@ -23,8 +33,8 @@ void ModbusHandler::begin(unsigned long baudrate)
     }
 
     // Configure ranges (larger for safety)
-    ModbusRTUServer.configureHoldingRegisters(0, 100);
-    ModbusRTUServer.configureInputRegisters(0, 100);
+    ModbusRTUServer.configureHoldingRegisters(0, HOLDING_REG_COUNT);
+    ModbusRTUServer.configureInputRegisters(0, INPUT_REG_COUNT);
 
     // Init registers
     ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::START_REG_ADDR, 0);
@@ -33,24 +43,44 @@ void ModbusHandler::begin(unsigned long baudrate)
     ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::AIR_TEMP_LIMIT, TEMP_CRITICAL);
     ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::WATER_TEMP_LIMIT, TEMP_WARNING);
 
+    ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CTRL_KP, CTRL_DEFAULT_KP);
+    ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CTRL_KI, CTRL_DEFAULT_KI);
+    ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CTRL_KD, CTRL_DEFAULT_KD);
+    ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CTRL_MODE, 0);
+    ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CTRL_PERIOD, CTRL_DEFAULT_PERIOD);
+    ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::HISTORY_PERIOD, HISTORY_DEFAULT_PERIOD);
+    ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::THERMAL_RISE, THERMAL_DEFAULT_RISE);
+
     ModbusRTUServer.inputRegisterWrite(ModbusInputReg::TIME_LOW, 0);
     ModbusRTUServer.inputRegisterWrite(ModbusInputReg::TIME_LOW + 1, 0);
     ModbusRTUServer.inputRegisterWrite(ModbusInputReg::TIME_LOW + 2, 0);
     ModbusRTUServer.inputRegisterWrite(ModbusInputReg::TIME_LOW + 3, 0);
+    ModbusRTUServer.inputRegisterWrite(ModbusInputReg::BOARD_MOTORS, NUM_MOTORS);
 
     // Init duty and freq shadows and registers
     for (uint8_t i = 0; i < NUM_MOTORS; i++)
     {
         ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::DUTY_BASE + i, 0);
+        ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CTRL_SETPOINT_BASE + i, 0);
+        ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CURR_OFFSET_BASE + i, CURR_DEFAULT_OFFSET);
+        ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::CURR_GAIN_BASE + i, CURR_DEFAULT_GAIN);
+        ModbusRTUServer.holdingRegisterWrite(ModbusHoldingReg::THERMAL_TAU_BASE + i, THERMAL_DEFAULT_TAU);
         dutyShadows[i] = 0;
         // ModbusRTUServer.holdingRegisterWrite(ModbusReg::FREQ_BASE + i, 1000);
         // freqShadows[i] = 1000;
     }
     memset(deviceShadows, 0, sizeof(deviceShadows));
     startShadow = 0;
+    profileLengthShadow = 0;
+    airLimitShadow = TEMP_CRITICAL;
+    waterLimitShadow = TEMP_WARNING;
+    historyOffsetShadow = 0;
+    traceCtrlShadow = 0;
+    eventCursorShadow = 0;
+    rescanPending = false;
 }
 
-void ModbusHandler::task()
+bool ModbusHandler::task()
 {
     static uint8_t errorCount = 0;
 
@@ -62,14 +92,19 @@ void ModbusHandler::task()
             // Reset Modbus state after 10 errors
             ModbusRTUServer.begin(slaveID, BAUDRATE, SERIAL_8E1);
             errorCount = 0;
+            EventLog::log(EVT_MODBUS_RESTART);
         }
     }
     else
     {
         errorCount = 0;
     }
-    if (!port.available())
-        return;
+    if (pollResult > 0)
+        Trace::request(); // Before the scan below reacts to (and may rewrite) registers
+    // Only look for register changes after a request was served (or one is arriving)
+    if (pollResult <= 0 && !port.available() && !rescanPending)
+        return false;
+    rescanPending = false;
 
     // int pollResult = ModbusRTUServer.poll();
     // if (pollResult == -1) {
@@ -91,6 +126,11 @@ void ModbusHandler::task()
             handleMotorWrite(ModbusHoldingReg::DUTY_BASE + i, dutyVal);
             dutyShadows[i] = dutyVal;
         }
+        // Calibration in use doubles as the shadow
+        uint16_t offset = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::CURR_OFFSET_BASE + i);
+        uint16_t gain = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::CURR_GAIN_BASE + i);
+        if (offset != motorTable.currentOffset[i] || gain != motorTable.currentGain[i])
+            CurrentSensor::setCalibration(i, offset, gain);
         // uint16_t freqVal = ModbusRTUServer.holdingRegisterRead(ModbusReg::FREQ_BASE + i);
         // if (freqVal != freqShadows[i]) {
         // handleMotorWrite(ModbusReg::FREQ_BASE + i, freqVal);
@@ -106,12 +146,78 @@ void ModbusHandler::task()
             deviceShadows[i] = devVal;
         }
     }
+    uint16_t airLimit = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::AIR_TEMP_LIMIT);
+    if (airLimit != airLimitShadow)
+    {
+        deviceManager->setAirLimit(airLimit);
+        airLimitShadow = airLimit;
+    }
+    uint16_t waterLimit = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::WATER_TEMP_LIMIT);
+    if (waterLimit != waterLimitShadow)
+    {
+        deviceManager->setWaterLimit(waterLimit);
+        waterLimitShadow = waterLimit;
+    }
+    uint16_t profileLength = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::PROFILE_LENGTH);
+    if (profileLength != profileLengthShadow)
+    {
+        DutyProfile::setLength(profileLength);
+        profileLengthShadow = profileLength;
+    }
+    uint16_t profileCmd = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::PROFILE_COMMIT);
+    if (profileCmd)
+        DutyProfile::requestCommand(profileCmd);
+
+    if (ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::HISTORY_CTRL))
+    {
+        History::open();
+        historyOffsetShadow = 0;
+        setHreg(ModbusHoldingReg::HISTORY_CTRL, 0);
+    }
+    uint16_t historyOffset = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::HISTORY_OFFSET);
+    if (historyOffset != historyOffsetShadow)
+    {
+        History::setOffset(historyOffset);
+        historyOffsetShadow = historyOffset;
+    }
+
+    uint16_t zeroCmd = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::CURR_ZERO);
+    if (zeroCmd)
+        CurrentSensor::startZero(zeroCmd);
+
+    uint16_t configCmd = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::CONFIG_COMMIT);
+    if (configCmd && configCmd != 0xFFFF)
+        ConfigStore::requestCommit(configCmd);
+
+    if (ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::DIAG_RESET))
+    {
+        Profiler::reset();
+        Scheduler::resetStats();
+        IrqMonitor::reset();
+        setHreg(ModbusHoldingReg::DIAG_RESET, 0);
+    }
+
+    uint16_t eventCursor = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::EVENT_CURSOR);
+    if (eventCursor != eventCursorShadow)
+    {
+        EventLog::setCursor(eventCursor);
+        eventCursorShadow = eventCursor;
+    }
+
+    uint16_t traceCtrl = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::TRACE_CTRL);
+    if (traceCtrl != traceCtrlShadow)
+    {
+        Trace::setEnabled(traceCtrl == 1);
+        traceCtrlShadow = traceCtrl;
+    }
+
     uint16_t startVal = ModbusRTUServer.holdingRegisterRead(ModbusHoldingReg::START_REG_ADDR);
     if (startVal != startShadow)
     {
         handleSystemWrite(ModbusHoldingReg::START_REG_ADDR, startVal);
         startShadow = startVal;
     }
+    return true;
 }
 
 uint16_t ModbusHandler::getHreg(uint16_t addr)
@@ -127,6 +233,7 @@ uint16_t ModbusHandler::getIreg(uint16_t addr)
 void ModbusHandler::setHreg(uint16_t addr, uint16_t value)
 {
     ModbusRTUServer.holdingRegisterWrite(addr, value);
+    Trace::noteHreg(addr, value);
 }
 
 void ModbusHandler::setIreg(uint16_t addr, uint16_t value)
@@ -134,19 +241,26 @@ void ModbusHandler::setIreg(uint16_t addr, uint16_t value)
     ModbusRTUServer.inputRegisterWrite(addr, value);
 }
 
+void ModbusHandler::setDuty(uint8_t id, uint16_t duty)
+{
+    setHreg(ModbusHoldingReg::DUTY_BASE + id, duty);
+    dutyShadows[id] = duty;
+    motors[id].setDuty(duty);
+}
+
 void ModbusHandler::handleMotorWrite(uint16_t addr, uint16_t val)
 { // Changed parameter type to uint16_t
     if (addr >= ModbusHoldingReg::DUTY_BASE &&
         addr < ModbusHoldingReg::DUTY_BASE + NUM_MOTORS)
     {
         uint8_t id = addr - ModbusHoldingReg::DUTY_BASE;
-        motors[id]->setDuty(val);
+        motors[id].setDuty(val);
     }
     else if (addr == ModbusHoldingReg::GLOBAL_FREQ)
     {
         globalFreqShadow = val;
         // PWMController::setGlobalFrequency(val);
-        motors[1]->setFrequency(val);
+        motors[1].setFrequency(val);
     }
     // else if (addr >= ModbusReg::FREQ_BASE &&
     //    addr < ModbusReg::FREQ_BASE + NUM_MOTORS) {
@@ -157,14 +271,9 @@ void ModbusHandler::handleMotorWrite(uint16_t addr, uint16_t val)
 
 void ModbusHandler::handleDeviceWrite(int addr, uint16_t val)
 {
-    if (addr == ModbusInputReg::FAN_REG)
-        deviceManager->controlFan(val > 0);
-    else if (addr == ModbusInputReg::MIXER_REG)
-        deviceManager->controlMixer(val > 0);
-    else if (addr == ModbusInputReg::DISPENSER_REG)
-        deviceManager->controlDispenser(val > 0);
-    else if (addr == ModbusInputReg::PUMP_REG)
-        deviceManager->controlPump(val > 0);
+    if (addr >= ModbusInputReg::FAN_REG &&
+        addr < ModbusInputReg::FAN_REG + DeviceManager::DEVICE_COUNT)
+        deviceManager->setOutput(DeviceManager::Device(addr - ModbusInputReg::FAN_REG), val > 0);
 }
 
 void ModbusHandler::handleSystemWrite(int addr, uint16_t val)
@@ -174,23 +283,23 @@ void ModbusHandler::handleSystemWrite(int addr, uint16_t val)
         if (addr == ModbusHoldingReg::START_REG_ADDR)
         {
             PWMController::clearCount();
+            EventLog::log(EVT_START); // First entry on the new clock
+            DutyProfile::start();
         }
     }
 
     if (val == 0)
     {
         Serial1.println("Stopped start");
-        noInterrupts();
+        EventLog::log(EVT_STOP);
+        DutyProfile::stop();
         for (int i = 0; i < NUM_MOTORS; i++)
         {
             // motors[i]->setDuty(0);
             modbusHandler->setHreg(ModbusHoldingReg::DUTY_BASE + i, 0);
         }
-        deviceManager->controlFan(false);
-        deviceManager->controlMixer(false);
-        deviceManager->controlDispenser(false);
-        deviceManager->controlPump(false);
-        interrupts();
+        // All actuators off in one port write
+        deviceManager->setOutputs(DeviceManager::ALL_DEVICES, 0);
         Serial1.println("Stopped finished");
     }
 }
\ No newline at end of file
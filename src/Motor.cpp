@@ -1,44 +1,95 @@
 #include "Motor.h"
 #include "PWMController.h"
 #include "ModbusHandler.h"
+#include "CurrentSensor.h"
+#include "MotorTable.h"
 #include "Config.h"
 #include "Globals.h"
+#include "Protection.h"
+#include "Trace.h"
+#include "ThermalModel.h"
 
-Motor::Motor(uint8_t id, uint8_t pwmPin, uint8_t currentPin,
-             TemperatureSensor *tempSensor, ModbusHandler &modbus)
-    : id(id), pwmPin(pwmPin),
-      currentSensor(currentPin, ModbusInputReg::CURR_BASE + id), // Initialize CurrentSensor
-      tempSensor(tempSensor), modbusHandler(modbus),
-      dutyCycle(0), status(0)
+Motor::Motor()
+    : id(0)
 {
 }
 
+void Motor::attach(uint8_t motorId)
+{
+    id = motorId;
+}
+
 void Motor::begin()
 {
-    pinMode(pwmPin, OUTPUT);
-    currentSensor.begin(); // Initialize current sensor
+    motorTable.dutyLimit[id] = 100;
+    Protection::setIdle(id, true);
 
-    // PWMController::setFrequency(pwmPin, 1000);
-    PWMController::setGlobalFrequency(7812);
-    PWMController::setDutyCycle(pwmPin, 0);
+    // Channel at duty 0 before the pin starts driving it; the timers and
+    // frequency are set up once by PWMController::initialize()
+    PWMController::setDutyCycle(Board::PWM_PINS[id], 0);
+    pinMode(Board::PWM_PINS[id], OUTPUT);
+    CurrentSensor::begin(id); // Initialize current sensor
 }
 
 void Motor::update(uint64_t now)
 {
-    currentSensor.update(now); // Update current reading
+    CurrentSensor::update(id, now); // Update current reading
+    ThermalModel::update(id, (uint16_t)now);
+    // Temperature and status registers are published by the sensor and protection paths
+}
 
-    int16_t temp = tempSensor->getTemperature();
-    modbusHandler.setIreg(ModbusInputReg::TEMP_BASE + id, static_cast<uint16_t>(temp));
+void Motor::setDuty(uint16_t duty)
+{
+    motorTable.dutyCycle[id] = duty;
+    if (!(motorTable.closedLoop & (1U << id)))
+    {
+        Protection::setIdle(id, duty == 0);
+        applyOutput(duty);
+    }
+}
 
-    uint8_t tempStatus = tempSensor->getStatus();
-    uint16_t current = currentSensor.getCurrent(); // Get current from sensor
+void Motor::setDutyLimit(uint8_t limit)
+{
+    if (limit == motorTable.dutyLimit[id])
+        return;
 
-    modbusHandler.setIreg(ModbusInputReg::STATUS_BASE + id, status);
+    motorTable.dutyLimit[id] = limit;
+    applyOutput(motorTable.outputDuty[id]);
 }
 
-void Motor::setDuty(uint16_t duty)
+void Motor::applyOutput(uint16_t duty)
 {
-    PWMController::setDutyCycle(pwmPin, duty);
+    uint8_t limit = motorTable.dutyLimit[id];
+    uint8_t applied = duty < limit ? duty : limit;
+    motorTable.outputDuty[id] = duty;
+    PWMController::setDutyCycle(Board::PWM_PINS[id], applied);
+    Trace::output(id, applied);
+}
+
+void Motor::setClosedLoop(bool enable)
+{
+    uint16_t mask = 1U << id;
+    if (enable == ((motorTable.closedLoop & mask) != 0))
+        return;
+
+    if (enable)
+    {
+        motorTable.closedLoop |= mask;
+        motorTable.pid[id].reset(motorTable.dutyCycle[id], motorTable.current[id]);
+    }
+    else
+    {
+        motorTable.closedLoop &= ~mask;
+        Protection::setIdle(id, motorTable.dutyCycle[id] == 0);
+        applyOutput(motorTable.dutyCycle[id]);
+    }
+}
+
+void Motor::control(int16_t setpoint, const PIDController::Gains &gains)
+{
+    uint16_t measurement = CurrentSensor::sample(id);
+    Protection::setIdle(id, setpoint <= 0);
+    applyOutput(motorTable.pid[id].update(setpoint, measurement, gains, motorTable.dutyLimit[id]));
 }
 
 void Motor::setFrequency(uint32_t freq)
@@ -48,20 +99,20 @@ void Motor::setFrequency(uint32_t freq)
 
 uint8_t Motor::getStatus() const
 {
-    return status;
+    return motorTable.status[id];
 }
 
 float Motor::getCurr() const
 {
-    return currentSensor.getCurrent();
+    return motorTable.current[id];
 }
 
 float Motor::getTemp() const
 {
-    return tempSensor->getTemperature();
+    return motorTable.temperature[id] / 100.0f;
 }
 
 float Motor::getDuty() const
 {
-    return PWMController::getDuty(pwmPin);
-}
\ No newline at end of file
+    return PWMController::getDuty(Board::PWM_PINS[id]);
+}
@@ -0,0 +1,4 @@
+#include "MotorTable.h"
+
+// Zero-initialised static storage; Motor::begin() fills in the non-zero defaults
+MotorTable motorTable;
@@ -0,0 +1,56 @@
+#include "PIDController.h"
+
+static constexpr int32_t TERM_LIMIT = 0x00FFFFFFL; // keeps P + I + D inside int32
+
+static inline int32_t clampTerm(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+uint16_t PIDController::stepGain(uint16_t perSecond, uint16_t dtMs)
+{
+    uint32_t g = ((uint32_t)perSecond * dtMs + 500) / 1000;
+    return g > 0xFFFF ? 0xFFFF : (uint16_t)g;
+}
+
+PIDController::PIDController()
+    : integral(0), prevMeasurement(0)
+{
+}
+
+void PIDController::reset(uint16_t output, int16_t measurement)
+{
+    if (output > OUTPUT_MAX)
+        output = OUTPUT_MAX;
+    integral = (int32_t)output << 16;
+    prevMeasurement = measurement;
+}
+
+uint16_t PIDController::update(int16_t setpoint, int16_t measurement, const PIDController::Gains &gains,
+                               uint8_t outputMax)
+{
+    if (outputMax > OUTPUT_MAX)
+        outputMax = OUTPUT_MAX;
+    const int32_t outMaxQ16 = (int32_t)outputMax << 16;
+
+    // Errors are clamped to int16 range so gain * error (65535 * 32767 at
+    // most) always fits in int32
+    int32_t error = clampTerm((int32_t)setpoint - measurement, -0x7FFF, 0x7FFF);
+    int32_t delta = clampTerm((int32_t)measurement - prevMeasurement, -0x7FFF, 0x7FFF);
+    prevMeasurement = measurement;
+
+    int32_t pTerm = clampTerm((int32_t)gains.kp * error, -TERM_LIMIT, TERM_LIMIT);
+    int32_t dTerm = clampTerm(-((int32_t)gains.kd * delta), -TERM_LIMIT, TERM_LIMIT);
+    int32_t out = pTerm + integral + dTerm;
+
+    // Conditional integration: hold the integrator while the output is
+    // pinned and the error would push it further out of range
+    if (!((out >= outMaxQ16 && error > 0) || (out <= 0 && error < 0)))
+    {
+        integral = clampTerm(integral + (int32_t)gains.ki * error, 0, outMaxQ16);
+        out = pTerm + integral + dTerm;
+    }
+
+    out = clampTerm(out, 0, outMaxQ16);
+    return (uint16_t)((out + 0x8000) >> 16);
+}
@@ -1,33 +1,154 @@
 // PWMController.cpp
 #include "PWMController.h"
 #include "Config.h" // Contains MIN_PWM_FREQ and MAX_PWM_FREQ
+#include "SoftPWM.h"
+#include "IrqMonitor.h"
 #include <Arduino.h>
 #include <avr/io.h> // Direct access to AVR timer registers
 
 volatile uint64_t PWMController::_micros64 = 0;
-uint16_t PWMController::_timer2_top = 0xFF;
-uint16_t PWMController::_timer2_prescaler = 8;
-uint32_t PWMController::_us_per_overflow = 1294854; // Default for 7812 Hz
+uint64_t PWMController::_microsOffset = 0;
+uint64_t PWMController::_millisOffset = 0;
+volatile uint64_t PWMController::_millis64 = 0;
+volatile uint16_t PWMController::_usRemainder = 0;
+uint16_t PWMController::_usPerOverflow = 0;
+uint16_t PWMController::_usRemPerOverflow = 0;
+uint8_t PWMController::_msPerOverflow = 0;
+uint16_t PWMController::_usPerTickQ8 = 0;
+uint8_t PWMController::_cycleRemainder = 0;
+uint8_t PWMController::_timer2_cs = 0;
+uint16_t PWMController::_timer2_prescaler = 0;
+
+static constexpr uint32_t CYCLES_PER_US = F_CPU / 1000000UL;
+static_assert(SOFT_PWM_MOTORS <= SoftPWM::MAX_CHANNELS, "More SoftPWM motors than SoftPWM channels");
+static_assert(256000000UL % F_CPU == 0, "Timer2 tick must be a whole number of 1/256 us");
+
+// Timer2 clock-select value (CS22:0) -> prescaler
+static const uint16_t TIMER2_PRESCALERS[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+// One Timer2 overflow worth of time. Every prescaler gives a whole number of
+// microseconds per overflow (16 * prescaler at 16 MHz), so both counters
+// advance exactly with additions only.
+static inline __attribute__((always_inline)) void accumulateOverflow()
+{
+    PWMController::_micros64 += PWMController::_usPerOverflow;
+    PWMController::_millis64 += PWMController::_msPerOverflow;
+    uint16_t rem = PWMController::_usRemainder + PWMController::_usRemPerOverflow;
+    if (rem >= 1000)
+    {
+        rem -= 1000;
+        PWMController::_millis64++;
+    }
+    PWMController::_usRemainder = rem;
+}
 
 // Timer 2 overflow interrupt
 ISR(TIMER2_OVF_vect)
 {
-    PWMController::_micros64++;
+    IrqMonitor::timer2Entry();
+    accumulateOverflow();
+}
+
+// Last values handed out, for the monotonicity check
+static uint64_t lastMicros = 0;
+static uint64_t lastMillis = 0;
+
+// Ticks into the current overflow epoch. TOV2 is set as the count wraps
+// from MAX to BOTTOM, so a pending flag with a count below 255 means the
+// overflow has happened but its ISR has not run yet; a count of 255 read
+// just before the wrap belongs to the old epoch (the same guard as the
+// core's micros()). Called with interrupts off.
+static inline __attribute__((always_inline)) uint8_t epochTicks(bool &pending)
+{
+    uint8_t tcnt = TCNT2;
+    pending = (TIFR2 & _BV(TOV2)) && tcnt < 255;
+    return tcnt;
 }
 
+// Microseconds since boot. Adds the ticks into the current overflow epoch
+// scaled by a Q8 us-per-tick factor, so resolution is one Timer2 tick.
+uint64_t PWMController::uptimeMicros()
+{
+    uint64_t us;
+    uint8_t ticks;
+    bool pending;
+    uint16_t q8;
+    {
+        IrqMonitor::Critical cs(IrqMonitor::SITE_TIMEBASE);
+        us = _micros64;
+        ticks = epochTicks(pending);
+        if (pending)
+            us += _usPerOverflow; // overflow pending, ISR not yet run
+        q8 = _usPerTickQ8;
+    }
+
+    us += (uint16_t)(((uint32_t)ticks * q8) >> 8);
+    IrqMonitor::checkTime(us, lastMicros);
+    return us;
+}
+
+// Microseconds since the last clearCount()
 uint64_t PWMController::microsCustom()
 {
-    uint64_t m;
-    cli();
-    m = _micros64 * _us_per_overflow;
-    m = m / 1000;
-    sei();
-    return m;
+    return uptimeMicros() - _microsOffset;
+}
+
+// _millisOffset only changes in clearCount(), from the main loop like every
+// caller, so it needs no guard of its own
+uint64_t PWMController::uptimeMillis()
+{
+    return millisCustom() + _millisOffset;
 }
 
+// Milliseconds since the last clearCount(); cheap enough for every loop pass
 uint64_t PWMController::millisCustom()
 {
-    return microsCustom() / 10000;
+    uint64_t ms;
+    uint16_t us;
+    uint8_t ticks;
+    bool pending;
+    uint16_t q8;
+    {
+        IrqMonitor::Critical cs(IrqMonitor::SITE_TIMEBASE);
+        ms = _millis64;
+        us = _usRemainder;
+        ticks = epochTicks(pending);
+        if (pending)
+        {
+            ms += _msPerOverflow;
+            us += _usRemPerOverflow;
+        }
+        q8 = _usPerTickQ8;
+    }
+
+    // Below 2 ms per epoch up to clk/64 (at most two passes); at clk/1024
+    // an epoch is 16.384 ms and this runs up to 17 times
+    us += (uint16_t)(((uint32_t)ticks * q8) >> 8);
+    while (us >= 1000)
+    {
+        us -= 1000;
+        ms++;
+    }
+    IrqMonitor::checkTime(ms, lastMillis);
+    return ms;
+}
+
+uint32_t PWMController::cycles()
+{
+    uint32_t us;
+    uint8_t ticks;
+    bool pending;
+    uint16_t prescaler;
+    {
+        IrqMonitor::Critical cs(IrqMonitor::SITE_TIMEBASE);
+        us = (uint32_t)_micros64;
+        ticks = epochTicks(pending);
+        if (pending)
+            us += _usPerOverflow;
+        prescaler = _timer2_prescaler;
+    }
+
+    return us * CYCLES_PER_US + (uint32_t)ticks * prescaler;
 }
 
 void PWMController::delayCustom(uint64_t ms)
@@ -37,27 +158,101 @@ void PWMController::delayCustom(uint64_t ms)
         ;
 }
 
+// Folds the time elapsed in the current overflow epoch (including a pending
+// overflow and the partial count) into the counters, ahead of a TCNT2
+// restart. Called with interrupts off.
+void PWMController::foldEpoch()
+{
+    bool pending;
+    uint8_t ticks = epochTicks(pending);
+    if (pending)
+    {
+        accumulateOverflow();
+        TIFR2 = _BV(TOV2);
+    }
+    uint32_t cycles = (uint32_t)ticks * _timer2_prescaler + _cycleRemainder;
+    uint16_t us = cycles / CYCLES_PER_US;
+    _cycleRemainder = cycles % CYCLES_PER_US;
+    _micros64 += us;
+    us += _usRemainder;
+    while (us >= 1000)
+    {
+        us -= 1000;
+        _millis64++;
+    }
+    _usRemainder = us;
+}
+
+// Restarts microsCustom()/millisCustom() at zero. TCNT2 and the Timer2
+// prescaler are reset too, so the new epoch starts on an exact tick boundary
+// (pins 9/10 see one shortened PWM period). The uptime clocks and cycles()
+// keep running: the elapsed epoch is folded in and becomes the offset
+// microsCustom() counts from, and the elapsed ms carry into uptimeMillis().
 void PWMController::clearCount()
 {
-    PWMController::_micros64 = 0;
+    uint8_t sreg = SREG;
+    cli();
+    foldEpoch();
+    _microsOffset = _micros64;
+    _millisOffset += _millis64;
+    _millis64 = 0;
+    _usRemainder = 0;
+    TCNT2 = 0;
+    GTCCR = _BV(PSRASY);
+    TIFR2 = _BV(TOV2);
+    lastMillis = 0; // Deliberate restart, not a backwards step
+    SREG = sreg;
+}
+
+// Switches the Timer2 prescaler and starts a new timebase epoch: time elapsed
+// under the old prescaler (including a pending overflow and the partial
+// count) is folded into the counters before the new scale takes effect.
+void PWMController::setTimer2Prescaler(uint8_t cs)
+{
+    cs &= 0x07;
+    if (cs == _timer2_cs)
+        return;
+
+    uint8_t sreg = SREG;
+    cli();
+
+    foldEpoch();
+    TCCR2B = (TCCR2B & 0xF8) | cs;
+    TCNT2 = 0;
+    GTCCR = _BV(PSRASY);
+    TIFR2 = _BV(TOV2);
+
+    _timer2_cs = cs;
+    _timer2_prescaler = TIMER2_PRESCALERS[cs];
+    _usPerOverflow = 256UL * _timer2_prescaler / CYCLES_PER_US;
+    _msPerOverflow = _usPerOverflow / 1000;
+    _usRemPerOverflow = _usPerOverflow % 1000;
+    _usPerTickQ8 = _timer2_prescaler * (256000000UL / F_CPU);
+    IrqMonitor::setTickScale(_usPerTickQ8);
+
+    SREG = sreg;
 }
 
 // Initialize all timers (Timer0–Timer5) in PWM mode
 void PWMController::initialize()
 {
-    // Ensure pins are outputs
-    // pinMode(13, OUTPUT); // PB7: OC1C (Timer1) — repurposed from OC0A
-    // pinMode(4,  OUTPUT); // PG5: OC0B (Timer0)
-
-    // ---------------- Timer 0: Pin 4 (OC0B) with OCR0A as TOP ----------------
-    // Fast PWM with OCR0A as TOP (WGM02:0 = 7). OC0B enabled, OC0A disconnected.
-    // TCCR0A = _BV(WGM00) | _BV(WGM01) | _BV(COM0B1);
-    // TCCR0B = _BV(WGM02) | _BV(CS00); // prescaler = /1
-    // OCR0A  = 0xFF;
-    // OCR0B  = 0x00;
+    // ---------------- Timer 0: software PWM engine ----------------
+    // Pin 4 (OC0B) and any other motor pin without a hardware channel is driven
+    // from the Timer0 compare ISRs. The core's Timer0 overflow (millis) stays off.
+    // Boards without such pins only switch the core's overflow interrupt off.
+    if (SOFT_PWM_MOTORS > 0)
+    {
+        SoftPWM::initialize();
+        for (uint8_t i = 0; i < NUM_MOTORS; i++)
+        {
+            if (pwmChannel(Board::PWM_PINS[i]) == PWM_SOFT)
+                SoftPWM::attach(Board::PWM_PINS[i]);
+        }
+    }
+    else
+        TIMSK0 &= ~_BV(TOIE0);
 
     TIMSK2 |= (1 << TOIE2);
-    TIMSK0 &= ~(1 << TOIE0);
 
     // ---------------- Timer 1: Pins 11 (OC1A), 12 (OC1B), 13 (OC1C) ----------------
     // Mode 14 Fast PWM, TOP=ICR1
@@ -68,7 +263,7 @@ void PWMController::initialize()
     // ---------------- Timer 2: Pins 9,10 (OC2A,OC2B) ----------------
     // Fast PWM, fixed prescaler choices
     TCCR2A = _BV(WGM20) | _BV(WGM21) | _BV(COM2A1) | _BV(COM2B1);
-    TCCR2B = _BV(CS21);
+    setTimer2Prescaler(_BV(CS21));
 
     // ---------------- Timer 3: Pins 5,2,3 (OC3A/OC3B/OC3C) ----------------
     TCCR3A = _BV(COM3A1) | _BV(COM3B1) | _BV(WGM31);
@@ -91,45 +286,24 @@ void PWMController::setGlobalFrequency(uint32_t freq)
 {
     // Timer 0 (8-bit): Pin 4
 
-    // Timer 2 (8-bit): Pins 9, 10
+    // Timer 2 (8-bit): Pins 9, 10. Also drives the timebase, so a prescaler
+    // change switches epochs (see setTimer2Prescaler).
+    uint8_t cs;
     if (freq >= 10000)
-    {
-        TCCR2B = (TCCR2B & 0xF8) | 0x01;
-        _timer2_prescaler = 1;
-    }
+        cs = 0x01; // clk/1
     else if (freq >= 5000)
-    {
-        TCCR2B = (TCCR2B & 0xF8) | 0x02;
-        _timer2_prescaler = 8;
-    }
+        cs = 0x02; // clk/8
     else if (freq >= 2000)
-    {
-        TCCR2B = (TCCR2B & 0xF8) | 0x03;
-        _timer2_prescaler = 32;
-    }
+        cs = 0x03; // clk/32
     else if (freq >= 1000)
-    {
-        TCCR2B = (TCCR2B & 0xF8) | 0x04;
-        _timer2_prescaler = 64;
-    }
+        cs = 0x04; // clk/64
     else if (freq >= 500)
-    {
-        TCCR2B = (TCCR2B & 0xF8) | 0x05;
-        _timer2_prescaler = 128;
-    }
+        cs = 0x05; // clk/128
     else if (freq >= 200)
-    {
-        TCCR2B = (TCCR2B & 0xF8) | 0x06;
-        _timer2_prescaler = 256;
-    }
+        cs = 0x06; // clk/256
     else
-    {
-        TCCR2B = (TCCR2B & 0xF8) | 0x07;
-        _timer2_prescaler = 512;
-    }
-    _timer2_top = 0xFF;
-    // _us_per_overflow = (1000000UL * _timer2_prescaler * (_timer2_top + 1)) / F_CPU + 1;
-    _us_per_overflow = 1294854;
+        cs = 0x07; // clk/1024
+    setTimer2Prescaler(cs);
 
     // Ensure Timer2 interrupt is enabled
     TIMSK2 |= (1 << TOIE2);
@@ -157,140 +331,165 @@ void PWMController::setGlobalFrequency(uint32_t freq)
     ICR5 = uint16_t(top);
 }
 
-// Set PWM duty cycle (0–1000) for the given pin
+// TOP of the timer behind a hardware channel
+static uint16_t channelTop(PwmChannel channel)
+{
+    switch (channel)
+    {
+    case PWM_1A:
+    case PWM_1B:
+    case PWM_1C:
+        return ICR1;
+    case PWM_3A:
+    case PWM_3B:
+    case PWM_3C:
+        return ICR3;
+    case PWM_4A:
+    case PWM_4B:
+    case PWM_4C:
+        return ICR4;
+    case PWM_5A:
+    case PWM_5B:
+    case PWM_5C:
+        return ICR5;
+    default:
+        return 255; // Timer2, 8-bit
+    }
+}
+
+// Set PWM duty cycle (0–100 %) for the given pin. The compare value (a
+// 32-bit division) is worked out first; interrupts are only off for the
+// 16-bit OCR write itself.
 void PWMController::setDutyCycle(uint8_t pin, uint16_t duty)
 {
-    noInterrupts();
-    duty = constrain(duty, 0, 100); // per-mille (0–1000)
-    uint16_t ocrValue = 0;
+    duty = constrain(duty, 0, 100);
+    PwmChannel channel = pwmChannel(pin);
+
+    if (channel == PWM_SOFT)
+    {
+        // Software PWM (no usable OCR output); hands over its own schedule
+        if (SOFT_PWM_MOTORS > 0)
+            SoftPWM::setDutyCycle(pin, duty);
+        return;
+    }
+    if (channel == PWM_NONE)
+        return;
+
+    uint16_t value = (uint32_t)duty * channelTop(channel) / 100UL;
 
-    switch (pin)
+    IrqMonitor::Critical cs(IrqMonitor::SITE_PWM_DUTY);
+    switch (channel)
     {
     // --- Timer1 (ICR1 as TOP) ---
-    case 11:
-        ocrValue = (uint32_t)duty * ICR1 / 100UL;
-        OCR1A = ocrValue;
+    case PWM_1A:
+        OCR1A = value;
         break;
-    case 12:
-        ocrValue = (uint32_t)duty * ICR1 / 100UL;
-        OCR1B = ocrValue;
+    case PWM_1B:
+        OCR1B = value;
         break;
-    case 13:
-        ocrValue = (uint32_t)duty * ICR1 / 100UL;
-        OCR1C = ocrValue;
+    case PWM_1C:
+        OCR1C = value;
         break;
 
-    // --- Timer3 (ICR3 as TOP) ---
-    case 5:
-        ocrValue = (uint32_t)duty * ICR3 / 100UL;
-        OCR3A = ocrValue;
-        break;
-    case 2:
-        ocrValue = (uint32_t)duty * ICR3 / 100UL;
-        OCR3B = ocrValue;
+    // --- Timer2 (8-bit, TOP=255) ---
+    case PWM_2A:
+        OCR2A = value;
         break;
-    case 3:
-        ocrValue = (uint32_t)duty * ICR3 / 100UL;
-        OCR3C = ocrValue;
+    case PWM_2B:
+        OCR2B = value;
         break;
 
-    // --- Timer4 (ICR4 as TOP) ---
-    case 6:
-        ocrValue = (uint32_t)duty * ICR4 / 100UL;
-        OCR4A = ocrValue;
+    // --- Timer3 (ICR3 as TOP) ---
+    case PWM_3A:
+        OCR3A = value;
         break;
-    case 7:
-        ocrValue = (uint32_t)duty * ICR4 / 100UL;
-        OCR4B = ocrValue;
+    case PWM_3B:
+        OCR3B = value;
         break;
-    case 8:
-        ocrValue = (uint32_t)duty * ICR4 / 100UL;
-        OCR4C = ocrValue;
+    case PWM_3C:
+        OCR3C = value;
         break;
 
-    // --- Timer2 (8-bit, TOP=255) ---
-    case 9:
-        ocrValue = (uint32_t)duty * 255 / 100UL;
-        OCR2B = ocrValue;
+    // --- Timer4 (ICR4 as TOP) ---
+    case PWM_4A:
+        OCR4A = value;
         break;
-    case 10:
-        ocrValue = (uint32_t)duty * 255 / 100UL;
-        OCR2A = ocrValue;
+    case PWM_4B:
+        OCR4B = value;
+        break;
+    case PWM_4C:
+        OCR4C = value;
         break;
-
-    // --- Timer0 (Fast PWM, TOP=OCR0A) ---
-    // case 4:  ocrValue = (uint32_t)duty * OCR0A / 1000UL; OCR0B = ocrValue; break;
 
     // --- Timer5 (ICR5 as TOP) ---
-    case 46:
-        ocrValue = (uint32_t)duty * ICR5 / 100UL;
-        OCR5A = ocrValue;
+    case PWM_5A:
+        OCR5A = value;
+        break;
+    case PWM_5B:
+        OCR5B = value;
         break;
-    case 45:
-        ocrValue = (uint32_t)duty * ICR5 / 100UL;
-        OCR5B = ocrValue;
+    case PWM_5C:
+        OCR5C = value;
         break;
-    case 44:
-        ocrValue = (uint32_t)duty * ICR5 / 100UL;
-        OCR5C = ocrValue;
+
+    default:
         break;
     }
-    interrupts();
 }
 
+// Duty of a pin in percent, read back from its compare register
 float PWMController::getDuty(uint8_t pin)
 {
-    switch (pin)
+    PwmChannel channel = pwmChannel(pin);
+    uint16_t ocr;
+    switch (channel)
     {
-    // --- Timer1 (ICR1 as TOP) ---
-    case 11:
-        return OCR1A / ICR1 * 100;
+    case PWM_1A:
+        ocr = OCR1A;
         break;
-    case 12:
-        return OCR1B / ICR1 * 100;
+    case PWM_1B:
+        ocr = OCR1B;
         break;
-    case 13:
-        return OCR1C / ICR1 * 100;
+    case PWM_1C:
+        ocr = OCR1C;
         break;
-
-    // --- Timer3 (ICR3 as TOP) ---
-    case 5:
-        return OCR3A / ICR3 * 100;
+    case PWM_2A:
+        ocr = OCR2A;
         break;
-    case 2:
-        return OCR3B / ICR3 * 100;
+    case PWM_2B:
+        ocr = OCR2B;
         break;
-    case 3:
-        return OCR3C / ICR3 * 100;
+    case PWM_3A:
+        ocr = OCR3A;
         break;
-
-    // --- Timer4 (ICR4 as TOP) ---
-    case 6:
-        return OCR4A / ICR4 * 100;
+    case PWM_3B:
+        ocr = OCR3B;
         break;
-    case 7:
-        return OCR4B / ICR4 * 100;
+    case PWM_3C:
+        ocr = OCR3C;
         break;
-    case 8:
-        return OCR4C / ICR4 * 100;
+    case PWM_4A:
+        ocr = OCR4A;
         break;
-
-    // --- Timer2 (8-bit, TOP=255) ---
-    case 9:
-        return OCR2A / 255 * 100;
+    case PWM_4B:
+        ocr = OCR4B;
         break;
-    case 10:
-        return OCR2B / 255 * 100;
+    case PWM_4C:
+        ocr = OCR4C;
         break;
-
-    case 46:
-        return OCR5A / ICR5 * 100;
+    case PWM_5A:
+        ocr = OCR5A;
         break;
-    case 45:
-        return OCR5B / ICR5 * 100;
+    case PWM_5B:
+        ocr = OCR5B;
         break;
-    case 44:
-        return OCR5C / ICR5 * 100;
+    case PWM_5C:
+        ocr = OCR5C;
         break;
+    case PWM_SOFT:
+        return SOFT_PWM_MOTORS > 0 ? SoftPWM::getDuty(pin) : 0;
+    default:
+        return 0;
     }
+    return ocr * 100.0f / channelTop(channel);
 }
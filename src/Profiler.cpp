@@ -0,0 +1,82 @@
+#include "Profiler.h"
+#include "ModbusHandler.h"
+#include "Globals.h"
+
+uint32_t Profiler::minCycles[Profiler::PROBE_COUNT];
+uint32_t Profiler::maxCycles[Profiler::PROBE_COUNT];
+uint32_t Profiler::sumCycles[Profiler::PROBE_COUNT];
+uint16_t Profiler::calls[Profiler::PROBE_COUNT];
+uint32_t Profiler::lastPassStart = 0;
+uint32_t Profiler::idleCycles = 0;
+bool Profiler::lastPassIdle = false;
+uint32_t Profiler::windowStart = 0;
+
+void Profiler::record(uint8_t probe, uint32_t cycles)
+{
+    if (cycles < minCycles[probe])
+        minCycles[probe] = cycles;
+    if (cycles > maxCycles[probe])
+        maxCycles[probe] = cycles;
+    sumCycles[probe] += cycles;
+    if (calls[probe] != 0xFFFF)
+        calls[probe]++;
+}
+
+// An idle pass is charged from its start to the start of the next one, so
+// the loop overhead between passes counts too
+void Profiler::loopPass(uint32_t start, bool worked)
+{
+    if (lastPassStart)
+    {
+        uint32_t period = start - lastPassStart;
+        record(PROBE_LOOP, period);
+        if (lastPassIdle)
+            idleCycles += period;
+    }
+    lastPassStart = start;
+    lastPassIdle = !worked;
+}
+
+static void publish32(uint16_t reg, uint32_t value)
+{
+    modbusHandler->setIreg(reg, value & 0xFFFF);
+    modbusHandler->setIreg(reg + 1, value >> 16);
+}
+
+void Profiler::publish()
+{
+    uint32_t now = PWMController::cycles();
+    uint32_t window = now - windowStart;
+
+    for (uint8_t p = 0; p < PROBE_COUNT; p++)
+    {
+        uint16_t reg = ModbusInputReg::DIAG_BASE + p * REGS_PER_PROBE;
+        modbusHandler->setIreg(reg, calls[p]);
+        publish32(reg + 1, minCycles[p] == 0xFFFFFFFFUL ? 0 : minCycles[p]);
+        publish32(reg + 3, calls[p] ? sumCycles[p] / calls[p] : 0);
+        publish32(reg + 5, maxCycles[p]);
+        sumCycles[p] = 0;
+        calls[p] = 0;
+    }
+
+    // idle / window in percent without overflowing 32 bits
+    uint16_t idlePct = window >= 100 ? idleCycles / (window / 100) : 0;
+    modbusHandler->setIreg(ModbusInputReg::DIAG_IDLE_PCT, idlePct > 100 ? 100 : idlePct);
+    idleCycles = 0;
+    windowStart = now;
+}
+
+void Profiler::reset()
+{
+    for (uint8_t p = 0; p < PROBE_COUNT; p++)
+    {
+        minCycles[p] = 0xFFFFFFFFUL;
+        maxCycles[p] = 0;
+        sumCycles[p] = 0;
+        calls[p] = 0;
+    }
+    lastPassStart = 0;
+    lastPassIdle = false;
+    idleCycles = 0;
+    windowStart = PWMController::cycles();
+}
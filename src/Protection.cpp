@@ -0,0 +1,88 @@
+#include "Protection.h"
+#include "ModbusHandler.h"
+#include "PWMController.h"
+#include "MotorTable.h"
+#include "Globals.h"
+#include "Trace.h"
+#include "ThermalModel.h"
+#include "EventLog.h"
+
+uint16_t Protection::lastPassCycles = 0;
+
+void Protection::setTemperature(uint8_t id, int16_t centiC, bool connected)
+{
+    uint16_t mask = 1U << id;
+    if (connected)
+    {
+        motorTable.temperature[id] = centiC;
+        motorTable.sensorFault &= ~mask;
+    }
+    else
+    {
+        motorTable.sensorFault |= mask;
+    }
+}
+
+void Protection::setIdle(uint8_t id, bool isIdle)
+{
+    uint16_t mask = 1U << id;
+    if (isIdle)
+        motorTable.idle |= mask;
+    else
+        motorTable.idle &= ~mask;
+}
+
+void Protection::evaluate()
+{
+    uint32_t start = PWMController::cycles();
+
+    int16_t tempCrit = (int16_t)modbusHandler->getHreg(ModbusHoldingReg::MOTOR_TEMP_CRIT);
+    uint16_t currCrit = modbusHandler->getHreg(ModbusHoldingReg::MOTOR_CURR_CRIT);
+
+    MotorTable &t = motorTable;
+    uint16_t mask = 1;
+    for (uint8_t i = 0; i < NUM_MOTORS; i++, mask <<= 1)
+    {
+        // Winding estimate: the case reading plus the modelled rise
+        int16_t temp = ThermalModel::estimate(i);
+        uint8_t s;
+        if (t.sensorFault & mask)
+            s = MOTOR_SENSOR_FAULT;
+        else if (t.current[i] >= currCrit)
+            s = MOTOR_TRIP_CURRENT;
+        else if (temp >= tempCrit)
+            s = MOTOR_TRIP_TEMP;
+        else if (temp >= (int16_t)TEMP_WARNING)
+            s = MOTOR_WARNING;
+        else
+            s = MOTOR_OK;
+
+        if (s >= MOTOR_TRIP_TEMP)
+            t.tripped |= mask;
+        else if (t.tripped & mask)
+        {
+            if (t.idle & mask)
+                t.tripped &= ~mask; // fault gone and acknowledged
+            else
+                s = t.status[i];    // hold the latched trip code
+        }
+
+        if (s == t.status[i])
+            continue;
+
+        t.status[i] = s;
+        modbusHandler->setIreg(ModbusInputReg::STATUS_BASE + i, s);
+        Trace::status(i, s);
+        if (s == MOTOR_TRIP_TEMP)
+            EventLog::log(ERR_TEMP_HIGH, i, (uint16_t)temp);
+        else if (s == MOTOR_TRIP_CURRENT)
+            EventLog::log(ERR_OVERCURRENT, i, t.current[i]);
+        else if (s != MOTOR_SENSOR_FAULT) // Logged by the sensor path, with air and water
+            EventLog::log(EVT_MOTOR_STATUS, i, s);
+        motors[i].setDutyLimit(s >= MOTOR_TRIP_TEMP ? 0 : (s == MOTOR_WARNING ? DERATE_DUTY : 100));
+    }
+
+    uint32_t elapsed = PWMController::cycles() - start;
+    lastPassCycles = elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed;
+    modbusHandler->setIreg(ModbusInputReg::PROTECTION_CYCLES, lastPassCycles);
+}
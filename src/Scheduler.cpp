@@ -0,0 +1,163 @@
+#include "Scheduler.h"
+#include "ModbusHandler.h"
+#include "PWMController.h"
+#include "Globals.h"
+
+Scheduler::Task Scheduler::tasks[Scheduler::MAX_TASKS];
+uint8_t Scheduler::taskCount = 0;
+
+// Wrap-safe "a is at or after b" on the 32-bit uptime clock, which START
+// does not clear
+static inline bool reached(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) >= 0;
+}
+
+static inline uint16_t saturate16(uint32_t v)
+{
+    return v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+}
+
+int8_t Scheduler::add(TaskFn fn, uint16_t periodMs, uint8_t priority, uint16_t budgetUs)
+{
+    if (taskCount >= MAX_TASKS)
+        return -1;
+
+    Task &t = tasks[taskCount];
+    memset(&t, 0, sizeof(t));
+    t.fn = fn;
+    t.periodUs = periodMs * 1000UL;
+    t.nextRelease = (uint32_t)PWMController::uptimeMicros() + t.periodUs;
+    t.budgetUs = budgetUs;
+    t.priority = priority;
+    return taskCount++;
+}
+
+void Scheduler::setPeriod(uint8_t id, uint16_t periodMs)
+{
+    if (id >= taskCount)
+        return;
+
+    uint32_t periodUs = periodMs * 1000UL;
+    if (periodUs == tasks[id].periodUs)
+        return;
+
+    tasks[id].periodUs = periodUs;
+    tasks[id].nextRelease = (uint32_t)PWMController::uptimeMicros() + periodUs;
+}
+
+void Scheduler::releaseNow(uint8_t id)
+{
+    if (id < taskCount)
+        tasks[id].nextRelease = (uint32_t)PWMController::uptimeMicros();
+}
+
+bool Scheduler::run()
+{
+    uint32_t now = (uint32_t)PWMController::uptimeMicros();
+    int8_t best = -1;
+    bool worked = false;
+
+    for (uint8_t i = 0; i < taskCount; i++)
+    {
+        Task &t = tasks[i];
+        if (t.periodUs == 0)
+        {
+            now = runSlice(i, now, worked);
+            continue;
+        }
+
+        if (reached(now, t.nextRelease))
+        {
+            if (t.pending)
+            {
+                t.deadlineMisses++;
+                publish(i);
+            }
+            else
+            {
+                t.pending = true;
+                t.started = false;
+                t.releasedAt = t.nextRelease;
+            }
+            t.nextRelease += t.periodUs;
+            if (reached(now, t.nextRelease))
+                t.nextRelease = now + t.periodUs; // fell more than a period behind
+        }
+
+        if (t.pending && (best < 0 || t.priority < tasks[best].priority))
+            best = i;
+    }
+
+    if (best < 0)
+        return worked;
+
+    runSlice(best, now, worked);
+    return true;
+}
+
+// Runs one slice starting at `now`; returns the end time so back-to-back
+// slices share a single clock read. `worked` is set if a polled task
+// reports it did work.
+uint32_t Scheduler::runSlice(uint8_t id, uint32_t now, bool &worked)
+{
+    Task &t = tasks[id];
+    bool changed = false;
+
+    if (t.periodUs && !t.started)
+    {
+        t.started = true;
+        uint32_t jitter = now - t.releasedAt;
+        if (jitter > t.maxJitterUs)
+        {
+            t.maxJitterUs = jitter;
+            changed = true;
+        }
+    }
+
+    bool more = t.fn();
+    uint32_t end = (uint32_t)PWMController::uptimeMicros();
+    uint32_t elapsed = end - now;
+
+    if (elapsed > t.maxSliceUs)
+    {
+        t.maxSliceUs = elapsed;
+        changed = true;
+    }
+    if (elapsed > t.budgetUs)
+    {
+        t.budgetOverruns++;
+        changed = true;
+    }
+    if (t.periodUs == 0)
+        worked |= more;
+    else if (!more)
+        t.pending = false;
+
+    if (changed)
+        publish(id);
+    return end;
+}
+
+void Scheduler::resetStats()
+{
+    for (uint8_t i = 0; i < taskCount; i++)
+    {
+        Task &t = tasks[i];
+        t.deadlineMisses = 0;
+        t.budgetOverruns = 0;
+        t.maxJitterUs = 0;
+        t.maxSliceUs = 0;
+        publish(i);
+    }
+}
+
+void Scheduler::publish(uint8_t id)
+{
+    const Task &t = tasks[id];
+    uint16_t reg = ModbusInputReg::SCHED_BASE + id * REGS_PER_TASK;
+    modbusHandler->setIreg(reg, t.deadlineMisses);
+    modbusHandler->setIreg(reg + 1, t.budgetOverruns);
+    modbusHandler->setIreg(reg + 2, saturate16(t.maxJitterUs));
+    modbusHandler->setIreg(reg + 3, saturate16(t.maxSliceUs));
+}
@@ -0,0 +1,199 @@
+// SoftPWM.cpp
+#include "SoftPWM.h"
+#include "IrqMonitor.h"
+#include <avr/io.h>
+
+uint8_t SoftPWM::channelCount = 0;
+uint8_t SoftPWM::pins[SoftPWM::MAX_CHANNELS];
+volatile uint8_t *SoftPWM::ports[SoftPWM::MAX_CHANNELS];
+uint8_t SoftPWM::masks[SoftPWM::MAX_CHANNELS];
+uint16_t SoftPWM::ticks[SoftPWM::MAX_CHANNELS];
+uint8_t SoftPWM::duties[SoftPWM::MAX_CHANNELS];
+
+SoftPWM::Schedule SoftPWM::schedules[2];
+volatile uint8_t SoftPWM::activeSchedule = 0;
+volatile bool SoftPWM::schedulePending = false;
+volatile uint8_t SoftPWM::nextEdge = 0;
+
+// Period start (TCNT0 wrapped to 0)
+ISR(TIMER0_COMPA_vect)
+{
+    SoftPWM::startPeriod();
+}
+
+// Falling edge(s) due
+ISR(TIMER0_COMPB_vect)
+{
+    SoftPWM::serviceEdges();
+}
+
+void SoftPWM::initialize()
+{
+    uint8_t sreg = SREG;
+    cli();
+
+    // Normal mode, TOP = 0xFF, OC0A/OC0B disconnected. OCR0x are not
+    // double-buffered in this mode, so COMPB can be re-armed mid-period.
+    TCCR0A = 0;
+    TCCR0B = _BV(CS01) | _BV(CS00); // clk/64
+    OCR0A = 0;
+    OCR0B = 0xFF;
+    // COMPB is enabled by serviceEdges() only while an edge is armed
+    TIFR0 = _BV(OCF0A) | _BV(OCF0B);
+    TIMSK0 = (TIMSK0 & ~(_BV(TOIE0) | _BV(OCIE0B))) | _BV(OCIE0A);
+
+    SREG = sreg;
+}
+
+bool SoftPWM::attach(uint8_t pin)
+{
+    if (findChannel(pin) >= 0)
+        return true;
+    if (channelCount >= MAX_CHANNELS)
+        return false;
+
+    uint8_t port = digitalPinToPort(pin);
+    if (port == NOT_A_PORT)
+        return false;
+
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+
+    pins[channelCount] = pin;
+    ports[channelCount] = portOutputRegister(port);
+    masks[channelCount] = digitalPinToBitMask(pin);
+    ticks[channelCount] = 0;
+    duties[channelCount] = 0;
+    channelCount++;
+
+    rebuildSchedule();
+    return true;
+}
+
+bool SoftPWM::isAttached(uint8_t pin)
+{
+    return findChannel(pin) >= 0;
+}
+
+void SoftPWM::setDutyCycle(uint8_t pin, uint16_t duty)
+{
+    int8_t ch = findChannel(pin);
+    if (ch < 0)
+        return;
+
+    duty = constrain(duty, 0, 100);
+    uint16_t t = (duty * RESOLUTION + 50) / 100;
+    if (t == ticks[ch])
+        return;
+
+    duties[ch] = duty;
+    ticks[ch] = t;
+    rebuildSchedule();
+}
+
+uint16_t SoftPWM::getDuty(uint8_t pin)
+{
+    int8_t ch = findChannel(pin);
+    return ch < 0 ? 0 : duties[ch];
+}
+
+int8_t SoftPWM::findChannel(uint8_t pin)
+{
+    for (uint8_t i = 0; i < channelCount; i++)
+    {
+        if (pins[i] == pin)
+            return i;
+    }
+    return -1;
+}
+
+// Builds the next schedule off-line, then hands it to the ISR, which swaps
+// it in at the start of the following period.
+void SoftPWM::rebuildSchedule()
+{
+    Schedule s;
+    s.onCount = 0;
+    s.edgeCount = 0;
+
+    // Insertion sort by falling-edge tick; always-on channels sort last
+    for (uint8_t i = 0; i < channelCount; i++)
+    {
+        if (ticks[i] == 0)
+            continue;
+
+        uint8_t tick = ticks[i] >= RESOLUTION ? 0xFF : ticks[i];
+        bool edge = ticks[i] < RESOLUTION;
+        uint8_t j = s.onCount;
+        if (edge)
+        {
+            while (j > 0 && (j > s.edgeCount || s.tick[j - 1] > tick))
+            {
+                s.port[j] = s.port[j - 1];
+                s.mask[j] = s.mask[j - 1];
+                s.tick[j] = s.tick[j - 1];
+                j--;
+            }
+            s.edgeCount++;
+        }
+        s.port[j] = ports[i];
+        s.mask[j] = masks[i];
+        s.tick[j] = tick;
+        s.onCount++;
+    }
+
+    IrqMonitor::Critical cs(IrqMonitor::SITE_SOFT_PWM);
+    schedules[activeSchedule ^ 1] = s;
+    schedulePending = true;
+}
+
+void SoftPWM::startPeriod()
+{
+    if (schedulePending)
+    {
+        // Always-on channels of the outgoing schedule never saw a falling edge
+        const Schedule &old = schedules[activeSchedule];
+        for (uint8_t i = old.edgeCount; i < old.onCount; i++)
+            *old.port[i] &= ~old.mask[i];
+
+        activeSchedule ^= 1;
+        schedulePending = false;
+    }
+
+    const Schedule &s = schedules[activeSchedule];
+    for (uint8_t i = 0; i < s.onCount; i++)
+        *s.port[i] |= s.mask[i];
+
+    nextEdge = 0;
+    serviceEdges();
+}
+
+// Drops every pin whose edge has passed and re-arms COMPB for the next one.
+// TCNT0 is re-checked after arming so an edge that slips past while OCR0B
+// is written is handled here instead of waiting a full period. With no edge
+// left, COMPB is switched off until the next period instead of matching its
+// stale OCR0B once per period.
+void SoftPWM::serviceEdges()
+{
+    const Schedule &s = schedules[activeSchedule];
+    uint8_t i = nextEdge;
+
+    while (i < s.edgeCount)
+    {
+        uint8_t tick = s.tick[i];
+        if (TCNT0 < tick)
+        {
+            OCR0B = tick;
+            TIFR0 = _BV(OCF0B); // Match left from while COMPB was off
+            TIMSK0 |= _BV(OCIE0B);
+            if (TCNT0 < tick)
+            {
+                nextEdge = i;
+                return;
+            }
+        }
+        *s.port[i] &= ~s.mask[i];
+        i++;
+    }
+    nextEdge = i;
+    TIMSK0 &= ~_BV(OCIE0B);
+}
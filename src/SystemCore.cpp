@@ -2,6 +2,21 @@
 #include "SystemCore.h"
 #include "Config.h"
 #include "PWMController.h" // Add this line
+#include "SoftPWM.h"
+#include "DutyProfile.h"
+#include "EepromWriter.h"
+#include "Protection.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "MemoryMonitor.h"
+#include "ConfigStore.h"
+#include "History.h"
+#include "EventLog.h"
+#include "IrqMonitor.h"
+#include "Benchmark.h"
+#include "Trace.h"
+#include "TempSchedule.h"
+#include "MotorTable.h"
 
 void uint64_to_string(uint64_t n, char *buf)
 {
@@ -25,150 +40,338 @@ void uint64_to_string(uint64_t n, char *buf)
 }
 SystemCore::SystemCore()
     : modbus(Serial, SLAVE_ID),
-      airSensor(AIR_TEMP_PIN,
-                ModbusHoldingReg::AIR_TEMP_REG,
-                ModbusHoldingReg::AIR_TEMP_LIMIT),
-      waterSensor(WATER_TEMP_PIN,
-                  ModbusHoldingReg::WATER_TEMP_REG,
-                  ModbusHoldingReg::WATER_TEMP_LIMIT),
-      prev_prescaler(0)
+      airSensor(AIR_TEMP_PIN, ModbusHoldingReg::AIR_TEMP_REG),
+      waterSensor(WATER_TEMP_PIN, ModbusHoldingReg::WATER_TEMP_REG),
+      controlTaskId(-1),
+      temperatureTaskId(-1),
+      historyTaskId(-1),
+      sensorsUp(0),
+      motorCursor(0),
+      tempCursor(0),
+      telemetryCursor(0),
+      sensorsDown(0)
 {
     ::modbusHandler = &modbus;
     ::deviceManager = &deviceManager;
     ::motors = this->motors; // Update global pointer to motor array
 
-    // Initialize motor sensors with dynamic allocation
     for (uint8_t i = 0; i < NUM_MOTORS; i++)
     {
-        motorSensors[i] = new TemperatureSensor(
-            TEMP_PINS[i],
-            ModbusInputReg::TEMP_BASE + i,
-            ModbusHoldingReg::MOTOR_TEMP_CRIT);
-    }
-
-    // Initialize motors with dynamic allocation
-    for (uint8_t i = 0; i < NUM_MOTORS; i++)
-    {
-        motors[i] = new Motor(
-            i,
-            PWM_PINS[i],
-            CURRENT_PINS[i],
-            motorSensors[i], // Pass pointer to sensor
-            this->modbus);
+        motorSensors[i].attach(Board::TEMP_PINS[i], ModbusInputReg::TEMP_BASE + i);
+        motors[i].attach(i);
     }
 }
 
-SystemCore::~SystemCore()
+static uint16_t bootStageUs()
 {
-    // Clean up dynamically allocated objects
-    for (uint8_t i = 0; i < NUM_MOTORS; i++)
-    {
-        delete motorSensors[i];
-        delete motors[i];
-    }
+    uint64_t us = PWMController::microsCustom();
+    return us > 0xFFFF ? 0xFFFF : (uint16_t)us;
 }
 
+// Staged boot: outputs safe, then Modbus, then saved state, then the
+// scheduler. The 1-Wire buses (one configuration read each, the slow part)
+// are brought up afterwards by taskTemperatures, one bus per slice.
 void SystemCore::setup()
 {
-    modbus.begin();
-    Serial1.begin(250000);
+    uint8_t resetCause = MCUSR;
+    MCUSR = 0;
 
-    // Initialize sensors
-    airSensor.begin();
-    waterSensor.begin();
+    // --- Stage 1: outputs safe ---
+    // Timers first (this also starts the timebase), so every motor pin is
+    // attached to a duty-0 channel before it becomes an output
+    PWMController::initialize();
     for (uint8_t i = 0; i < NUM_MOTORS; i++)
     {
-        motorSensors[i]->begin(); // Pointer access
+        motors[i].begin();
     }
+    deviceManager.forceOff();
+    uint16_t safeUs = bootStageUs();
 
-    // Initialize motors
-    for (uint8_t i = 0; i < NUM_MOTORS; i++)
-    {
-        motors[i]->begin(); // Pointer access
-    }
+    // --- Stage 2: Modbus answering ---
+    modbus.begin();
+    EventLog::begin();
+    EventLog::log(EVT_BOOT, EventLog::NO_MOTOR, resetCause);
+    uint16_t modbusUs = bootStageUs();
 
-    PWMController::initialize();
-    // Initialize devices
+    // --- Stage 3: saved state ---
+    ConfigStore::begin(); // Saved configuration over the defaults
+    DutyProfile::begin();
+    uint16_t configUs = bootStageUs();
+
+    // --- Stage 4: services ---
+    Serial1.begin(250000);
+    modbus.setIreg(ModbusInputReg::SOFT_PWM_FREQ, SoftPWM::FREQUENCY);
+    modbus.setIreg(ModbusInputReg::SOFT_PWM_RES, SoftPWM::DUTY_STEPS);
     deviceManager.begin();
+    TempSchedule::begin();
+
+    // Polled every pass; their latency is bounded by the longest slice below
+    // (TEMP_BUDGET_US, the temperature task's 1-Wire transaction)
+    Scheduler::add(taskModbus, 0, 0, MODBUS_BUDGET_US);
+    Scheduler::add(taskProtection, 0, 1, 300);
+    Scheduler::add(taskProfile, 0, 2, 300);
+    // Periodic (period ms, priority, budget us)
+    controlTaskId = Scheduler::add(taskControl, CTRL_DEFAULT_PERIOD, 3, 2000);
+    Scheduler::add(taskMotors, 50, 4, 500);
+    Scheduler::add(taskDevices, 1000, 5, 300);
+    temperatureTaskId = Scheduler::add(taskTemperatures, TEMP_TICK_MS, 6, TEMP_BUDGET_US);
+    Scheduler::add(taskTelemetry, 5000, 7, 3000);
+    Scheduler::add(taskDiagnostics, 1000, 8, 2500);
+    historyTaskId = Scheduler::add(taskHistory, HISTORY_DEFAULT_PERIOD, 9, 500);
+    Scheduler::releaseNow(temperatureTaskId); // Sensor bring-up starts right away
+    Profiler::reset();
+
+    modbus.setIreg(ModbusInputReg::BOOT_SAFE_US, safeUs);
+    modbus.setIreg(ModbusInputReg::BOOT_MODBUS_US, modbusUs);
+    modbus.setIreg(ModbusInputReg::BOOT_CONFIG_US, configUs);
+    modbus.setIreg(ModbusInputReg::BOOT_READY_US, bootStageUs());
+    modbus.setIreg(ModbusInputReg::BOOT_RESET_CAUSE, resetCause);
+
     Serial1.println("Connection established");
 }
 
 void SystemCore::loop()
 {
-    static uint8_t currentSensor = 0;
+    uint32_t start = PWMController::cycles();
+    bool worked = Scheduler::run();
+    Profiler::loopPass(start, worked);
+}
 
-    static uint64_t lastMotorUpdate = 0;
-    static uint64_t lastTempUpdate = 0;
-    static uint64_t lastSerialUpdate = 0;
+bool SystemCore::taskModbus()
+{
+    ModbusHandler &modbus = systemCore.modbus;
     uint64_t now = PWMController::millisCustom();
 
-    modbus.setIreg(ModbusInputReg::TIME_LOW, float(now & 0xFFFF));
-    modbus.setIreg(ModbusInputReg::TIME_LOW + 1, float((now >> 16) & 0xFFFF));
+    modbus.setIreg(ModbusInputReg::TIME_LOW, uint16_t(now & 0xFFFF));
+    modbus.setIreg(ModbusInputReg::TIME_LOW + 1, uint16_t((now >> 16) & 0xFFFF));
     modbus.setIreg(ModbusInputReg::TIME_LOW + 2, uint16_t((now >> 32) & 0xFFFF));
     modbus.setIreg(ModbusInputReg::TIME_LOW + 3, uint16_t((now >> 48) & 0xFFFF));
 
-    modbus.task();
+    {
+        Profiler::Scope probe(Profiler::PROBE_MODBUS);
+        Benchmark::Scope bench(Benchmark::MODBUS_TASK);
+        return modbus.task();
+    }
+}
+
+bool SystemCore::taskProtection()
+{
+    Protection::evaluate();
+    return false;
+}
 
-    if (now - lastSerialUpdate >= 5000)
+bool SystemCore::taskProfile()
+{
+    EepromWriter::service();
+    DutyProfile::poll();
+    ConfigStore::service();
+    return false;
+}
+
+// Closed-loop control; CTRL_PERIOD = 0 parks the controllers. Parked motors
+// drop back to open loop so DUTY writes apply again; CTRL_MODE takes them
+// back (with a PID reset) once a period is set.
+bool SystemCore::taskControl()
+{
+    SystemCore &core = systemCore;
+    uint16_t period = core.modbus.getHreg(ModbusHoldingReg::CTRL_PERIOD);
+    Scheduler::setPeriod(core.controlTaskId, period ? period : 100);
+    if (period)
+        core.runControl();
+    else
     {
-        Serial1.println("\n\n\n\n=== MOTORS REGISTERS ===");
-        for (uint8_t i = 0; i < NUM_MOTORS; i++) {
-            Serial1.print("Motor ");
-            Serial1.print(i);
-            Serial1.print(" // DUTY: ");
-            Serial1.print(motors[i]->getDuty());
-            Serial1.print(" TEMP: ");
-            Serial1.print(motors[i]->getTemp());
-            Serial1.print(" CURRENT: ");
-            Serial1.print(motors[i]->getCurr());
-            Serial1.println();
-        }
-        Serial1.println("=== SYSTEM REGISTERS ===");
-        Serial1.print("START_REG_ADDR: ");
-        Serial1.println(modbus.getHreg(ModbusHoldingReg::START_REG_ADDR));
+        for (uint8_t i = 0; i < NUM_MOTORS; i++)
+            core.motors[i].setClosedLoop(false);
+    }
+    return false;
+}
 
-        lastSerialUpdate = now;
+// Current sampling and temperature registers, three motors per slice. Sample
+// times and the thermal model's dt run on uptime, so a START does not
+// stall sampling or cut a model step.
+bool SystemCore::taskMotors()
+{
+    SystemCore &core = systemCore;
+    uint64_t now = PWMController::uptimeMillis();
+
+    for (uint8_t n = 0; n < 3 && core.motorCursor < NUM_MOTORS; n++)
+    {
+        Profiler::Scope probe(Profiler::PROBE_MOTOR);
+        core.motors[core.motorCursor++].update(now);
     }
 
-    // Update motor status every 500ms
-    if (now - lastMotorUpdate >= 500)
+    if (core.motorCursor < NUM_MOTORS)
+        return true;
+    core.motorCursor = 0;
+    return false;
+}
+
+TemperatureSensor &SystemCore::sensorAt(uint8_t i)
+{
+    if (i < NUM_MOTORS)
+        return motorSensors[i];
+    return i == NUM_MOTORS ? airSensor : waterSensor;
+}
+
+// Walks the 15 motor sensors, then air and water, spending one slice per
+// bus that has work due (a conversion to start or to read); sensors with
+// nothing due, or still converting, are skipped within the slice. Each reading re-rates the
+// sensor's period and resolution (TempSchedule). The first job after boot
+// brings the buses up instead.
+bool SystemCore::taskTemperatures()
+{
+    SystemCore &core = systemCore;
+    Profiler::Scope probe(Profiler::PROBE_TEMPERATURE);
+
+    if (core.sensorsUp < NUM_MOTORS + 2)
     {
-        lastMotorUpdate = now;
-        for (uint8_t i = 0; i < NUM_MOTORS; i += 3)
-        { // Process 2 motors per cycle
-            if (i < NUM_MOTORS)
-                motors[i]->update(now);
-            if (i + 1 < NUM_MOTORS)
-                motors[i + 1]->update(now);
-            if (i + 2 < NUM_MOTORS)
-                motors[i + 2]->update(now);
-            modbus.task(); // Handle Modbus between batches
-        }
+        core.sensorAt(core.sensorsUp++).begin();
+        if (core.sensorsUp < NUM_MOTORS + 2)
+            return true;
+
+        uint64_t ms = PWMController::uptimeMillis();
+        core.modbus.setIreg(ModbusInputReg::BOOT_SENSORS_MS, ms > 0xFFFF ? 0xFFFF : (uint16_t)ms);
+        return false;
     }
 
-    // Update temperature and devices every 1000ms
-    if (now - lastTempUpdate >= 1000)
+    // Conversion and rate timing on uptime: a START mid-conversion must not
+    // make it look 0 ms old
+    uint32_t now = (uint32_t)PWMController::uptimeMillis();
+    while (core.tempCursor < NUM_MOTORS + 2)
     {
-        lastTempUpdate = now;
+        uint8_t i = core.tempCursor++;
+        TemperatureSensor &sensor = core.sensorAt(i);
+        TemperatureSensor::Step step = sensor.service(now);
+        if (step == TemperatureSensor::STEP_IDLE || step == TemperatureSensor::STEP_BUSY)
+            continue;
+        if (step == TemperatureSensor::STEP_READ)
+            core.rescheduleSensor(i);
+        if (core.tempCursor < NUM_MOTORS + 2)
+            return true;
+    }
+    core.tempCursor = 0;
+    return false;
+}
 
-        // Request temperatures first
-        for (uint8_t i = 0; i < NUM_MOTORS; i++)
-        {
-            motorSensors[i]->requestTemperaturesAsync(now); // Pointer access
-        }
+void SystemCore::rescheduleSensor(uint8_t i)
+{
+    TemperatureSensor &sensor = sensorAt(i);
+    bool connected = sensor.getStatus() != 3;
+    uint32_t bit = 1UL << i;
+    if (connected == ((sensorsDown & bit) != 0))
+    {
+        sensorsDown ^= bit;
+        if (connected)
+            EventLog::log(EVT_SENSOR_RESTORED, i, (uint16_t)sensor.getTemperature());
+        else
+            EventLog::log(ERR_SENSOR_DISCONNECTED, i);
+    }
+    int16_t limit;
+    uint8_t duty = 0;
 
-        // Then update all temperature readings
-        for (uint8_t i = 0; i < NUM_MOTORS; i++)
-        {
-            motorSensors[i]->update(); // Pointer access
-        }
+    if (i < NUM_MOTORS)
+    {
+        Protection::setTemperature(i, sensor.getTemperature(), connected);
+        limit = TEMP_WARNING;
+        duty = motorTable.outputDuty[i];
+    }
+    else
+        limit = (int16_t)modbus.getHreg(i == NUM_MOTORS ? ModbusHoldingReg::AIR_TEMP_LIMIT
+                                                        : ModbusHoldingReg::WATER_TEMP_LIMIT);
+
+    TempSchedule::Setting s = TempSchedule::update(i, sensor.getTemperature(), sensor.getRate(),
+                                                   limit, duty, connected);
+    sensor.setSchedule(s.periodMs, s.resolution);
+}
+
+bool SystemCore::taskDevices()
+{
+    SystemCore &core = systemCore;
+    Profiler::Scope probe(Profiler::PROBE_DEVICES);
+    core.deviceManager.update(core.airSensor, core.waterSensor);
+    return false;
+}
+
+// History sample; HISTORY_PERIOD = 0 pauses recording
+bool SystemCore::taskHistory()
+{
+    uint16_t period = systemCore.modbus.getHreg(ModbusHoldingReg::HISTORY_PERIOD);
+    Scheduler::setPeriod(systemCore.historyTaskId, period ? period : 1000);
+    if (period)
+        History::sample();
+    return false;
+}
+
+bool SystemCore::taskDiagnostics()
+{
+    Profiler::publish();
+    MemoryMonitor::update();
+    IrqMonitor::publish();
+    return false;
+}
 
-        airSensor.update();
-        waterSensor.update();
+// Serial1 dump, one motor line per slice
+bool SystemCore::taskTelemetry()
+{
+    if (Trace::active())
+        return false; // Serial1 carries the binary trace
 
-        // Update devices (pass pointer to motor array)
-        deviceManager.update(airSensor, waterSensor, motors);
+    SystemCore &core = systemCore;
+    uint8_t line = core.telemetryCursor++;
+    Profiler::Scope probe(Profiler::PROBE_TELEMETRY);
 
-        // Update timestamp register
+    if (line == 0)
+    {
+        Serial1.println("\n\n\n\n=== MOTORS REGISTERS ===");
+    }
+    else if (line <= NUM_MOTORS)
+    {
+        const Motor *motor = &core.motors[line - 1];
+        Serial1.print("Motor ");
+        Serial1.print(line - 1);
+        Serial1.print(" // DUTY: ");
+        Serial1.print(motor->getDuty());
+        Serial1.print(" TEMP: ");
+        Serial1.print(motor->getTemp());
+        Serial1.print(" CURRENT: ");
+        Serial1.print(motor->getCurr());
+        Serial1.println();
+    }
+    else
+    {
+        Serial1.println("=== SYSTEM REGISTERS ===");
+        Serial1.print("START_REG_ADDR: ");
+        Serial1.println(core.modbus.getHreg(ModbusHoldingReg::START_REG_ADDR));
+        Serial1.print("RAM free: ");
+        Serial1.print(MemoryMonitor::freeRam());
+        Serial1.print(" stack peak: ");
+        Serial1.print(MemoryMonitor::stackPeak());
+        Serial1.print(" min headroom: ");
+        Serial1.print(MemoryMonitor::minHeadroom());
+        Serial1.print(" heap: ");
+        Serial1.print(MemoryMonitor::heapUsed());
+        Serial1.print(" static: ");
+        Serial1.println(MemoryMonitor::staticRam());
+        core.telemetryCursor = 0;
+        return false;
+    }
+    return true;
+}
+
+void SystemCore::runControl()
+{
+    PIDController::Gains gains;
+    gains.kp = modbus.getHreg(ModbusHoldingReg::CTRL_KP);
+    gains.ki = PIDController::stepGain(modbus.getHreg(ModbusHoldingReg::CTRL_KI),
+                                       modbus.getHreg(ModbusHoldingReg::CTRL_PERIOD));
+    gains.kd = modbus.getHreg(ModbusHoldingReg::CTRL_KD);
+    uint16_t mode = modbus.getHreg(ModbusHoldingReg::CTRL_MODE);
+
+    for (uint8_t i = 0; i < NUM_MOTORS; i++)
+    {
+        bool closed = mode & (1U << i);
+        motors[i].setClosedLoop(closed);
+        if (closed)
+            motors[i].control(modbus.getHreg(ModbusHoldingReg::CTRL_SETPOINT_BASE + i), gains);
     }
 }
\ No newline at end of file
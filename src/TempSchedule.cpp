@@ -0,0 +1,53 @@
+#include "TempSchedule.h"
+#include "ModbusHandler.h"
+#include "Globals.h"
+
+const TempSchedule::Setting TempSchedule::SETTINGS[4] = {
+    {4000, 9},
+    {1000, 10},
+    {500, 10},
+    {400, 11},
+};
+
+uint8_t TempSchedule::tiers[TempSchedule::SENSORS];
+
+uint16_t TempSchedule::regOffset(uint8_t i)
+{
+    return i < NUM_MOTORS ? i : MAX_MOTORS + (i - NUM_MOTORS);
+}
+
+void TempSchedule::begin()
+{
+    for (uint8_t i = 0; i < SENSORS; i++)
+    {
+        tiers[i] = TIER_NORMAL;
+        modbusHandler->setIreg(ModbusInputReg::TEMP_TIER_BASE + regOffset(i), TIER_NORMAL);
+        modbusHandler->setIreg(ModbusInputReg::TEMP_RATE_BASE + regOffset(i), 0);
+    }
+}
+
+TempSchedule::Setting TempSchedule::update(uint8_t i, int16_t centiC, int16_t ratePerS,
+                                           int16_t limit, uint8_t duty, bool connected)
+{
+    uint8_t want;
+    int32_t headroom = (int32_t)limit - centiC;
+
+    if (!connected)
+        want = TIER_NORMAL; // Keep looking for the sensor at the normal pace
+    else if (headroom <= HOT_HEADROOM || ratePerS >= HOT_RATE)
+        want = TIER_HOT;
+    else if (headroom <= ACTIVE_HEADROOM || ratePerS >= ACTIVE_RATE || duty >= ACTIVE_DUTY)
+        want = TIER_ACTIVE;
+    else if (duty == 0 && ratePerS <= STABLE_RATE && ratePerS >= -STABLE_RATE)
+        want = TIER_IDLE;
+    else
+        want = TIER_NORMAL;
+
+    if (want + 1 < tiers[i])
+        want = tiers[i] - 1;
+    tiers[i] = want;
+
+    modbusHandler->setIreg(ModbusInputReg::TEMP_TIER_BASE + regOffset(i), want);
+    modbusHandler->setIreg(ModbusInputReg::TEMP_RATE_BASE + regOffset(i), (uint16_t)ratePerS);
+    return SETTINGS[want];
+}
@@ -2,79 +2,201 @@
 #include "ModbusHandler.h"
 #include "Config.h"
 #include "Globals.h"
+#include "Trace.h"
 
 // Constructor: initializes sensor objects and register mappings
-TemperatureSensor::TemperatureSensor(uint8_t pin, uint16_t tempReg,
-                                     uint16_t tempLimit)
+TemperatureSensor::TemperatureSensor(uint8_t pin, uint16_t tempReg)
     : oneWire(pin),     // Initialize OneWire bus on specified pin
       sensor(&oneWire), // Bind DallasTemperature instance to OneWire bus
       regTemp(tempReg), // Register for current temperature value
-      limitTemp(tempLimit),
       temperature(0), // Initialize temperature to 0
-      status(0)
+      status(0),
+      lastRequestTime(0),
+      conversionPending(false),
+      periodMs(1000),
+      resolution(RESOLUTION),
+      convResolution(RESOLUTION),
+      alarmHigh(0),
+      alarmLow(0),
+      rate(0),
+      lastSampleTime(0),
+      hasSample(false)
 {
 } // Initial status: normal
 
-// Initializes the temperature sensor hardware
+TemperatureSensor::TemperatureSensor()
+    : regTemp(0),
+      temperature(0),
+      status(0),
+      lastRequestTime(0),
+      conversionPending(false),
+      periodMs(1000),
+      resolution(RESOLUTION),
+      convResolution(RESOLUTION),
+      alarmHigh(0),
+      alarmLow(0),
+      rate(0),
+      lastSampleTime(0),
+      hasSample(false)
+{
+}
+
+void TemperatureSensor::attach(uint8_t pin, uint16_t tempReg)
+{
+    oneWire.begin(pin);
+    sensor.setOneWire(&oneWire);
+    regTemp = tempReg;
+}
+
+// Brings the sensor up with a single scratchpad read (about 7 ms of bus
+// time). There is no bus search: each pin carries one sensor, addressed
+// with Skip ROM. The read learns the stored TH/TL and resolution, so the
+// first conversion is timed right and service() writes RESOLUTION only if
+// the sensor holds something else. A missing sensor is picked up by the
+// normal reads once it answers.
 void TemperatureSensor::begin()
 {
-    sensor.begin();           // Initialize DallasTemperature library
-    sensor.setResolution(10); // Set sensor resolution (11 bits = 0.125°C precision)
     sensor.setWaitForConversion(false);
+
+    ScratchPad scratch;
+    if (readScratchPad(scratch))
+        learnConfig(scratch);
 }
 
-void TemperatureSensor::requestTemperatures(uint64_t now)
+// DS18B20 conversion time: 750 ms at 12 bits, halving per bit less
+// (93.75 ms at 9 bits, rounded up)
+static uint16_t conversionMs(uint8_t resolution)
 {
-    if (now - lastTemperatureRequest > 1000)
-    {
-        sensor.requestTemperatures(); // Trigger temperature reading from DS18B20
-        lastTemperatureRequest = now;
-    }
+    uint8_t shift = 12 - resolution;
+    return (750 + (1 << shift) - 1) >> shift;
 }
 
-void TemperatureSensor::requestTemperaturesAsync(uint64_t now)
+TemperatureSensor::Step TemperatureSensor::service(uint32_t nowMs)
 {
-    if (!conversionPending && (now - lastRequestTime > 1000))
+    if (conversionPending)
     {
-        sensor.requestTemperatures();
-        conversionPending = true;
-        lastRequestTime = now;
+        uint32_t elapsed = nowMs - lastRequestTime;
+        if (elapsed < conversionMs(convResolution))
+            return STEP_IDLE;
+        // A slow sensor is asked again on a later tick; past twice its
+        // conversion time it is read anyway, so a stuck bus shows up as
+        // disconnected instead of pending forever
+        if (elapsed < 2UL * conversionMs(convResolution) && !sensor.isConversionComplete())
+            return STEP_BUSY;
+        update();
+        return STEP_READ;
     }
+
+    if (nowMs - lastRequestTime < periodMs)
+        return STEP_IDLE;
+
+    // Config write only when the tier changed the resolution; the next read
+    // shows whether it took
+    if (resolution != convResolution)
+    {
+        writeConfig(resolution);
+        convResolution = resolution;
+    }
+
+    sensor.requestTemperatures();
+    conversionPending = true;
+    lastRequestTime = nowMs;
+    return STEP_REQUEST;
 }
 
-bool TemperatureSensor::isConversionComplete()
+// Saves the Match ROM's 8 address bytes on every transaction (about 4.5 ms
+// of bus time) compared with DallasTemperature's addressed calls
+bool TemperatureSensor::readScratchPad(uint8_t *scratch)
 {
-    if (conversionPending)
+    if (!oneWire.reset())
+        return false; // No presence pulse
+    oneWire.skip();
+    oneWire.write(0xBE);
+
+    bool zeros = true;
+    for (uint8_t i = 0; i < 9; i++)
     {
-        conversionPending = !sensor.isConversionComplete();
-        return !conversionPending;
+        scratch[i] = oneWire.read();
+        zeros &= scratch[i] == 0;
     }
-    return false;
+    return !zeros && OneWire::crc8(scratch, 8) == scratch[8];
+}
+
+// Resolution the sensor converts at and its TH/TL bytes, which a
+// configuration write has to carry over
+void TemperatureSensor::learnConfig(const uint8_t *scratch)
+{
+    convResolution = 9 + ((scratch[4] >> 5) & 0x03);
+    alarmHigh = scratch[2];
+    alarmLow = scratch[3];
+}
+
+void TemperatureSensor::writeConfig(uint8_t bits)
+{
+    oneWire.reset();
+    oneWire.skip();
+    oneWire.write(0x4E);
+    oneWire.write(alarmHigh);
+    oneWire.write(alarmLow);
+    oneWire.write(((bits - 9) << 5) | 0x1F);
 }
 
-// Reads temperature, checks thresholds, and updates Modbus registers
+void TemperatureSensor::setSchedule(uint16_t period, uint8_t bits)
+{
+    periodMs = period;
+    resolution = bits;
+}
+
+// Reads a finished conversion straight from the scratchpad and publishes it;
+// service() has checked that it is finished.
+// The raw count is 1/16 °C (bits below the resolution are undefined and masked),
+// so 1/100 °C = raw * 100 / 16 = raw * 25 / 4, in integers.
 void TemperatureSensor::update()
 {
-    float tempC = sensor.getTempCByIndex(0); // Read the first sensor on the bus
-    if (conversionPending && sensor.isConversionComplete())
+    if (!conversionPending)
+        return;
+    conversionPending = false;
+    uint32_t sampleTime = lastRequestTime;
+
+    ScratchPad scratch;
+    if (readScratchPad(scratch))
     {
-        temperature = tempC;
-        // Serial1.println(tempC);
-
-        // Write temperature to input register (read-only from master perspective)
-        modbusHandler->setIreg(regTemp, tempC);
-        // Note: If temperature is negative, casting to uint16_t will wrap around,
-        // which may need special handling on Modbus master side.
-        conversionPending = false;
+        // Resolution the conversion actually ran at (a replaced sensor
+        // starts at its stored default)
+        learnConfig(scratch);
+
+        int16_t raw = (int16_t)(scratch[1] << 8 | scratch[0]);
+        raw &= ~((1 << (12 - convResolution)) - 1);
+        int16_t centiC = (int16_t)(((int32_t)raw * 25) >> 2);
+
+        // Rate over the last two samples, smoothed 1/4 so one resolution
+        // step at 9 bits (0.5 °C) does not read as a trend
+        uint32_t dt = sampleTime - lastSampleTime;
+        if (hasSample && dt > 0)
+        {
+            int32_t instant = ((int32_t)centiC - temperature) * 1000 / (int32_t)dt;
+            rate += (int16_t)((constrain(instant, -32000L, 32000L) - rate) / 4);
+        }
+        hasSample = true;
+        lastSampleTime = sampleTime;
+
+        temperature = centiC;
+        status = 0;
+        modbusHandler->setIreg(regTemp, (uint16_t)temperature);
+        Trace::temperature(regTemp, raw);
     }
-    else if (tempC == DEVICE_DISCONNECTED_C)
+    else
     {
-        modbusHandler->setIreg(regTemp, 999.0);
-        temperature = 999.0;
+        hasSample = false;
+        rate = 0;
+        temperature = TEMP_REG_DISCONNECTED;
+        status = 3;
+        modbusHandler->setIreg(regTemp, (uint16_t)TEMP_REG_DISCONNECTED);
+        Trace::temperature(regTemp, Trace::TEMP_DISCONNECTED);
     }
 }
 
-// Getter: returns raw centi-degree temperature value (can be negative)
+// Getter: returns the centi-degree temperature (can be negative)
 // int16_t TemperatureSensor::getTemperature() const {
 //     if (temperature < 0) {
 //         return 0;
@@ -0,0 +1,48 @@
+#include "ThermalModel.h"
+#include "ModbusHandler.h"
+#include "Globals.h"
+
+// (I / REF_CURRENT) in Q8 is I * Q8_PER_MA >> 16, without a division
+static constexpr uint32_t Q8_PER_MA = (256UL << 16) / ThermalModel::REF_CURRENT;
+
+void ThermalModel::update(uint8_t id, uint16_t nowMs)
+{
+    MotorTable &t = motorTable;
+    uint16_t dt = nowMs - t.lastModel[id];
+    t.lastModel[id] = nowMs;
+    if (dt > MAX_STEP)
+        dt = MAX_STEP;
+
+    // Steady-state rise at this current; the ratio is capped at 4x so the
+    // square stays in 32 bits
+    uint32_t ratio = (t.current[id] * Q8_PER_MA) >> 16;
+    if (ratio > 1023)
+        ratio = 1023;
+    uint32_t target = (((ratio * ratio) >> 8) * modbusHandler->getHreg(ModbusHoldingReg::THERMAL_RISE)) >> 8;
+    if (target > (uint32_t)MAX_RISE)
+        target = MAX_RISE;
+
+    int16_t rise = t.windingRise[id];
+    int32_t tauMs = (int32_t)modbusHandler->getHreg(ModbusHoldingReg::THERMAL_TAU_BASE + id) * 1000;
+    if (tauMs == 0)
+    {
+        rise = (int16_t)target; // No thermal mass: follows the current at once
+        t.riseRemainder[id] = 0;
+    }
+    else
+    {
+        // dt <= MAX_STEP <= tau, so a step never overshoots the target
+        int32_t acc = t.riseRemainder[id] + ((int32_t)target - rise) * dt;
+        if (acc >= tauMs || acc <= -tauMs)
+        {
+            int16_t step = (int16_t)(acc / tauMs);
+            rise += step;
+            acc -= (int32_t)step * tauMs;
+        }
+        t.riseRemainder[id] = acc;
+    }
+    t.windingRise[id] = rise;
+
+    int16_t est = (t.sensorFault & (1U << id)) ? TEMP_REG_DISCONNECTED : estimate(id);
+    modbusHandler->setIreg(ModbusInputReg::WINDING_TEMP_BASE + id, (uint16_t)est);
+}
@@ -0,0 +1,218 @@
+#include "Trace.h"
+#include "ModbusHandler.h"
+#include "PWMController.h"
+#include "Globals.h"
+#include <util/crc16.h>
+
+bool Trace::enabled = false;
+uint32_t Trace::lastUs = 0;
+uint32_t Trace::prevUs = 0;
+uint16_t Trace::dropped = 0;
+uint16_t Trace::droppedTotal = 0;
+uint16_t Trace::records = 0;
+uint8_t Trace::type = 0;
+uint8_t Trace::length = 0;
+uint8_t Trace::payload[Trace::MAX_PAYLOAD];
+uint16_t Trace::shadow[HOLDING_REG_COUNT];
+uint8_t Trace::lastOutput[NUM_MOTORS];
+
+void Trace::setEnabled(bool on)
+{
+    if (on == enabled)
+        return;
+    enabled = on;
+    if (!on)
+        return;
+
+    lastUs = (uint32_t)PWMController::microsCustom();
+    dropped = 0;
+    droppedTotal = 0;
+    records = 0;
+    modbusHandler->setIreg(ModbusInputReg::TRACE_RECORDS, 0);
+    modbusHandler->setIreg(ModbusInputReg::TRACE_DROPPED, 0);
+    memset(lastOutput, 0xFF, sizeof(lastOutput));
+
+    // Register image in chunks; blocks on the UART, but only once per capture
+    for (uint8_t reg = 0; reg < HOLDING_REG_COUNT;)
+    {
+        open(REC_BEGIN);
+        put(reg);
+        while (reg < HOLDING_REG_COUNT && length + 3 <= MAX_PAYLOAD)
+        {
+            shadow[reg] = modbusHandler->getHreg(reg);
+            putVarint(shadow[reg]);
+            reg++;
+        }
+        close(true);
+    }
+}
+
+void Trace::request()
+{
+    if (!enabled)
+        return;
+
+    bool changed = false;
+    open(REC_WRITE);
+    for (uint8_t reg = 0; reg < HOLDING_REG_COUNT; reg++)
+    {
+        uint16_t value = modbusHandler->getHreg(reg);
+        if (value == shadow[reg])
+            continue;
+        shadow[reg] = value;
+
+        if (length + 4 > MAX_PAYLOAD)
+        {
+            type = REC_WRITE_MORE;
+            close(false);
+            open(REC_WRITE);
+        }
+        put(reg);
+        putVarint(value);
+        changed = true;
+    }
+
+    if (!changed)
+        type = REC_POLL;
+    close(false);
+}
+
+void Trace::noteHreg(uint16_t addr, uint16_t value)
+{
+    if (enabled && addr < HOLDING_REG_COUNT)
+        shadow[addr] = value;
+}
+
+void Trace::adc(uint8_t motor, uint16_t raw)
+{
+    if (!enabled)
+        return;
+    open(REC_ADC);
+    put(motor);
+    putU16(raw);
+    close(false);
+}
+
+void Trace::temperature(uint16_t reg, int16_t raw16)
+{
+    if (!enabled)
+        return;
+    open(REC_TEMP);
+    put(reg);
+    putU16(raw16);
+    close(false);
+}
+
+void Trace::output(uint8_t motor, uint8_t duty)
+{
+    if (!enabled || lastOutput[motor] == duty)
+        return;
+    lastOutput[motor] = duty;
+    open(REC_OUTPUT);
+    put(motor);
+    put(duty);
+    close(false);
+}
+
+void Trace::status(uint8_t motor, uint8_t status)
+{
+    if (!enabled)
+        return;
+    open(REC_STATUS);
+    put(motor);
+    put(status);
+    close(false);
+}
+
+void Trace::devices(uint8_t mask)
+{
+    if (!enabled)
+        return;
+    open(REC_DEVICES);
+    put(mask);
+    close(false);
+}
+
+void Trace::open(uint8_t recordType)
+{
+    uint32_t now = (uint32_t)PWMController::microsCustom();
+    prevUs = lastUs;
+    lastUs = now;
+
+    type = recordType;
+    length = 0;
+    putVarint(now >= prevUs ? now - prevUs : now); // START restarts the timebase
+}
+
+void Trace::putVarint(uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        put((uint8_t)v | 0x80);
+        v >>= 7;
+    }
+    put((uint8_t)v);
+}
+
+void Trace::putU16(uint16_t v)
+{
+    put(v & 0xFF);
+    put(v >> 8);
+}
+
+static void writeFrame(uint8_t type, const uint8_t *payload, uint8_t length)
+{
+    uint8_t crc = _crc_ibutton_update(0, type);
+    crc = _crc_ibutton_update(crc, length);
+    for (uint8_t i = 0; i < length; i++)
+        crc = _crc_ibutton_update(crc, payload[i]);
+
+    Serial1.write(Trace::SYNC);
+    Serial1.write(type);
+    Serial1.write(length);
+    Serial1.write(payload, length);
+    Serial1.write(crc);
+}
+
+// Writes the record if the TX buffer can take it without blocking (or
+// `block` is set); otherwise counts it as dropped and rewinds the clock so
+// the next record's delta still covers the gap.
+bool Trace::close(bool block)
+{
+    uint8_t lost[4] = {0};
+    uint8_t lostLength = 0;
+    if (dropped)
+    {
+        // dt 0, then the count; sent ahead of this record
+        uint16_t n = dropped;
+        lost[lostLength++] = 0;
+        while (n >= 0x80)
+        {
+            lost[lostLength++] = (uint8_t)n | 0x80;
+            n >>= 7;
+        }
+        lost[lostLength++] = (uint8_t)n;
+    }
+
+    int need = length + 4 + (dropped ? lostLength + 4 : 0);
+    if (!block && Serial1.availableForWrite() < need)
+    {
+        if (dropped != 0xFFFF)
+            dropped++;
+        if (droppedTotal != 0xFFFF)
+            droppedTotal++;
+        lastUs = prevUs;
+        modbusHandler->setIreg(ModbusInputReg::TRACE_DROPPED, droppedTotal);
+        return false;
+    }
+
+    if (dropped)
+    {
+        writeFrame(REC_DROPPED, lost, lostLength);
+        dropped = 0;
+    }
+    writeFrame(type, payload, length);
+    records++;
+    modbusHandler->setIreg(ModbusInputReg::TRACE_RECORDS, records);
+    return true;
+}
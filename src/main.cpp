@@ -3,6 +3,7 @@
 #include <SystemCore.h>
 #include "Config.h"
 #include <avr/wdt.h>
+#include "Benchmark.h"
 
 SystemCore systemCore;
 
@@ -13,5 +14,9 @@ void setup() {
 
 void loop() {
   // wdt_enable(WDTO_2S);
+#if defined(BENCHMARK)
+  Benchmark::loop(systemCore);
+#else
   systemCore.loop();
+#endif
 }
\ No newline at end of file
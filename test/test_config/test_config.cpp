@@ -0,0 +1,203 @@
+// ConfigStore against the simulated EEPROM: save and restore, slot
+// rotation, CRC rejection of a damaged record, commits queued behind a save
+#include <unity.h>
+#include <avr/eeprom.h>
+#include "ModbusHandler.h"
+#include "Globals.h"
+#include "ConfigStore.h"
+#include "EepromWriter.h"
+#include "SimKernel.h"
+
+// Leading fields of a stored record
+struct SlotHeader
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;
+    uint32_t sequence;
+};
+
+static constexpr uint16_t CONFIG_MAGIC = 0x4346;
+static constexpr uint16_t VALUES_OFFSET = sizeof(SlotHeader);
+
+static uint16_t slotAddress(uint8_t slot)
+{
+    return EEPROM_CONFIG_ADDR + (uint16_t)slot * ConfigStore::SLOT_SIZE;
+}
+
+static SlotHeader readHeader(uint8_t slot)
+{
+    SlotHeader h;
+    eeprom_read_block(&h, reinterpret_cast<const void *>(slotAddress(slot)), sizeof(h));
+    return h;
+}
+
+// Slot whose record carries `sequence`, or -1
+static int8_t slotWithSequence(uint32_t sequence)
+{
+    int8_t found = -1;
+    for (uint8_t s = 0; s < EEPROM_CONFIG_SLOTS; s++)
+    {
+        SlotHeader h = readHeader(s);
+        if (h.magic == CONFIG_MAGIC && h.sequence == sequence)
+        {
+            TEST_ASSERT_EQUAL_INT(-1, found); // Only one slot per sequence
+            found = s;
+        }
+    }
+    return found;
+}
+
+static uint16_t hreg(uint16_t reg)
+{
+    return modbusHandler->getHreg(reg);
+}
+
+static uint16_t ireg(uint16_t reg)
+{
+    return modbusHandler->getIreg(reg);
+}
+
+// Runs the store and the writer as the loop would until the commit register
+// reads 0 again
+static void commit()
+{
+    modbusHandler->setHreg(ModbusHoldingReg::CONFIG_COMMIT, 1);
+    ConfigStore::requestCommit(1);
+    for (uint16_t i = 0; i < 2000 && hreg(ModbusHoldingReg::CONFIG_COMMIT) != 0; i++)
+    {
+        ConfigStore::service();
+        EepromWriter::service();
+        Sim::advance(1000UL * Sim::CYCLES_PER_US);
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, hreg(ModbusHoldingReg::CONFIG_COMMIT));
+}
+
+static uint16_t limit = 100;
+
+static void changeSetting()
+{
+    modbusHandler->setHreg(ModbusHoldingReg::AIR_TEMP_LIMIT, ++limit);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_save_and_restore()
+{
+    changeSetting();
+    uint16_t saved = limit;
+    uint16_t sequence = ireg(ModbusInputReg::CONFIG_SEQUENCE);
+    commit();
+    TEST_ASSERT_EQUAL_UINT16(ConfigStore::SAVED, ireg(ModbusInputReg::CONFIG_STATUS));
+    TEST_ASSERT_EQUAL_UINT16(sequence + 1, ireg(ModbusInputReg::CONFIG_SEQUENCE));
+
+    modbusHandler->setHreg(ModbusHoldingReg::AIR_TEMP_LIMIT, 0);
+    ConfigStore::begin();
+    TEST_ASSERT_EQUAL_UINT16(ConfigStore::RESTORED, ireg(ModbusInputReg::CONFIG_STATUS));
+    TEST_ASSERT_EQUAL_UINT16(saved, hreg(ModbusHoldingReg::AIR_TEMP_LIMIT));
+}
+
+void test_unchanged_commit_skips_write()
+{
+    changeSetting();
+    commit();
+    uint16_t sequence = ireg(ModbusInputReg::CONFIG_SEQUENCE);
+    commit();
+    TEST_ASSERT_EQUAL_UINT16(sequence, ireg(ModbusInputReg::CONFIG_SEQUENCE));
+}
+
+void test_slots_rotate()
+{
+    changeSetting();
+    commit();
+    uint32_t sequence = ireg(ModbusInputReg::CONFIG_SEQUENCE);
+    int8_t slot = slotWithSequence(sequence);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, slot);
+
+    // Every save lands in the next slot and leaves the previous record intact
+    for (uint8_t i = 0; i < 2 * EEPROM_CONFIG_SLOTS; i++)
+    {
+        changeSetting();
+        commit();
+        int8_t next = slotWithSequence(sequence + 1);
+        TEST_ASSERT_EQUAL_INT((slot + 1) % EEPROM_CONFIG_SLOTS, next);
+        TEST_ASSERT_EQUAL_INT(slot, slotWithSequence(sequence));
+        slot = next;
+        sequence++;
+    }
+}
+
+void test_crc_rejects_damaged_record()
+{
+    changeSetting();
+    commit();
+    uint16_t older = limit;
+    changeSetting();
+    commit();
+    uint32_t sequence = ireg(ModbusInputReg::CONFIG_SEQUENCE);
+    int8_t slot = slotWithSequence(sequence);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, slot);
+
+    // Flip one value bit in the newest record; the older one must win
+    uint8_t *cell = reinterpret_cast<uint8_t *>(slotAddress(slot) + VALUES_OFFSET);
+    eeprom_write_byte(cell, eeprom_read_byte(cell) ^ 0x01);
+
+    ConfigStore::begin();
+    TEST_ASSERT_EQUAL_UINT16(ConfigStore::RESTORED, ireg(ModbusInputReg::CONFIG_STATUS));
+    TEST_ASSERT_EQUAL_UINT16(sequence - 1, ireg(ModbusInputReg::CONFIG_SEQUENCE));
+    TEST_ASSERT_EQUAL_UINT16(older, hreg(ModbusHoldingReg::AIR_TEMP_LIMIT));
+
+    // The next save reuses the damaged slot
+    changeSetting();
+    commit();
+    TEST_ASSERT_EQUAL_INT(slot, slotWithSequence(sequence));
+}
+
+void test_commit_during_save_is_queued()
+{
+    uint16_t sequence = ireg(ModbusInputReg::CONFIG_SEQUENCE);
+    changeSetting();
+    modbusHandler->setHreg(ModbusHoldingReg::CONFIG_COMMIT, 1);
+    ConfigStore::requestCommit(1);
+    ConfigStore::service();
+    TEST_ASSERT_EQUAL_UINT16(ConfigStore::SAVING, ireg(ModbusInputReg::CONFIG_STATUS));
+
+    // Second commit arrives while the first record is still being written
+    changeSetting();
+    commit();
+    TEST_ASSERT_EQUAL_UINT16(sequence + 2, ireg(ModbusInputReg::CONFIG_SEQUENCE));
+
+    uint16_t saved = limit;
+    modbusHandler->setHreg(ModbusHoldingReg::AIR_TEMP_LIMIT, 0);
+    ConfigStore::begin();
+    TEST_ASSERT_EQUAL_UINT16(saved, hreg(ModbusHoldingReg::AIR_TEMP_LIMIT));
+}
+
+void test_unknown_command_rejected()
+{
+    modbusHandler->setHreg(ModbusHoldingReg::CONFIG_COMMIT, 7);
+    ConfigStore::requestCommit(7);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, hreg(ModbusHoldingReg::CONFIG_COMMIT));
+}
+
+int main()
+{
+    Sim::begin();
+    modbusHandler->begin();
+    ConfigStore::begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_save_and_restore);
+    RUN_TEST(test_unchanged_commit_skips_write);
+    RUN_TEST(test_slots_rotate);
+    RUN_TEST(test_crc_rejects_damaged_record);
+    RUN_TEST(test_commit_during_save_is_queued);
+    RUN_TEST(test_unknown_command_rejected);
+    return UNITY_END();
+}
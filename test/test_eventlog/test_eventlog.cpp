@@ -0,0 +1,124 @@
+// EventLog: cursor window, overwritten entries pushing the cursor, and
+// clamping of stale or future cursors with the lost count
+#include <unity.h>
+#include "ModbusHandler.h"
+#include "Globals.h"
+#include "EventLog.h"
+#include "SimKernel.h"
+
+static uint16_t ireg(uint16_t reg)
+{
+    return modbusHandler->getIreg(reg);
+}
+
+// Event `sequence` carries its own sequence number as the value
+static void logEvents(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        EventLog::log(EVT_MODBUS_RESTART, EventLog::NO_MOTOR, EventLog::headSequence());
+}
+
+// Value of window entry n
+static uint16_t windowValue(uint8_t n)
+{
+    return ireg(ModbusInputReg::EVENT_WINDOW_BASE + n * EventLog::WINDOW_REGS + 5);
+}
+
+static uint16_t windowCode(uint8_t n)
+{
+    return ireg(ModbusInputReg::EVENT_WINDOW_BASE + n * EventLog::WINDOW_REGS + 4);
+}
+
+void setUp()
+{
+    EventLog::begin();
+}
+
+void tearDown()
+{
+}
+
+void test_window_follows_cursor()
+{
+    logEvents(3);
+    TEST_ASSERT_EQUAL_UINT16(3, ireg(ModbusInputReg::EVENT_HEAD));
+    TEST_ASSERT_EQUAL_UINT16(0, windowValue(0));
+    TEST_ASSERT_EQUAL_UINT16(EVT_MODBUS_RESTART | EventLog::NO_MOTOR << 8, windowCode(0));
+
+    EventLog::setCursor(1);
+    TEST_ASSERT_EQUAL_UINT16(1, ireg(ModbusInputReg::EVENT_CURSOR_USED));
+    TEST_ASSERT_EQUAL_UINT16(1, windowValue(0));
+    TEST_ASSERT_EQUAL_UINT16(2, windowValue(1));
+
+    // Entries at or past the head read 0
+    TEST_ASSERT_EQUAL_UINT16(0, windowCode(2));
+    TEST_ASSERT_EQUAL_UINT16(0, ireg(ModbusInputReg::EVENT_LOST));
+}
+
+void test_overflow_pushes_cursor()
+{
+    logEvents(EVENT_LOG_ENTRIES + 5);
+    TEST_ASSERT_EQUAL_UINT16(5, ireg(ModbusInputReg::EVENT_CURSOR_USED));
+    TEST_ASSERT_EQUAL_UINT16(5, ireg(ModbusInputReg::EVENT_LOST));
+    TEST_ASSERT_EQUAL_UINT16(5, windowValue(0));
+
+    EventLog::Entry e;
+    TEST_ASSERT_FALSE(EventLog::get(4, e));
+    TEST_ASSERT_TRUE(EventLog::get(5, e));
+    TEST_ASSERT_EQUAL_UINT16(5, e.value);
+}
+
+void test_stale_cursor_clamped_and_counted()
+{
+    // A master that keeps up, then one that comes back with an old cursor
+    for (uint16_t i = 0; i < EVENT_LOG_ENTRIES + 8; i++)
+    {
+        logEvents(1);
+        EventLog::setCursor(EventLog::headSequence());
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, ireg(ModbusInputReg::EVENT_LOST));
+
+    EventLog::setCursor(2);
+    TEST_ASSERT_EQUAL_UINT16(8, ireg(ModbusInputReg::EVENT_CURSOR_USED));
+    TEST_ASSERT_EQUAL_UINT16(6, ireg(ModbusInputReg::EVENT_LOST));
+    TEST_ASSERT_EQUAL_UINT16(8, windowValue(0));
+}
+
+void test_future_cursor_clamped_to_head()
+{
+    logEvents(4);
+    EventLog::setCursor(EventLog::headSequence() + 3);
+    TEST_ASSERT_EQUAL_UINT16(4, ireg(ModbusInputReg::EVENT_CURSOR_USED));
+    TEST_ASSERT_EQUAL_UINT16(0, ireg(ModbusInputReg::EVENT_LOST));
+    TEST_ASSERT_EQUAL_UINT16(0, windowCode(0));
+}
+
+void test_sequence_wraps()
+{
+    // Sequences are 16-bit; cursor arithmetic has to survive the wrap
+    for (uint32_t i = 0; i < 0x10000UL - 2; i++)
+        EventLog::log(EVT_MODBUS_RESTART);
+    EventLog::setCursor(EventLog::headSequence());
+    logEvents(4);
+    TEST_ASSERT_EQUAL_UINT16(2, ireg(ModbusInputReg::EVENT_HEAD));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFE, windowValue(0));
+    TEST_ASSERT_EQUAL_UINT16(1, windowValue(3));
+
+    EventLog::setCursor(0);
+    TEST_ASSERT_EQUAL_UINT16(0, ireg(ModbusInputReg::EVENT_CURSOR_USED));
+    TEST_ASSERT_EQUAL_UINT16(0, windowValue(0));
+}
+
+int main()
+{
+    Sim::begin();
+    modbusHandler->begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_window_follows_cursor);
+    RUN_TEST(test_overflow_pushes_cursor);
+    RUN_TEST(test_stale_cursor_clamped_and_counted);
+    RUN_TEST(test_future_cursor_clamped_to_head);
+    RUN_TEST(test_sequence_wraps);
+    return UNITY_END();
+}
@@ -0,0 +1,216 @@
+// History: records read back through the Modbus snapshot window decode
+// (zigzag varints against the keyframe) to exactly what was sampled,
+// before and after the ring starts folding old records into the keyframe
+#include <unity.h>
+#include <vector>
+#include "ModbusHandler.h"
+#include "Globals.h"
+#include "History.h"
+#include "MotorTable.h"
+#include "PWMController.h"
+#include "SimKernel.h"
+
+struct Sample
+{
+    uint64_t time;
+    uint16_t values[History::CHANNELS];
+};
+
+// Everything sampled so far; the ring starts from all zeros
+static std::vector<Sample> samples;
+
+static uint16_t ireg(uint16_t reg)
+{
+    return modbusHandler->getIreg(reg);
+}
+
+static void sampleAfter(uint32_t ms, const uint16_t *values)
+{
+    Sim::advance((uint64_t)ms * 1000 * Sim::CYCLES_PER_US);
+
+    Sample s;
+    for (uint8_t i = 0; i < NUM_MOTORS; i++)
+    {
+        motorTable.current[i] = values[i];
+        motorTable.temperature[i] = (int16_t)values[NUM_MOTORS + i];
+    }
+    memcpy(s.values, values, sizeof(s.values));
+    History::sample();
+    s.time = PWMController::uptimeMillis();
+    samples.push_back(s);
+}
+
+static uint16_t snapshotLength()
+{
+    History::open();
+    return ireg(ModbusInputReg::HISTORY_LENGTH);
+}
+
+// Snapshot bytes as a master reads them: window by window, high byte first
+static std::vector<uint8_t> readSnapshot()
+{
+    History::open();
+    uint16_t length = ireg(ModbusInputReg::HISTORY_LENGTH);
+    std::vector<uint8_t> bytes;
+    for (uint16_t offset = 0; offset < length; offset += 2 * HISTORY_WINDOW_SIZE)
+    {
+        History::setOffset(offset);
+        for (uint8_t r = 0; r < HISTORY_WINDOW_SIZE; r++)
+        {
+            uint16_t word = ireg(ModbusInputReg::HISTORY_WINDOW_BASE + r);
+            bytes.push_back(word >> 8);
+            bytes.push_back(word & 0xFF);
+        }
+    }
+    bytes.resize(length);
+    TEST_ASSERT_EQUAL_UINT16(History::OPEN, ireg(ModbusInputReg::HISTORY_STATE));
+    return bytes;
+}
+
+static int32_t decodeVarint(const std::vector<uint8_t> &bytes, size_t &pos)
+{
+    uint32_t z = 0;
+    uint8_t shift = 0;
+    uint8_t b;
+    do
+    {
+        TEST_ASSERT_LESS_THAN(bytes.size(), pos);
+        b = bytes[pos++];
+        z |= (uint32_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+// Decodes a fresh snapshot and checks it against the newest samples
+static void checkSnapshot()
+{
+    std::vector<uint8_t> bytes = readSnapshot();
+    uint16_t records = ireg(ModbusInputReg::HISTORY_RECORDS);
+    TEST_ASSERT_LESS_OR_EQUAL(samples.size(), records);
+
+    // Keyframe: the state just before the oldest record
+    Sample state = {};
+    size_t first = samples.size() - records;
+    if (first > 0)
+        state = samples[first - 1];
+
+    size_t pos = 0;
+    uint64_t time = 0;
+    for (uint8_t i = 0; i < 8; i++)
+        time |= (uint64_t)bytes[pos++] << (8 * i);
+    TEST_ASSERT_EQUAL_UINT64(state.time, time);
+    uint16_t values[History::CHANNELS];
+    for (uint8_t c = 0; c < History::CHANNELS; c++)
+    {
+        values[c] = bytes[pos] | (uint16_t)bytes[pos + 1] << 8;
+        pos += 2;
+        TEST_ASSERT_EQUAL_UINT16(state.values[c], values[c]);
+    }
+
+    for (size_t r = first; r < samples.size(); r++)
+    {
+        time += decodeVarint(bytes, pos);
+        TEST_ASSERT_EQUAL_UINT64(samples[r].time, time);
+        for (uint8_t c = 0; c < History::CHANNELS; c++)
+        {
+            values[c] += (uint16_t)decodeVarint(bytes, pos);
+            TEST_ASSERT_EQUAL_UINT16(samples[r].values[c], values[c]);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(bytes.size(), pos);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_steady_record_is_one_byte_per_value()
+{
+    uint16_t values[History::CHANNELS] = {};
+    sampleAfter(10, values);
+    uint16_t before = snapshotLength();
+    sampleAfter(10, values);
+    uint16_t after = snapshotLength();
+    TEST_ASSERT_EQUAL_UINT16(1 + History::CHANNELS, after - before);
+    checkSnapshot();
+}
+
+void test_round_trip_across_varint_widths()
+{
+    // Deltas straddling the 1/2/3-byte zigzag boundaries, both signs, and
+    // 16-bit wrap (a current step of 0 -> 65000 and a negative temperature)
+    static const int32_t steps[] = {63, -64, 64, -65, 8191, -8192, 8192, -32768, 32767, 1, -1, 0};
+    uint16_t values[History::CHANNELS] = {};
+    for (const int32_t step : steps)
+    {
+        for (uint8_t c = 0; c < History::CHANNELS; c++)
+            values[c] += (uint16_t)(c & 1 ? -step : step);
+        sampleAfter(1 + (step & 0x3FF), values);
+    }
+    values[0] = 65000;
+    values[NUM_MOTORS] = (uint16_t)-2750; // -27.5 °C
+    sampleAfter(20000, values); // 3-byte time delta
+    checkSnapshot();
+}
+
+void test_round_trip_after_eviction()
+{
+    // Wide deltas fill the ring quickly, so the oldest records get folded
+    // into the keyframe
+    uint16_t values[History::CHANNELS] = {};
+    for (uint16_t n = 0; n < 200; n++)
+    {
+        for (uint8_t c = 0; c < History::CHANNELS; c++)
+            values[c] = (uint16_t)(n * 7919u + c * 104729u);
+        sampleAfter(500, values);
+    }
+    TEST_ASSERT_LESS_THAN(200, ireg(ModbusInputReg::HISTORY_RECORDS));
+    checkSnapshot();
+}
+
+void test_age_of_newest_record()
+{
+    uint16_t values[History::CHANNELS] = {};
+    sampleAfter(10, values);
+    Sim::advance(250UL * 1000 * Sim::CYCLES_PER_US);
+    History::open();
+    TEST_ASSERT_UINT_WITHIN(1, 250, ireg(ModbusInputReg::HISTORY_AGE_MS));
+
+    // START restarts TIME_LOW's clock, not the history's
+    PWMController::clearCount();
+    sampleAfter(40, values);
+    TEST_ASSERT_EQUAL_UINT64(samples[samples.size() - 2].time + 290, samples.back().time);
+    checkSnapshot();
+}
+
+void test_snapshot_goes_stale_when_overwritten()
+{
+    History::open();
+    uint16_t values[History::CHANNELS] = {};
+    for (uint16_t n = 0; n < 100; n++)
+    {
+        values[0] = n * 1000;
+        sampleAfter(500, values);
+    }
+    TEST_ASSERT_EQUAL_UINT16(History::STALE, ireg(ModbusInputReg::HISTORY_STATE));
+}
+
+int main()
+{
+    Sim::begin();
+    PWMController::initialize();
+    modbusHandler->begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_record_is_one_byte_per_value);
+    RUN_TEST(test_round_trip_across_varint_widths);
+    RUN_TEST(test_round_trip_after_eviction);
+    RUN_TEST(test_age_of_newest_record);
+    RUN_TEST(test_snapshot_goes_stale_when_overwritten);
+    return UNITY_END();
+}
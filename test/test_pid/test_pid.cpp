@@ -0,0 +1,109 @@
+// PIDController: proportional step, integration, anti-windup, derivative on
+// the measurement and the per-second -> per-step ki conversion
+#include <unity.h>
+#include "PIDController.h"
+
+static constexpr uint16_t HALF = 0x8000; // 0.5 % duty per mA in Q16
+
+static PIDController pid;
+
+void setUp()
+{
+    pid.reset(0, 0);
+}
+
+void tearDown()
+{
+}
+
+void test_proportional_step()
+{
+    PIDController::Gains g = {HALF, 0, 0};
+    TEST_ASSERT_EQUAL_UINT16(50, pid.update(100, 0, g));
+    TEST_ASSERT_EQUAL_UINT16(25, pid.update(50, 0, g));
+}
+
+void test_output_clamped()
+{
+    PIDController::Gains g = {HALF, 0, 0};
+    TEST_ASSERT_EQUAL_UINT16(100, pid.update(30000, 0, g));
+    TEST_ASSERT_EQUAL_UINT16(0, pid.update(0, 30000, g));
+    TEST_ASSERT_EQUAL_UINT16(60, pid.update(30000, 0, g, 60));
+}
+
+void test_integral_accumulates()
+{
+    PIDController::Gains g = {0, 0x1000, 0}; // 1/16 % per mA per step
+    uint16_t out = 0;
+    for (uint8_t i = 0; i < 10; i++)
+        out = pid.update(16, 0, g);
+    TEST_ASSERT_EQUAL_UINT16(10, out);
+}
+
+void test_bumpless_reset()
+{
+    PIDController::Gains g = {HALF, 0x1000, 0};
+    pid.reset(40, 500);
+    TEST_ASSERT_EQUAL_UINT16(40, pid.update(500, 500, g));
+}
+
+void test_anti_windup()
+{
+    // P too weak to saturate on its own, so the integrator carries the output
+    PIDController::Gains g = {0x0100, 0x4000, 0};
+
+    // Held below the setpoint long enough to wind a plain integrator up by
+    // orders of magnitude past the output range
+    for (uint16_t i = 0; i < 1000; i++)
+        pid.update(200, 0, g);
+    TEST_ASSERT_EQUAL_UINT16(100, pid.update(200, 0, g));
+
+    // Overshoot by 40 mA: the integrator was held at the rail, so one step
+    // of -10 % brings the output straight off it
+    uint16_t out = pid.update(0, 40, g);
+    TEST_ASSERT_UINT_WITHIN(1, 90, out);
+    TEST_ASSERT_UINT_WITHIN(1, 80, pid.update(0, 40, g));
+}
+
+void test_integral_never_negative()
+{
+    PIDController::Gains g = {0, 0x4000, 0};
+    for (uint16_t i = 0; i < 1000; i++)
+        TEST_ASSERT_EQUAL_UINT16(0, pid.update(0, 1000, g));
+
+    // The integrator sat at zero, so it starts rising immediately
+    TEST_ASSERT_EQUAL_UINT16(1, pid.update(4, 0, g));
+}
+
+void test_derivative_on_measurement()
+{
+    PIDController::Gains g = {0, 0, HALF};
+    pid.reset(50, 0);
+
+    // A setpoint step does not kick the output
+    TEST_ASSERT_EQUAL_UINT16(50, pid.update(1000, 0, g));
+    // A rising measurement pulls it down
+    TEST_ASSERT_EQUAL_UINT16(45, pid.update(1000, 10, g));
+}
+
+void test_step_gain()
+{
+    TEST_ASSERT_EQUAL_UINT16(55, PIDController::stepGain(5500, 10));
+    TEST_ASSERT_EQUAL_UINT16(1, PIDController::stepGain(1, 500)); // Rounded
+    TEST_ASSERT_EQUAL_UINT16(0, PIDController::stepGain(1, 499));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, PIDController::stepGain(0xFFFF, 2000)); // Saturated
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_proportional_step);
+    RUN_TEST(test_output_clamped);
+    RUN_TEST(test_integral_accumulates);
+    RUN_TEST(test_bumpless_reset);
+    RUN_TEST(test_anti_windup);
+    RUN_TEST(test_integral_never_negative);
+    RUN_TEST(test_derivative_on_measurement);
+    RUN_TEST(test_step_gain);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+// HwiReadPlan::frames(): sorting, merging across small gaps, splitting at
+// the request limit, and keeping register spaces apart
+#include <unity.h>
+#include "HwiMaster.h"
+
+static HwiReadPlan plan;
+
+static void assertFrame(const HwiSpan &f, HwiSpace space, uint16_t start, uint16_t count)
+{
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)space, (uint8_t)f.space);
+    TEST_ASSERT_EQUAL_UINT16(start, f.start);
+    TEST_ASSERT_EQUAL_UINT16(count, f.count);
+}
+
+void setUp()
+{
+    plan.clear();
+}
+
+void tearDown()
+{
+}
+
+void test_adjacent_and_overlapping_spans_merge()
+{
+    plan.add(HwiSpace::HOLDING, 10, 5);
+    plan.add(HwiSpace::HOLDING, 0, 10);
+    plan.add(HwiSpace::HOLDING, 12, 8);
+    std::vector<HwiSpan> f = plan.frames();
+    TEST_ASSERT_EQUAL_UINT32(1, f.size());
+    assertFrame(f[0], HwiSpace::HOLDING, 0, 20);
+}
+
+void test_gap_merged_up_to_max_gap()
+{
+    plan.add(HwiSpace::INPUT, 0, 10);
+    plan.add(HwiSpace::INPUT, 10 + 6, 4);
+
+    std::vector<HwiSpan> f = plan.frames(6);
+    TEST_ASSERT_EQUAL_UINT32(1, f.size());
+    assertFrame(f[0], HwiSpace::INPUT, 0, 20);
+
+    f = plan.frames(5);
+    TEST_ASSERT_EQUAL_UINT32(2, f.size());
+    assertFrame(f[0], HwiSpace::INPUT, 0, 10);
+    assertFrame(f[1], HwiSpace::INPUT, 16, 4);
+}
+
+void test_default_gap_is_wire_cost_of_a_request()
+{
+    // At 250 kbaud a request costs ~46 registers of padding
+    TEST_ASSERT_EQUAL_UINT16(46, HwiReadPlan::DEFAULT_MAX_GAP);
+    plan.add(HwiSpace::INPUT, 0, 1);
+    plan.add(HwiSpace::INPUT, 1 + HwiReadPlan::DEFAULT_MAX_GAP, 1);
+    plan.add(HwiSpace::INPUT, 100, 1);
+    std::vector<HwiSpan> f = plan.frames();
+    TEST_ASSERT_EQUAL_UINT32(2, f.size());
+    assertFrame(f[0], HwiSpace::INPUT, 0, 48);
+    assertFrame(f[1], HwiSpace::INPUT, 100, 1);
+}
+
+void test_spaces_never_merge()
+{
+    plan.add(HwiSpace::INPUT, 0, 4);
+    plan.add(HwiSpace::HOLDING, 0, 4);
+    std::vector<HwiSpan> f = plan.frames();
+    TEST_ASSERT_EQUAL_UINT32(2, f.size());
+    assertFrame(f[0], HwiSpace::HOLDING, 0, 4);
+    assertFrame(f[1], HwiSpace::INPUT, 0, 4);
+}
+
+void test_frames_capped_at_max_read()
+{
+    // A merge that would exceed one request starts a new frame
+    plan.add(HwiSpace::INPUT, 0, 100);
+    plan.add(HwiSpace::INPUT, 100, 50);
+    std::vector<HwiSpan> f = plan.frames();
+    TEST_ASSERT_EQUAL_UINT32(2, f.size());
+    assertFrame(f[0], HwiSpace::INPUT, 0, 100);
+    assertFrame(f[1], HwiSpace::INPUT, 100, 50);
+
+    // A single span wider than one request is split
+    plan.clear();
+    plan.add(HwiSpace::INPUT, 0, 300);
+    f = plan.frames();
+    TEST_ASSERT_EQUAL_UINT32(3, f.size());
+    assertFrame(f[0], HwiSpace::INPUT, 0, HwiReadPlan::MAX_READ);
+    assertFrame(f[1], HwiSpace::INPUT, 125, HwiReadPlan::MAX_READ);
+    assertFrame(f[2], HwiSpace::INPUT, 250, 50);
+}
+
+void test_spans_clipped_to_register_space()
+{
+    plan.add(HwiSpace::HOLDING, HOLDING_REG_COUNT - 2, 10);
+    plan.add(HwiSpace::HOLDING, HOLDING_REG_COUNT, 5);
+    plan.add(HwiSpace::INPUT, 0, 0);
+    std::vector<HwiSpan> f = plan.frames();
+    TEST_ASSERT_EQUAL_UINT32(1, f.size());
+    assertFrame(f[0], HwiSpace::HOLDING, HOLDING_REG_COUNT - 2, 2);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_adjacent_and_overlapping_spans_merge);
+    RUN_TEST(test_gap_merged_up_to_max_gap);
+    RUN_TEST(test_default_gap_is_wire_cost_of_a_request);
+    RUN_TEST(test_spaces_never_merge);
+    RUN_TEST(test_frames_capped_at_max_read);
+    RUN_TEST(test_spans_clipped_to_register_space);
+    return UNITY_END();
+}
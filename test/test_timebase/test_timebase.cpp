@@ -0,0 +1,114 @@
+// Timer2 timebase under the simulated timer and overflow ISR: the clocks
+// never run backwards or skip ahead at any prescaler, across prescaler
+// changes, and START clears microsCustom() without touching uptime
+#include <unity.h>
+#include <avr/interrupt.h>
+#include "PWMController.h"
+#include "SimKernel.h"
+
+// Global frequencies selecting Timer2 clk/1 ... clk/1024
+static const uint32_t FREQUENCIES[] = {10000, 5000, 2000, 1000, 500, 200, 100};
+static const uint16_t PRESCALERS[] = {1, 8, 32, 64, 128, 256, 1024};
+
+struct Clocks
+{
+    uint64_t micros;
+    uint64_t uptime;
+    uint32_t cycles;
+
+    static Clocks now()
+    {
+        return {PWMController::microsCustom(), PWMController::uptimeMicros(), PWMController::cycles()};
+    }
+};
+
+// Steps the simulation by an odd number of cycles (so reads land at every
+// phase of the count and around the overflow) and checks each step against
+// elapsed time, allowing one Timer2 tick of resolution. Every other step is
+// taken and read with interrupts off, so reads also see an overflow whose
+// ISR has not run yet.
+static void walk(uint16_t prescaler, uint32_t steps)
+{
+    const uint32_t step = 37;
+    const uint32_t tickUs = prescaler / Sim::CYCLES_PER_US + 1;
+    Clocks last = Clocks::now();
+    for (uint32_t i = 0; i < steps; i++)
+    {
+        if (i & 1)
+            cli();
+        Sim::advance(step);
+        Clocks c = Clocks::now();
+        sei();
+        TEST_ASSERT_GREATER_OR_EQUAL(last.micros, c.micros);
+        TEST_ASSERT_GREATER_OR_EQUAL(last.uptime, c.uptime);
+        TEST_ASSERT_LESS_OR_EQUAL(step / Sim::CYCLES_PER_US + tickUs, c.uptime - last.uptime);
+        TEST_ASSERT_LESS_OR_EQUAL(step + prescaler, c.cycles - last.cycles);
+        last = c;
+    }
+}
+
+void setUp()
+{
+    Sim::begin();
+    PWMController::initialize();
+}
+
+void tearDown()
+{
+}
+
+void test_monotonic_at_every_prescaler()
+{
+    for (uint8_t i = 0; i < sizeof(FREQUENCIES) / sizeof(FREQUENCIES[0]); i++)
+    {
+        PWMController::setGlobalFrequency(FREQUENCIES[i]);
+        walk(PRESCALERS[i], 20000);
+    }
+}
+
+void test_tracks_simulated_time()
+{
+    PWMController::setGlobalFrequency(100); // clk/1024, coarsest tick
+    uint64_t start = PWMController::uptimeMicros();
+    uint64_t simStart = Sim::now();
+    Sim::advance(3 * F_CPU + 12345); // A little over 3 s
+    uint64_t elapsedUs = (Sim::now() - simStart) / Sim::CYCLES_PER_US;
+    TEST_ASSERT_UINT_WITHIN(1024 / Sim::CYCLES_PER_US, elapsedUs, PWMController::uptimeMicros() - start);
+}
+
+void test_prescaler_change_keeps_time()
+{
+    PWMController::setGlobalFrequency(100);
+    Sim::advance(1000003);
+    uint64_t before = PWMController::uptimeMicros();
+    PWMController::setGlobalFrequency(10000);
+    uint64_t after = PWMController::uptimeMicros();
+    TEST_ASSERT_GREATER_OR_EQUAL(before, after);
+    TEST_ASSERT_LESS_OR_EQUAL(before + 64, after);
+    walk(1, 5000);
+}
+
+void test_start_clears_micros_not_uptime()
+{
+    PWMController::setGlobalFrequency(5000);
+    Sim::advance(2 * F_CPU);
+    uint64_t uptime = PWMController::uptimeMicros();
+    PWMController::clearCount();
+    TEST_ASSERT_LESS_OR_EQUAL(1, PWMController::microsCustom());
+    TEST_ASSERT_EQUAL_UINT64(0, PWMController::millisCustom());
+    TEST_ASSERT_GREATER_OR_EQUAL(uptime, PWMController::uptimeMicros());
+
+    Sim::advance(F_CPU / 2);
+    TEST_ASSERT_UINT_WITHIN(1, 500, PWMController::millisCustom());
+    walk(8, 20000);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_monotonic_at_every_prescaler);
+    RUN_TEST(test_tracks_simulated_time);
+    RUN_TEST(test_prescaler_change_keeps_time);
+    RUN_TEST(test_start_clears_micros_not_uptime);
+    return UNITY_END();
+}